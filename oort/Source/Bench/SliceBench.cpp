@@ -0,0 +1,631 @@
+// Headless slicer benchmark. Loads the shipped asteroid meshes and slices each
+// one with the same seeded random planes through every slicer entry point, so
+// runs on different builds can be compared line by line. Needs no window and
+// no Ogre root, only the slicer sources. -threads-sweep n times only the mesh
+// mode, at 1 to n threads, with the speedup over one thread. -check slices a
+// hollow cube and the shipped meshes instead and fails if any capped half
+// comes out open by exact position.
+//
+//   slicebench [-n slices] [-seed s] [-threads t] [-threads-sweep n] [-spread f]
+//              [-assets dir] [-csv] [-check]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "MeshSlicer.h"
+#include "MeshCache.h"
+#include "HalfEdgeMesh.h"
+#include "MeshOptimizer.h"
+
+// Every heap allocation in the process goes through here, so the counts
+// include the slicer's worker threads. A 16 byte header keeps the size for
+// the live byte count and the alignment new promises.
+static std::atomic<size_t> allocCount(0);
+static std::atomic<size_t> allocBytes(0);
+static std::atomic<size_t> liveBytes(0);
+static std::atomic<size_t> peakBytes(0);
+
+static const size_t ALLOC_HEADER = 16;
+
+static void* countedAlloc(size_t bytes)
+{
+	char* p = static_cast<char*>(malloc(bytes + ALLOC_HEADER));
+	if (!p)
+		throw std::bad_alloc();
+	*reinterpret_cast<size_t*>(p) = bytes;
+
+	allocCount++;
+	allocBytes += bytes;
+	size_t live = liveBytes += bytes;
+	size_t peak = peakBytes;
+	while (live > peak && !peakBytes.compare_exchange_weak(peak, live))
+		;
+	return p + ALLOC_HEADER;
+}
+
+static void countedFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	char* p = static_cast<char*>(ptr) - ALLOC_HEADER;
+	liveBytes -= *reinterpret_cast<size_t*>(p);
+	free(p);
+}
+
+void* operator new(size_t bytes) { return countedAlloc(bytes); }
+void* operator new[](size_t bytes) { return countedAlloc(bytes); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+
+// The nothrow forms must come from the same heap as the ones above
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+	try { return countedAlloc(bytes); } catch (...) { return NULL; }
+}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+	try { return countedAlloc(bytes); } catch (...) { return NULL; }
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+
+static const char* MESHES[] = {
+	"Stone_01", "Stone_04",
+	"Stone_01_LC", "Stone_01_RC",
+	"Stone_04_LC", "Stone_04_RC"
+};
+static const int MESH_COUNT = sizeof(MESHES) / sizeof(MESHES[0]);
+
+// By default planes go through the middle half of the bounding box, so
+// nearly all of them cut the mesh. Larger spreads model off centre hits.
+static const float PLANE_SPREAD = 0.5f;
+
+struct Plane {
+	vec3f point;
+	vec3f normal;
+};
+
+struct Run {
+	const char* mode;
+	int slices;
+	double seconds;
+	size_t allocations;
+	size_t bytes;
+	size_t peak;
+	size_t arenaBlocks;
+	long long vertsOut;
+	long long facesOut;
+};
+
+struct CacheTotals {
+	double before;
+	double after;
+	double faces;
+	CacheTotals() : before(0.0), after(0.0), faces(0.0) {}
+};
+
+// Seconds to parse the XML, and to open its binary cache once it exists
+struct LoadTimes {
+	double xml;
+	double mapped;
+	LoadTimes() : xml(0.0), mapped(0.0) {}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static size_t peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static std::vector<Plane> randomPlanes(const XML_Mesh& mesh, int count, unsigned seed, float spread)
+{
+	vec3f lo(1e30f), hi(-1e30f);
+	for (size_t i = 0; i < mesh.verts.size(); ++i)
+	{
+		const vec3f& v = mesh.verts[i];
+		lo = vec3f(std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z));
+		hi = vec3f(std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z));
+	}
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> offset(-0.5f * spread, 0.5f * spread);
+	std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+	std::vector<Plane> planes(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Plane& p = planes[i];
+		p.point = vec3f(0.5f * (lo.x + hi.x) + offset(rng) * (hi.x - lo.x),
+			0.5f * (lo.y + hi.y) + offset(rng) * (hi.y - lo.y),
+			0.5f * (lo.z + hi.z) + offset(rng) * (hi.z - lo.z));
+
+		// Normalized gaussian samples are uniform on the sphere
+		float len = 0.0f;
+		while (len < 1e-6f)
+		{
+			p.normal = vec3f(gauss(rng), gauss(rng), gauss(rng));
+			len = std::sqrt(p.normal.x * p.normal.x + p.normal.y * p.normal.y + p.normal.z * p.normal.z);
+		}
+		p.normal = vec3f(p.normal.x / len, p.normal.y / len, p.normal.z / len);
+	}
+	return planes;
+}
+
+// Slices once untimed so scratch and arena have grown to fit, then times the
+// rest. Output meshes are freed inside the timed loop since the game frees
+// them too.
+template <class SliceFn>
+static Run timeSlices(const char* mode, MeshSlicer& slicer, const std::vector<Plane>& planes, SliceFn slice)
+{
+	Run run;
+	memset(&run, 0, sizeof(run));
+	run.mode = mode;
+	run.slices = (int)planes.size();
+
+	long long verts = 0, faces = 0;
+	slice(planes[0], verts, faces);
+
+	size_t arenaStart = slicer.arenaAllocations();
+	size_t countStart = allocCount;
+	size_t bytesStart = allocBytes;
+	size_t liveStart = liveBytes;
+	peakBytes = liveStart;
+
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < planes.size(); ++i)
+		slice(planes[i], run.vertsOut, run.facesOut);
+	run.seconds = since(start);
+
+	run.allocations = allocCount - countStart;
+	run.bytes = allocBytes - bytesStart;
+	run.peak = peakBytes - liveStart;
+	run.arenaBlocks = slicer.arenaAllocations() - arenaStart;
+	return run;
+}
+
+static void report(const char* mesh, size_t faces, const Run& run, bool csv)
+{
+	double perSlice = run.slices > 0 ? 1.0 / run.slices : 0.0;
+	double facesPerSec = run.seconds > 0.0 ? faces * run.slices / run.seconds : 0.0;
+	if (csv)
+	{
+		printf("%s,%s,%zu,%d,%.6f,%.0f,%.2f,%.0f,%zu,%zu,%.1f,%.1f\n", mesh, run.mode, faces, run.slices,
+			run.seconds * 1000.0 * perSlice, facesPerSec, run.allocations * perSlice, run.bytes * perSlice,
+			run.peak, run.arenaBlocks, run.vertsOut * perSlice, run.facesOut * perSlice);
+		return;
+	}
+	printf("%-12s %-9s %8zu %10.3f %12.0f %10.2f %12.0f %12zu %6zu %10.1f %10.1f\n", mesh, run.mode, faces,
+		run.seconds * 1000.0 * perSlice, facesPerSec, run.allocations * perSlice, run.bytes * perSlice,
+		run.peak, run.arenaBlocks, run.vertsOut * perSlice, run.facesOut * perSlice);
+}
+
+static void countMeshes(std::vector<XML_Mesh*>& halves, long long& verts, long long& faces)
+{
+	for (size_t i = 0; i < halves.size(); ++i)
+	{
+		verts += halves[i]->verts.size();
+		faces += halves[i]->faces.size();
+		delete halves[i];
+	}
+	halves.clear();
+}
+
+// The mesh mode again at every thread count up to maxThreads, against the
+// time one thread takes
+static void sweepThreads(const char* mesh, MeshSlicer& slicer, const std::vector<Plane>& planes, int maxThreads, bool csv)
+{
+	std::vector<XML_Mesh*> halves;
+	double single = 0.0;
+	for (int t = 1; t <= maxThreads; ++t)
+	{
+		slicer.setThreads(t);
+		Run run = timeSlices("mesh", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				slicer.sliceByPlane(halves, p.point, p.normal);
+				countMeshes(halves, verts, faces);
+			});
+		double ms = run.seconds * 1000.0 / run.slices;
+		if (t == 1)
+			single = ms;
+		double speedup = ms > 0.0 ? single / ms : 0.0;
+		if (csv)
+			printf("%s,%d,%.6f,%.2f\n", mesh, t, ms, speedup);
+		else
+			printf("%-12s %8d %10.3f %8.2fx\n", mesh, t, ms, speedup);
+	}
+}
+
+static void addCube(std::vector<vec3f>& verts, std::vector<vec3i>& faces, vec3f centre, float size, bool inward)
+{
+	int base = (int)verts.size();
+	for (int i = 0; i < 8; ++i)
+		verts.push_back(vec3f(centre.x + (i & 1 ? size : -size), centre.y + (i & 2 ? size : -size), centre.z + (i & 4 ? size : -size)));
+	static const int QUADS[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+	for (int q = 0; q < 6; ++q)
+	{
+		vec3i a(base + QUADS[q][0], base + QUADS[q][1], base + QUADS[q][2]);
+		vec3i b(base + QUADS[q][0], base + QUADS[q][2], base + QUADS[q][3]);
+		if (inward)
+		{
+			std::swap(a.y, a.z);
+			std::swap(b.y, b.z);
+		}
+		faces.push_back(a);
+		faces.push_back(b);
+	}
+}
+
+struct PositionLess {
+	bool operator()(const vec3f& a, const vec3f& b) const
+	{
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	}
+};
+
+// Edges without a twin running the other way. Vertices are matched by exact
+// position, so seam and cap copies of a point only close the surface when
+// the slicer gave them the same bits.
+static int openEdges(const vec3f* verts, int vertexCount, const vec3i* faces, int faceCount)
+{
+	std::map<vec3f, int, PositionLess> ids;
+	std::vector<int> weld(vertexCount);
+	for (int i = 0; i < vertexCount; ++i)
+		weld[i] = ids.insert(std::make_pair(verts[i], (int)ids.size())).first->second;
+
+	std::map<std::pair<int, int>, int> edges;
+	for (int f = 0; f < faceCount; ++f)
+	{
+		int c[3] = { weld[faces[f].x], weld[faces[f].y], weld[faces[f].z] };
+		if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0])
+			continue;
+		for (int k = 0; k < 3; ++k)
+		{
+			edges[std::make_pair(c[k], c[(k + 1) % 3])]++;
+			edges[std::make_pair(c[(k + 1) % 3], c[k])]--;
+		}
+	}
+	int open = 0;
+	for (std::map<std::pair<int, int>, int>::const_iterator e = edges.begin(); e != edges.end(); ++e)
+		open += std::max(0, e->second);
+	return open;
+}
+
+static void openHalves(std::vector<XML_Mesh*>& halves, int open[2])
+{
+	for (size_t h = 0; h < halves.size() && h < 2; ++h)
+		open[h] = openEdges(halves[h]->verts.data(), (int)halves[h]->verts.size(), halves[h]->faces.data(), (int)halves[h]->faces.size());
+	for (size_t h = 0; h < halves.size(); ++h)
+		delete halves[h];
+	halves.clear();
+}
+
+// Slices a cube with a cavity, a solid cube floating in the cavity and a
+// second smaller cavity off to the side, through each capped entry point and
+// in place as a half-edge mesh. Every cut has a hole in it, so every cap must
+// bridge one to close. Returns the open edges.
+static int checkHollow()
+{
+	std::vector<vec3f> verts;
+	std::vector<vec3i> faces;
+	addCube(verts, faces, vec3f(0.0f, 0.0f, 0.0f), 1.0f, false);
+	addCube(verts, faces, vec3f(0.0f, 0.0f, 0.0f), 0.5f, true);
+	addCube(verts, faces, vec3f(0.0f, 0.0f, 0.0f), 0.25f, false);
+	addCube(verts, faces, vec3f(0.7f, -0.7f, 0.0f), 0.1f, true);
+	XML_Mesh mesh(verts, faces);
+
+	static const Plane PLANES[] = {
+		{ vec3f(0.1f, 0.05f, 0.0f), vec3f(0.0f, 0.0f, 1.0f) },
+		{ vec3f(0.3f, -0.2f, 0.1f), vec3f(0.3f, 0.5f, 0.81f) },
+		{ vec3f(0.01f, 0.02f, 0.03f), vec3f(1.0f, 0.0f, 0.0f) },
+		{ vec3f(0.02f, 0.0f, 0.0f), vec3f(0.1f, 0.2f, 0.97f) }
+	};
+
+	MeshSlicer slicer(NULL);
+	slicer.loadMesh(&mesh);
+	std::vector<XML_Mesh*> halves;
+	MeshView views[2];
+	HalfEdgeMesh whole, piece, back;
+	whole.fromMesh(mesh);
+	int failed = 0;
+	for (size_t p = 0; p < sizeof(PLANES) / sizeof(PLANES[0]); ++p)
+	{
+		vec3f n = PLANES[p].normal;
+		float len = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+		n = vec3f(n.x / len, n.y / len, n.z / len);
+
+		int open[8] = { 0 };
+		slicer.sliceByPlane(halves, PLANES[p].point, n);
+		openHalves(halves, open);
+		slicer.sliceByPlanePositions(halves, PLANES[p].point, n);
+		openHalves(halves, open + 2);
+		slicer.sliceByPlaneInto(views, PLANES[p].point, n);
+		for (int h = 0; h < 2; ++h)
+			open[4 + h] = openEdges(views[h].verts, views[h].vertexCount, views[h].faces, views[h].faceCount);
+		piece = whole;
+		piece.slice(PLANES[p].point, n, back);
+		open[6] = piece.borderEdges();
+		open[7] = back.borderEdges();
+
+		printf("plane %zu  mesh %d %d  positions %d %d  arena %d %d  halfedge %d %d\n", p,
+			open[0], open[1], open[2], open[3], open[4], open[5], open[6], open[7]);
+		for (int k = 0; k < 8; ++k)
+			failed += open[k];
+	}
+	if (failed)
+		printf("hollow check failed, %d open edges\n", failed);
+	else
+		printf("hollow check passed\n");
+	return failed;
+}
+
+// Slices the shipped meshes on the benchmark's planes, mesh and arena paths.
+// Their UV and normal seams duplicate vertices, so each half only closes by
+// exact position when both copies of a cut edge give the same cut point.
+static int checkSeams(const std::string& assets, int slices, unsigned seed, float spread)
+{
+	int failed = 0;
+	for (int m = 0; m < MESH_COUNT; ++m)
+	{
+		std::string file = assets + MESHES[m] + ".mesh.xml";
+		FILE* probe = fopen(file.c_str(), "rb");
+		if (!probe)
+		{
+			fprintf(stderr, "Skipping %s, %s not found\n", MESHES[m], file.c_str());
+			continue;
+		}
+		fclose(probe);
+
+		XML_Mesh mesh(file);
+		mesh.loadFromXMLFile(file);
+		std::vector<Plane> planes = randomPlanes(mesh, slices, seed, spread);
+		MeshSlicer slicer(NULL);
+		slicer.loadMesh(&mesh);
+		std::vector<XML_Mesh*> halves;
+		MeshView views[2];
+
+		int openMesh = 0, openArena = 0;
+		for (size_t p = 0; p < planes.size(); ++p)
+		{
+			int open[4] = { 0 };
+			slicer.sliceByPlane(halves, planes[p].point, planes[p].normal);
+			openHalves(halves, open);
+			slicer.sliceByPlaneInto(views, planes[p].point, planes[p].normal);
+			for (int h = 0; h < 2; ++h)
+				open[2 + h] = openEdges(views[h].verts, views[h].vertexCount, views[h].faces, views[h].faceCount);
+			openMesh += (open[0] > 0) + (open[1] > 0);
+			openArena += (open[2] > 0) + (open[3] > 0);
+		}
+		printf("%-12s %d cuts, open halves  mesh %d  arena %d\n", MESHES[m], (int)planes.size(), openMesh, openArena);
+		failed += openMesh + openArena;
+	}
+	if (failed)
+		printf("seam check failed, %d open halves\n", failed);
+	else
+		printf("seam check passed\n");
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	int slices = 200;
+	unsigned seed = 1;
+	int threads = 1;
+	int sweep = 0;
+	float spread = PLANE_SPREAD;
+	std::string assets = "../Assets/Asteroid/";
+	bool csv = false;
+	bool check = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool more = i + 1 < argc;
+		if (!strcmp(argv[i], "-n") && more)
+			slices = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-seed") && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-threads") && more)
+			threads = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-threads-sweep") && more)
+			sweep = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-spread") && more)
+			spread = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-assets") && more)
+			assets = std::string(argv[++i]) + "/";
+		else if (!strcmp(argv[i], "-csv"))
+			csv = true;
+		else if (!strcmp(argv[i], "-check"))
+			check = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [-n slices] [-seed s] [-threads t] [-threads-sweep n] [-spread f] [-assets dir] [-csv] [-check]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (check)
+	{
+		int hollow = checkHollow();
+		int seams = checkSeams(assets, slices, seed, spread);
+		return hollow || seams ? 1 : 0;
+	}
+
+	if (sweep > 0)
+	{
+		if (csv)
+			printf("mesh,threads,ms_per_slice,speedup\n");
+		else
+		{
+			printf("%d slices per mesh, seed %u, mesh mode at 1 to %d thread(s), spread %.2f\n\n", slices, seed, sweep, spread);
+			printf("%-12s %8s %10s %9s\n", "mesh", "threads", "ms/slice", "speedup");
+		}
+	}
+	else if (csv)
+		printf("mesh,mode,faces,slices,ms_per_slice,faces_per_sec,allocs_per_slice,bytes_per_slice,peak_heap_bytes,arena_blocks,verts_out,faces_out\n");
+	else
+	{
+		printf("%d slices per mesh, seed %u, %d thread(s), spread %.2f\n\n", slices, seed, threads, spread);
+		printf("%-12s %-9s %8s %10s %12s %10s %12s %12s %6s %10s %10s\n", "mesh", "mode", "faces",
+			"ms/slice", "faces/s", "allocs/sl", "bytes/sl", "peak heap", "arena", "verts out", "faces out");
+	}
+
+	std::vector<CacheTotals> totals(MESH_COUNT);
+	std::vector<LoadTimes> loads(MESH_COUNT);
+	for (int m = 0; m < MESH_COUNT; ++m)
+	{
+		std::string file = assets + MESHES[m] + ".mesh.xml";
+		FILE* probe = fopen(file.c_str(), "rb");
+		if (!probe)
+		{
+			fprintf(stderr, "Skipping %s, %s not found\n", MESHES[m], file.c_str());
+			continue;
+		}
+		fclose(probe);
+
+		XML_Mesh mesh(file);
+		Clock::time_point loadStart = Clock::now();
+		mesh.loadFromXMLFile(file);
+		loads[m].xml = since(loadStart);
+
+		// The first open may have to write the cache, the second one maps it
+		MeshCache binary;
+		binary.open(file);
+		loadStart = Clock::now();
+		bool mapped = binary.open(file);
+		loads[m].mapped = since(loadStart);
+		std::vector<Plane> planes = randomPlanes(mesh, slices, seed, spread);
+
+		MeshSlicer slicer(NULL);
+		slicer.setThreads(threads);
+		slicer.loadMesh(&mesh);
+
+		if (sweep > 0)
+		{
+			sweepThreads(MESHES[m], slicer, planes, sweep, csv);
+			continue;
+		}
+
+		std::vector<XML_Mesh*> halves;
+		MeshView views[2];
+
+		report(MESHES[m], mesh.faces.size(), timeSlices("mesh", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				slicer.sliceByPlane(halves, p.point, p.normal);
+				countMeshes(halves, verts, faces);
+			}), csv);
+
+		// Slices as the fracture service hands them out, reordered for the
+		// vertex cache. Miss ratios are summed over the output faces.
+		MeshOptimizer optimizer;
+		CacheTotals& cache = totals[m];
+		report(MESHES[m], mesh.faces.size(), timeSlices("optimized", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				slicer.sliceByPlane(halves, p.point, p.normal);
+				for (size_t h = 0; h < halves.size(); ++h)
+				{
+					CacheStats stats = optimizer.optimize(*halves[h]);
+					double n = (double)halves[h]->faces.size();
+					cache.before += stats.acmrBefore * n;
+					cache.after += stats.acmrAfter * n;
+					cache.faces += n;
+				}
+				countMeshes(halves, verts, faces);
+			}), csv);
+
+		report(MESHES[m], mesh.faces.size(), timeSlices("positions", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				slicer.sliceByPlanePositions(halves, p.point, p.normal);
+				countMeshes(halves, verts, faces);
+			}), csv);
+
+		report(MESHES[m], mesh.faces.size(), timeSlices("arena", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				slicer.sliceByPlaneInto(views, p.point, p.normal);
+				verts += views[0].vertexCount + views[1].vertexCount;
+				faces += views[0].faceCount + views[1].faceCount;
+			}), csv);
+
+		// The same arena slice, reading the host straight from the mapped cache
+		if (mapped)
+		{
+			slicer.loadMesh(binary.view());
+			report(MESHES[m], mesh.faces.size(), timeSlices("mapped", slicer, planes,
+				[&](const Plane& p, long long& verts, long long& faces) {
+					slicer.sliceByPlaneInto(views, p.point, p.normal);
+					verts += views[0].vertexCount + views[1].vertexCount;
+					faces += views[0].faceCount + views[1].faceCount;
+				}), csv);
+			slicer.loadMesh(&mesh);
+		}
+
+		// Cut in place, each slice starts from a copy of the whole mesh.
+		// Counting render vertices would need a walk, verts out stays 0.
+		HalfEdgeMesh whole, piece, back;
+		whole.fromMesh(mesh);
+		report(MESHES[m], mesh.faces.size(), timeSlices("halfedge", slicer, planes,
+			[&](const Plane& p, long long& verts, long long& faces) {
+				piece = whole;
+				piece.slice(p.point, p.normal, back);
+				faces += piece.faceCount() + back.faceCount();
+			}), csv);
+	}
+
+	if (!csv && sweep == 0)
+	{
+		printf("\n%-12s %10s %10s   (optimized halves, FIFO of %d)\n", "mesh", "acmr in", "acmr out", MeshOptimizer::MEASURE_CACHE_SIZE);
+		for (int m = 0; m < MESH_COUNT; ++m)
+			if (totals[m].faces > 0.0)
+				printf("%-12s %10.3f %10.3f\n", MESHES[m], totals[m].before / totals[m].faces, totals[m].after / totals[m].faces);
+	}
+
+	if (!csv && sweep == 0)
+	{
+		printf("\n%-12s %10s %10s   (ms to load)\n", "mesh", "xml", "mapped");
+		for (int m = 0; m < MESH_COUNT; ++m)
+			if (loads[m].xml > 0.0)
+				printf("%-12s %10.3f %10.3f\n", MESHES[m], loads[m].xml * 1000.0, loads[m].mapped * 1000.0);
+	}
+
+	if (!csv)
+		printf("\npeak resident %.1f MB\n", peakResidentBytes() / (1024.0 * 1024.0));
+	return 0;
+}
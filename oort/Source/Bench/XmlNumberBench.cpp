@@ -0,0 +1,195 @@
+// Attribute number parsing benchmark. Times tinyxml2's XMLUtil::To* against
+// the sscanf calls they used to be on the same seeded strings, and counts the
+// values where the two disagree. -locale runs both under a locale of choice,
+// e.g. de_DE.UTF-8, where sscanf stops at the '.' of every fraction.
+//
+//   xmlnumberbench [-n values] [-seed s] [-rounds r] [-locale name] [-csv]
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tinyxml2.h"
+
+using namespace tinyxml2;
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The conversions as tinyxml2 had them
+static bool scanInt(const char* str, int* value)
+{
+	return sscanf(str, "%d", value) == 1;
+}
+
+static bool scanUnsigned(const char* str, unsigned* value)
+{
+	return sscanf(str, "%u", value) == 1;
+}
+
+static bool scanBool(const char* str, bool* value)
+{
+	int ival = 0;
+	if (scanInt(str, &ival))
+	{
+		*value = ival != 0;
+		return true;
+	}
+	if (XMLUtil::StringEqual(str, "true"))
+	{
+		*value = true;
+		return true;
+	}
+	if (XMLUtil::StringEqual(str, "false"))
+	{
+		*value = false;
+		return true;
+	}
+	return false;
+}
+
+static bool scanFloat(const char* str, float* value)
+{
+	return sscanf(str, "%f", value) == 1;
+}
+
+static bool scanDouble(const char* str, double* value)
+{
+	return sscanf(str, "%lf", value) == 1;
+}
+
+struct Result
+{
+	double sscanfSeconds;
+	double xmlutilSeconds;
+	size_t differ;
+};
+
+// Best of rounds for each side, then every value through both once more to
+// compare them bit for bit
+template<typename T>
+static Result measure(const std::vector<std::string>& values, int rounds,
+	bool (*before)(const char*, T*), bool (*after)(const char*, T*))
+{
+	Result result = { 1e30, 1e30, 0 };
+	T sink = T();
+	for (int r = 0; r < rounds; ++r)
+	{
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < values.size(); ++i)
+			before(values[i].c_str(), &sink);
+		result.sscanfSeconds = std::min(result.sscanfSeconds, since(start));
+
+		start = Clock::now();
+		for (size_t i = 0; i < values.size(); ++i)
+			after(values[i].c_str(), &sink);
+		result.xmlutilSeconds = std::min(result.xmlutilSeconds, since(start));
+	}
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		T a = T(), b = T();
+		bool okA = before(values[i].c_str(), &a);
+		bool okB = after(values[i].c_str(), &b);
+		if (okA != okB || memcmp(&a, &b, sizeof(T)) != 0)
+			result.differ++;
+	}
+	// Keeps the timed loops from being thrown away
+	volatile T keep = sink;
+	(void)keep;
+	return result;
+}
+
+static void report(const char* kind, size_t count, const Result& result, bool csv)
+{
+	double before = result.sscanfSeconds * 1e9 / count;
+	double after = result.xmlutilSeconds * 1e9 / count;
+	double speedup = after > 0.0 ? before / after : 0.0;
+	if (csv)
+		printf("%s,%zu,%.2f,%.2f,%.2f,%zu\n", kind, count, before, after, speedup, result.differ);
+	else
+		printf("%-10s %10zu %12.2f %12.2f %8.2fx %8zu\n", kind, count, before, after, speedup, result.differ);
+}
+
+int main(int argc, char** argv)
+{
+	int count = 200000;
+	unsigned seed = 1;
+	int rounds = 5;
+	const char* localeName = NULL;
+	bool csv = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool more = i + 1 < argc;
+		if (!strcmp(argv[i], "-n") && more)
+			count = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-seed") && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-rounds") && more)
+			rounds = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-locale") && more)
+			localeName = argv[++i];
+		else if (!strcmp(argv[i], "-csv"))
+			csv = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [-n values] [-seed s] [-rounds r] [-locale name] [-csv]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// What the attributes of the shipped assets look like: indices, counts,
+	// flags, positions and normals with six decimals, and full precision
+	// doubles as ToStr writes them
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> index(-1000000, 1000000);
+	std::uniform_int_distribution<unsigned> count32(0, 0xffffffffu);
+	std::uniform_real_distribution<double> position(-50.0, 50.0);
+	std::uniform_real_distribution<double> wide(-1e6, 1e6);
+	std::vector<std::string> ints, unsigneds, bools, floats, doubles;
+	char buffer[64];
+	for (int i = 0; i < count; ++i)
+	{
+		snprintf(buffer, sizeof(buffer), "%d", index(rng));
+		ints.push_back(buffer);
+		snprintf(buffer, sizeof(buffer), "%u", count32(rng));
+		unsigneds.push_back(buffer);
+		static const char* BOOLS[] = { "true", "false", "1", "0" };
+		bools.push_back(BOOLS[rng() % 4]);
+		snprintf(buffer, sizeof(buffer), "%.6f", position(rng));
+		floats.push_back(buffer);
+		snprintf(buffer, sizeof(buffer), "%.17g", wide(rng));
+		doubles.push_back(buffer);
+	}
+
+	// Only now, the strings are written the way files have them
+	if (localeName && !setlocale(LC_NUMERIC, localeName))
+	{
+		fprintf(stderr, "Unknown locale %s\n", localeName);
+		return 1;
+	}
+
+	if (csv)
+		printf("kind,values,sscanf_ns,xmlutil_ns,speedup,differ\n");
+	else
+	{
+		printf("%d values per kind, seed %u, best of %d, LC_NUMERIC %s\n\n", count, seed, rounds, setlocale(LC_NUMERIC, NULL));
+		printf("%-10s %10s %12s %12s %9s %8s\n", "kind", "values", "sscanf ns", "xmlutil ns", "speedup", "differ");
+	}
+	report("int", ints.size(), measure<int>(ints, rounds, scanInt, XMLUtil::ToInt), csv);
+	report("unsigned", unsigneds.size(), measure<unsigned>(unsigneds, rounds, scanUnsigned, XMLUtil::ToUnsigned), csv);
+	report("bool", bools.size(), measure<bool>(bools, rounds, scanBool, XMLUtil::ToBool), csv);
+	report("float", floats.size(), measure<float>(floats, rounds, scanFloat, XMLUtil::ToFloat), csv);
+	report("double", doubles.size(), measure<double>(doubles, rounds, scanDouble, XMLUtil::ToDouble), csv);
+	return 0;
+}
@@ -1,5 +1,6 @@
 #include "Application.h"
 #include "CoreConfig.h"
+#include "Log.h"
 #include "MultiPlatformHelper.h"
 #include "SceneHelper.h"
 #include <Overlay/OgreOverlaySystem.h>
@@ -20,6 +21,17 @@ using namespace Ogre;
 std::string instructions = "* Press C - change the cameras\n* Press M - mute music\n* Press ESC to quit the game\n* Press W & S control the pitch of the Spaceship\n* Press A & D control the yaw  of the Spaceship\n* Press Q & E control the roll of the Spaceship\n* Press left mouse button to fire laser\n* Press Mouse Scroll to throttle up and down the Spaceship's trust to move it along it's current trajectory";
 
 #define MIN_NUM_ASTEROIDS 20
+#define FRACTURE_BUDGET_MS 2.0
+#define FRACTURE_ORIENTATIONS 24
+#define FRACTURE_LIBRARY_BYTES (8 * 1024 * 1024)
+// Vertex cap of a fragment's collision hull
+#define FRAGMENT_HULL_POINTS 32
+// Caps on all fragments in the scene, past them the oldest and farthest fade out
+#define DEBRIS_MAX_FRAGMENTS 256
+#define DEBRIS_MAX_TRIANGLES 400000
+#define DEBRIS_MAX_BYTES (32 * 1024 * 1024)
+// Cap on slicer lines per second when its trace is turned on
+#define SLICER_LOG_RATE 100
 
 Application::Application():
 	camChange(0),
@@ -39,6 +51,7 @@ void Application::init()
 	try{
 		t1 = new Timer();
 
+		Log::setRateLimit(LOG_SLICER, SLICER_LOG_RATE);
 		
 		srand(time(0));
 
@@ -67,7 +80,7 @@ void Application::init()
 
 	}
 	catch (Exception e) {
-		std::cout << "Exception Caught: " << e.what() << std::endl;
+		LOG_ERROR(LOG_GAME, "Exception caught: " << e.what());
 	}
 
 
@@ -92,20 +105,11 @@ void Application::init()
 
     // std::cout << buffer.str().size();
 
-	mSlicer = new MeshSlicer(NULL);
-	
-	XML_Mesh* ms  = new XML_Mesh;
-	std::string meshfile = "../Assets/Asteroid/Stone_01.mesh.xml";
-	
-	ms->loadFromXMLFile(meshfile);
-	ms->toFile("savedmesh1");
-
-	mSlicer->loadMesh(ms);
-	std::vector<XML_Mesh*> meshes;
-	mSlicer->sliceByPlane(meshes, vec3f(0.0f,0.0f,0.0f), vec3f(0.0f, 0.0f, 1.0f));
-
-
-	meshes[0]->toFile("slicedsavedmesh1");
+	// Asteroids are cut along the laser's plane when they die, within a per-frame slicing budget
+	mFracture = new FractureManager(mSceneManager, _simulator, FRACTURE_BUDGET_MS, FRACTURE_LIBRARY_BYTES, FRAGMENT_HULL_POINTS);
+	mFracture->getDebris()->setLimits(DEBRIS_MAX_FRAGMENTS, DEBRIS_MAX_TRIANGLES, DEBRIS_MAX_BYTES);
+	mFracture->loadSource("Stone_01.mesh", "../Assets/Asteroid/Stone_01.mesh.xml", FRACTURE_ORIENTATIONS);
+	mFracture->loadSource("Stone_04.mesh", "../Assets/Asteroid/Stone_04.mesh.xml", FRACTURE_ORIENTATIONS);
 }
 
 
@@ -165,7 +169,6 @@ bool Application::frameRenderingQueued(const FrameEvent &evt)
 bool Application::update(const FrameEvent &evt) {
 
 	static float dTime = t1->getMilliseconds();
-	static float dTme = t1->getMilliseconds();
 
 	OIS::KeyCode lastKey = _oisManager->lastKeyPressed();
 
@@ -253,25 +256,32 @@ bool Application::update(const FrameEvent &evt) {
 		}
 
 
-		float tmp = t1->getMilliseconds();
-		float ttl = 3000;
 		for (int ai = 0; ai < asteroids.size(); ai++){
 			if(asteroids[ai]->alive){
 				asteroids[ai]->moveAsteroid(_theSpaceship->getNode());
 			}
 			else{
-				if((tmp - dTme) >= ttl){
-					// Delete the asteroid from scene 
+				if(asteroids[ai]->fracturePending){
+					mFracture->requestFracture(asteroids[ai]);
+					asteroids[ai]->fracturePending = false;
+				}
+				// Once its fragments are out they belong to the debris, the
+				// asteroid itself can go
+				if(!mFracture->isPending(asteroids[ai])){
 					Ogre::String entName = asteroids[ai]->getName();
+					mFracture->release(asteroids[ai]);
 					asteroids[ai]->getNode()->detachAllObjects();
 					mSceneManager->destroyEntity(entName);
 					asteroids.erase(asteroids.begin() + ai);
 					ai--;
-					dTme = tmp;
 				}
 			}
 		}
 
+		// Finished fracture jobs come back from the worker threads here, once
+		// per frame, and debris over its caps fades out
+		mFracture->update(evt.timeSinceLastFrame, _theSpaceship->getNode()->getPosition());
+
 		//Spawn new Asteroids
 		if(asteroids.size() <= 5){
 			respawnN ++;
@@ -484,12 +494,14 @@ void Application::clearAsteroids(){
 	{
 		// Delete the asteroid
 		Ogre::String entName = (*i)->getName();
+		mFracture->release(*i);
 		(*i)->getNode()->detachAllObjects();
 		mSceneManager->destroyEntity(entName);
 	}
 
 	// asteroidCount = 0;
 	asteroids.clear();
+	mFracture->getDebris()->clear();
 }
 
 void Application::clearLasers(){
@@ -40,6 +40,8 @@
 #include "Laser.h"
 #include "Asteroid.h"
 #include "MeshSlicer.h"
+#include "MeshBuilder.h"
+#include "FractureManager.h"
 
 
 
@@ -91,7 +93,7 @@ public:
 	std::vector<Asteroid*> asteroids;
 	std::vector<Asteroid*> deadAsteroids;
 
-	MeshSlicer* mSlicer;
+	FractureManager* mFracture;
 
 
 	int points;
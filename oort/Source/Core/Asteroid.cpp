@@ -1,6 +1,7 @@
 #include "Asteroid.h"
 #include "MultiPlatformHelper.h"
 #include "SceneHelper.h"
+#include "Laser.h"
 
 #define MIN_VELOCITY 0.1
 #define MAX_VELOCITY 35.0
@@ -31,6 +32,7 @@ GameObject(nme, tp, scnMgr, ssm, node, ent, ms, sim, mss, rest, frict, scal, kin
 
 	hitWall = false;
 	alive = true;
+	fracturePending = false;
 
 }
 
@@ -64,12 +66,10 @@ void Asteroid::update() {
 				simulator->removeObject(this);
 				this->gameManager->scorePoints(1);
 
-				Ogre::String entNme = this->getName();
-				rootNode->detachAllObjects();
-				int n = rand() % 100;
-				Ogre::Entity* ogreEntity = sceneMgr->createEntity(entNme + "_" + std::to_string(n), "slicedsavedmesh1");
-				ogreEntity->setCastShadows(true);
-				rootNode->attachObject(ogreEntity);
+				// The FractureManager splits the mesh along this plane on its next update
+				Laser* laser = dynamic_cast<Laser*>(context->getTheObject());
+				setFracturePlane(laser ? laser->velocity : Ogre::Vector3::UNIT_Z);
+				fracturePending = true;
 			}
 			if( context->getTheObject()->getType() == GameObject::SPACESHIP_OBJECT && context->getTheObject() != previousHit ) {
 				alive = false;
@@ -88,6 +88,23 @@ void Asteroid::update() {
 	}
 }
 
+// Cut plane through the contact point that contains the laser's direction of travel,
+// stored in mesh space so the slicer can use it as is
+void Asteroid::setFracturePlane(const Ogre::Vector3& laserDir) {
+	btVector3 p = context->point;
+	btVector3 n = context->normal;
+
+	Ogre::Vector3 dir = laserDir.normalisedCopy();
+	Ogre::Vector3 planeNormal = dir.crossProduct(Ogre::Vector3(n.x(), n.y(), n.z()));
+	if (planeNormal.squaredLength() < 1e-6f)
+		planeNormal = dir.perpendicular();
+	planeNormal.normalise();
+
+	// context->point is already local to this body, which is unscaled unlike the mesh
+	hitPoint = Ogre::Vector3(p.x(), p.y(), p.z()) / scale;
+	hitNormal = rootNode->getOrientation().Inverse() * planeNormal;
+}
+
 void Asteroid::moveAsteroid(Ogre::SceneNode* ssNode) {
 
 	Ogre::SceneNode* mNode = rootNode;
@@ -15,6 +15,12 @@ public:
 
 	// bool alive;
 
+	// Set when a laser kills the asteroid, plane is in mesh space
+	bool fracturePending;
+	Ogre::Vector3 hitPoint;
+	Ogre::Vector3 hitNormal;
+
 	virtual void update();
 	void moveAsteroid(Ogre::SceneNode* ssNode);
+	void setFracturePlane(const Ogre::Vector3& laserDir);
 };
\ No newline at end of file
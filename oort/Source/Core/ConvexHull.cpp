@@ -0,0 +1,373 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct HullFace
+{
+	int v[3];
+	// Face across edge v[e] -> v[e+1]
+	int adj[3];
+	// Plane in double, slivers from nearly collinear horizon edges would
+	// get noisy normals in float
+	double n[3];
+	double d;
+	// Points above this face, and the farthest of them
+	std::vector<int> outside;
+	int far;
+	float farDist;
+	bool alive;
+	int visited;
+};
+
+}
+
+static inline vec3f sub(const vec3f& a, const vec3f& b)
+{
+	return vec3f(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline vec3f cross(const vec3f& a, const vec3f& b)
+{
+	return vec3f(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+}
+
+static inline float dot(const vec3f& a, const vec3f& b)
+{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static HullFace makeFace(const std::vector<vec3f>& points, int a, int b, int c)
+{
+	HullFace f;
+	f.v[0] = a;
+	f.v[1] = b;
+	f.v[2] = c;
+	f.adj[0] = f.adj[1] = f.adj[2] = -1;
+	const vec3f& p = points[a];
+	const vec3f& q = points[b];
+	const vec3f& r = points[c];
+	double u[3] = { (double)q.x - p.x, (double)q.y - p.y, (double)q.z - p.z };
+	double w[3] = { (double)r.x - p.x, (double)r.y - p.y, (double)r.z - p.z };
+	f.n[0] = u[1] * w[2] - u[2] * w[1];
+	f.n[1] = u[2] * w[0] - u[0] * w[2];
+	f.n[2] = u[0] * w[1] - u[1] * w[0];
+	double len = sqrt(f.n[0] * f.n[0] + f.n[1] * f.n[1] + f.n[2] * f.n[2]);
+	// A degenerate face gets no normal, nothing is ever above it
+	for (int k = 0; k < 3; ++k)
+		f.n[k] = len > 0.0 ? f.n[k] / len : 0.0;
+	// Through the centroid, which averages out the rounding of the corners
+	f.d = -(f.n[0] * ((double)p.x + q.x + r.x) + f.n[1] * ((double)p.y + q.y + r.y) + f.n[2] * ((double)p.z + q.z + r.z)) / 3.0;
+	f.far = -1;
+	f.farDist = 0.0f;
+	f.alive = true;
+	f.visited = -1;
+	return f;
+}
+
+static inline float distance(const HullFace& f, const vec3f& p)
+{
+	return (float)(f.n[0] * p.x + f.n[1] * p.y + f.n[2] * p.z + f.d);
+}
+
+// Hands point i to the first face from first on that it is above; points
+// above none of them are inside the hull
+static void assign(std::vector<HullFace>& faces, size_t first, const std::vector<vec3f>& points, int i, float eps)
+{
+	for (size_t k = first; k < faces.size(); ++k)
+	{
+		float d = distance(faces[k], points[i]);
+		if (d > eps)
+		{
+			faces[k].outside.push_back(i);
+			if (d > faces[k].farDist)
+			{
+				faces[k].farDist = d;
+				faces[k].far = i;
+			}
+			return;
+		}
+	}
+}
+
+// Drops point i from the outside set of face f
+static void dropOutside(HullFace& f, const std::vector<vec3f>& points, int i)
+{
+	f.outside.erase(std::remove(f.outside.begin(), f.outside.end(), i), f.outside.end());
+	f.far = -1;
+	f.farDist = 0.0f;
+	for (size_t k = 0; k < f.outside.size(); ++k)
+	{
+		float d = distance(f, points[f.outside[k]]);
+		if (d > f.farDist)
+		{
+			f.farDist = d;
+			f.far = f.outside[k];
+		}
+	}
+}
+
+// Points f's edge from a to b at face g
+static void link(HullFace& f, int a, int b, int g)
+{
+	for (int e = 0; e < 3; ++e)
+		if (f.v[e] == a && f.v[(e + 1) % 3] == b)
+			f.adj[e] = g;
+}
+
+bool buildConvexHull(const std::vector<vec3f>& points, int maxPoints, ConvexHull& hull)
+{
+	hull.points.clear();
+	hull.faces.clear();
+	int count = (int)points.size();
+	if (count < 4)
+		return false;
+
+	// Extreme points along each axis
+	int ext[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 1; i < count; ++i)
+	{
+		const vec3f& p = points[i];
+		if (p.x < points[ext[0]].x) ext[0] = i;
+		if (p.x > points[ext[1]].x) ext[1] = i;
+		if (p.y < points[ext[2]].y) ext[2] = i;
+		if (p.y > points[ext[3]].y) ext[3] = i;
+		if (p.z < points[ext[4]].z) ext[4] = i;
+		if (p.z > points[ext[5]].z) ext[5] = i;
+	}
+	float extent = std::max(points[ext[1]].x - points[ext[0]].x,
+		std::max(points[ext[3]].y - points[ext[2]].y, points[ext[5]].z - points[ext[4]].z));
+	if (extent <= 0.0f)
+		return false;
+	float eps = 1e-5f * extent;
+
+	// Initial tetrahedron: the farthest pair of extremes, the point farthest
+	// from their line, then the one farthest from that plane
+	int t[4] = { ext[0], ext[1], -1, -1 };
+	float best = 0.0f;
+	for (int a = 0; a < 6; ++a)
+		for (int b = a + 1; b < 6; ++b)
+		{
+			vec3f e = sub(points[ext[b]], points[ext[a]]);
+			if (dot(e, e) > best)
+			{
+				best = dot(e, e);
+				t[0] = ext[a];
+				t[1] = ext[b];
+			}
+		}
+
+	vec3f axis = sub(points[t[1]], points[t[0]]);
+	best = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		vec3f c = cross(axis, sub(points[i], points[t[0]]));
+		if (dot(c, c) > best)
+		{
+			best = dot(c, c);
+			t[2] = i;
+		}
+	}
+	if (t[2] < 0 || sqrt(best) < eps * sqrt(dot(axis, axis)))
+		return false;
+
+	vec3f normal = cross(axis, sub(points[t[2]], points[t[0]]));
+	float nlen = sqrt(dot(normal, normal));
+	best = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		float d = fabs(dot(normal, sub(points[i], points[t[0]]))) / nlen;
+		if (d > best)
+		{
+			best = d;
+			t[3] = i;
+		}
+	}
+	if (t[3] < 0 || best < eps)
+		return false;
+
+	// Wound so the base's normal points away from the apex, the sides follow
+	if (dot(normal, sub(points[t[3]], points[t[0]])) > 0.0f)
+		std::swap(t[1], t[2]);
+	std::vector<HullFace> faces;
+	faces.push_back(makeFace(points, t[0], t[1], t[2]));
+	faces.push_back(makeFace(points, t[0], t[3], t[1]));
+	faces.push_back(makeFace(points, t[1], t[3], t[2]));
+	faces.push_back(makeFace(points, t[2], t[3], t[0]));
+	for (int f = 0; f < 4; ++f)
+		for (int g = 0; g < 4; ++g)
+			if (f != g)
+				for (int e = 0; e < 3; ++e)
+					link(faces[f], faces[g].v[(e + 1) % 3], faces[g].v[e], g);
+
+	for (int i = 0; i < count; ++i)
+		if (i != t[0] && i != t[1] && i != t[2] && i != t[3])
+			assign(faces, 0, points, i, eps);
+
+	int hullCount = 4;
+	std::vector<int> visible, horizon;
+	std::vector<int> orphans;
+	// Horizon edge starting at a vertex -> its cone face
+	EdgeMap coneAt;
+	std::vector<int> vertexSeen(count, -1);
+
+	for (int round = 0; ; ++round)
+	{
+		if (maxPoints > 0 && hullCount >= maxPoints)
+			break;
+
+		// Farthest outside point over all faces, so a capped hull keeps the
+		// points that stick out most
+		int seed = -1;
+		for (size_t k = 0; k < faces.size(); ++k)
+			if (faces[k].alive && faces[k].far >= 0 && (seed < 0 || faces[k].farDist > faces[seed].farDist))
+				seed = (int)k;
+		if (seed < 0)
+			break;
+		int eye = faces[seed].far;
+		const vec3f& p = points[eye];
+
+		// Faces the eye sees, grown from the seed; the edges to faces it
+		// does not see are the horizon, kept as (face, edge) pairs. Any face
+		// the eye is above counts, one within eps kept would lean the cone
+		// over it and leave the hull concave there.
+		visible.clear();
+		horizon.clear();
+		visible.push_back(seed);
+		faces[seed].visited = round;
+		for (size_t q = 0; q < visible.size(); ++q)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				int other = faces[visible[q]].adj[e];
+				if (faces[other].visited == round)
+					continue;
+				if (distance(faces[other], p) > 0.0f)
+				{
+					faces[other].visited = round;
+					visible.push_back(other);
+				}
+			}
+		}
+		for (size_t q = 0; q < visible.size(); ++q)
+			for (int e = 0; e < 3; ++e)
+				if (faces[faces[visible[q]].adj[e]].visited != round)
+				{
+					horizon.push_back(visible[q]);
+					horizon.push_back(e);
+				}
+
+		// Rounding can make the visible faces something other than a disk,
+		// then the horizon is not one loop. That point is left out.
+		coneAt.clear(horizon.size());
+		bool loop = true;
+		size_t first = faces.size();
+		for (size_t h = 0; h < horizon.size() && loop; h += 2)
+		{
+			int a = faces[horizon[h]].v[horizon[h + 1]];
+			loop = coneAt.insert((unsigned long long)a, (int)(first + h / 2)) == (int)(first + h / 2);
+		}
+		if (!loop)
+		{
+			dropOutside(faces[seed], points, eye);
+			continue;
+		}
+
+		// Vertices only the visible faces used are no longer on the hull
+		for (size_t h = 0; h < horizon.size(); h += 2)
+			vertexSeen[faces[horizon[h]].v[horizon[h + 1]]] = round;
+		vertexSeen[eye] = round;
+		hullCount++;
+		for (size_t q = 0; q < visible.size(); ++q)
+			for (int e = 0; e < 3; ++e)
+			{
+				int v = faces[visible[q]].v[e];
+				if (vertexSeen[v] != round)
+				{
+					vertexSeen[v] = round;
+					hullCount--;
+				}
+			}
+
+		// Cone from the horizon to the eye, keeping the horizon's winding
+		for (size_t h = 0; h < horizon.size(); h += 2)
+		{
+			const HullFace& f = faces[horizon[h]];
+			int e = horizon[h + 1];
+			int a = f.v[e], b = f.v[(e + 1) % 3], outer = f.adj[e];
+			int cone = (int)faces.size();
+			faces.push_back(makeFace(points, a, b, eye));
+			faces[cone].adj[0] = outer;
+			link(faces[outer], b, a, cone);
+		}
+		for (size_t k = first; k < faces.size(); ++k)
+		{
+			int next = -1;
+			coneAt.find((unsigned long long)faces[k].v[1], next);
+			faces[k].adj[1] = next;
+			faces[next].adj[2] = (int)k;
+		}
+
+		orphans.clear();
+		for (size_t q = 0; q < visible.size(); ++q)
+		{
+			HullFace& f = faces[visible[q]];
+			for (size_t i = 0; i < f.outside.size(); ++i)
+				if (f.outside[i] != eye)
+					orphans.push_back(f.outside[i]);
+			f.alive = false;
+			std::vector<int>().swap(f.outside);
+			f.far = -1;
+		}
+		for (size_t i = 0; i < orphans.size(); ++i)
+			assign(faces, first, points, orphans[i], eps);
+	}
+
+	// Compact to the points the hull uses
+	std::vector<int> remap(count, -1);
+	for (size_t k = 0; k < faces.size(); ++k)
+	{
+		if (!faces[k].alive)
+			continue;
+		int idx[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			int& r = remap[faces[k].v[e]];
+			if (r < 0)
+			{
+				r = (int)hull.points.size();
+				hull.points.push_back(points[faces[k].v[e]]);
+			}
+			idx[e] = r;
+		}
+		hull.faces.push_back(vec3i(idx[0], idx[1], idx[2]));
+	}
+	return true;
+}
+
+float hullVolume(const ConvexHull& hull, vec3f* centroid)
+{
+	float volume = 0.0f;
+	vec3f sum(0.0f);
+	if (!hull.points.empty())
+	{
+		// Tetrahedra from the first point, which is on the hull
+		const vec3f& o = hull.points[0];
+		for (size_t k = 0; k < hull.faces.size(); ++k)
+		{
+			const vec3f& a = hull.points[hull.faces[k].x];
+			const vec3f& b = hull.points[hull.faces[k].y];
+			const vec3f& c = hull.points[hull.faces[k].z];
+			float v = dot(sub(a, o), cross(sub(b, o), sub(c, o))) / 6.0f;
+			volume += v;
+			sum = vec3f(sum.x + v * (o.x + a.x + b.x + c.x) / 4.0f,
+				sum.y + v * (o.y + a.y + b.y + c.y) / 4.0f,
+				sum.z + v * (o.z + a.z + b.z + c.z) / 4.0f);
+		}
+	}
+	if (centroid)
+		*centroid = volume > 0.0f ? vec3f(sum.x / volume, sum.y / volume, sum.z / volume) : vec3f(0.0f);
+	return volume;
+}
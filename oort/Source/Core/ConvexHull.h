@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Convex hull of a point cloud, faces wound counter clockwise seen from outside
+struct ConvexHull
+{
+	std::vector<vec3f> points;
+	std::vector<vec3i> faces;
+};
+
+// Quickhull. Points are added farthest first, so stopping once the hull has
+// maxPoints vertices keeps the ones that matter most for its shape; whatever
+// is left outside is at most as far out as the last point added. maxPoints
+// of 0 builds the full hull. False when the points span no volume.
+bool buildConvexHull(const std::vector<vec3f>& points, int maxPoints, ConvexHull& hull);
+
+// Volume and centroid of a closed hull
+float hullVolume(const ConvexHull& hull, vec3f* centroid = NULL);
@@ -0,0 +1,214 @@
+#include "DebrisManager.h"
+#include "MeshBuilder.h"
+
+#include <OgreSubMesh.h>
+
+// Default caps, roughly a hundred sliced asteroids' worth of pieces
+static const int DEFAULT_MAX_FRAGMENTS = 256;
+static const size_t DEFAULT_MAX_TRIANGLES = 400000;
+static const size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+static const float DEFAULT_FADE_SECONDS = 0.5f;
+// World units away from the viewer that count as one second of age
+static const float UNITS_PER_SECOND = 500.0f;
+
+// Vertex and index bytes of a mesh built by MeshBuilder
+static size_t bufferBytes(const Ogre::MeshPtr& mesh)
+{
+	size_t bytes = 0;
+	if (mesh->sharedVertexData)
+		bytes += mesh->sharedVertexData->vertexCount * mesh->sharedVertexData->vertexDeclaration->getVertexSize(0);
+	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); ++i)
+	{
+		const Ogre::SubMesh* sub = mesh->getSubMesh(i);
+		if (!sub->useSharedVertices && sub->vertexData)
+			bytes += sub->vertexData->vertexCount * sub->vertexData->vertexDeclaration->getVertexSize(0);
+		if (!sub->indexData->indexBuffer.isNull())
+			bytes += sub->indexData->indexCount * sub->indexData->indexBuffer->getIndexSize();
+	}
+	return bytes;
+}
+
+static size_t triangleCount(const Ogre::MeshPtr& mesh)
+{
+	size_t count = 0;
+	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); ++i)
+		count += mesh->getSubMesh(i)->indexData->indexCount / 3;
+	return count;
+}
+
+DebrisManager::DebrisManager(Ogre::SceneManager* scnMgr, Simulator* sim, HullCache* hullCache) :
+	sceneMgr(scnMgr), simulator(sim), hulls(hullCache),
+	maxFragments(DEFAULT_MAX_FRAGMENTS), maxTriangles(DEFAULT_MAX_TRIANGLES), maxBytes(DEFAULT_MAX_BYTES),
+	fadeTime(DEFAULT_FADE_SECONDS), now(0.0), live(0), triangles(0), bytes(0), evicted(0)
+{
+}
+
+DebrisManager::~DebrisManager()
+{
+	clear();
+}
+
+void DebrisManager::setLimits(int fragments, size_t tris, size_t byteCap)
+{
+	maxFragments = fragments;
+	maxTriangles = tris;
+	maxBytes = byteCap;
+}
+
+void DebrisManager::setFadeTime(float seconds)
+{
+	fadeTime = seconds;
+}
+
+void DebrisManager::add(Ogre::Entity* entity, Ogre::SceneNode* node, btRigidBody* body, bool ownsMesh)
+{
+	Debris d;
+	d.entity = entity;
+	d.node = node;
+	d.body = body;
+	d.mesh = entity->getMesh()->getName();
+	d.ownsMesh = ownsMesh;
+	d.triangles = triangleCount(entity->getMesh());
+	d.bytes = 0;
+	if (ownsMesh)
+	{
+		d.bytes = bufferBytes(entity->getMesh());
+		// Manual LOD levels are meshes of their own
+		for (unsigned short i = 1; i < entity->getMesh()->getNumLodLevels(); ++i)
+		{
+			const Ogre::String& lod = entity->getMesh()->getLodLevel(i).manualName;
+			Ogre::MeshPtr level = Ogre::MeshManager::getSingleton().getByName(lod);
+			if (!level.isNull())
+				d.bytes += bufferBytes(level);
+		}
+	}
+	d.born = now;
+	d.fade = -1.0f;
+	d.scale = node->getScale();
+	debris.push_back(d);
+
+	live++;
+	triangles += d.triangles;
+	bytes += d.bytes;
+}
+
+bool DebrisManager::overLimits() const
+{
+	return (maxFragments > 0 && live > maxFragments)
+		|| (maxTriangles > 0 && triangles > maxTriangles)
+		|| (maxBytes > 0 && bytes > maxBytes);
+}
+
+void DebrisManager::update(float seconds, const Ogre::Vector3& viewer)
+{
+	now += seconds;
+
+	while (overLimits())
+	{
+		int worst = -1;
+		double worstScore = 0.0;
+		for (size_t i = 0; i < debris.size(); ++i)
+		{
+			const Debris& d = debris[i];
+			if (d.fade >= 0.0f)
+				continue;
+			double score = (now - d.born) + d.node->_getDerivedPosition().distance(viewer) / UNITS_PER_SECOND;
+			if (worst < 0 || score > worstScore)
+			{
+				worst = (int)i;
+				worstScore = score;
+			}
+		}
+		if (worst < 0)
+			break;
+		startFade(debris[worst]);
+	}
+
+	for (size_t i = 0; i < debris.size(); )
+	{
+		Debris& d = debris[i];
+		if (d.fade < 0.0f)
+		{
+			++i;
+			continue;
+		}
+		d.fade += seconds;
+		if (d.fade >= fadeTime)
+		{
+			destroy(d);
+			debris[i] = debris.back();
+			debris.pop_back();
+			continue;
+		}
+		d.node->setScale(d.scale * (1.0f - d.fade / fadeTime));
+		++i;
+	}
+}
+
+void DebrisManager::clear()
+{
+	for (size_t i = 0; i < debris.size(); ++i)
+		destroy(debris[i]);
+	debris.clear();
+	live = 0;
+	triangles = 0;
+	bytes = 0;
+}
+
+int DebrisManager::getCount() const
+{
+	return live;
+}
+
+size_t DebrisManager::getTriangles() const
+{
+	return triangles;
+}
+
+size_t DebrisManager::getBytes() const
+{
+	return bytes;
+}
+
+int DebrisManager::getEvicted() const
+{
+	return evicted;
+}
+
+void DebrisManager::startFade(Debris& d)
+{
+	// Stops colliding at once, the shrinking piece stays where it was
+	removeBody(d);
+	d.fade = 0.0f;
+	live--;
+	triangles -= d.triangles;
+	bytes -= d.bytes;
+	evicted++;
+}
+
+void DebrisManager::removeBody(Debris& d)
+{
+	if (!d.body)
+		return;
+	simulator->removeBody(d.body);
+	// The hull sits in a compound, behind a wrapper carrying the node's scale
+	btCompoundShape* shape = static_cast<btCompoundShape*>(d.body->getCollisionShape());
+	delete shape->getChildShape(0);
+	delete shape;
+	delete d.body->getMotionState();
+	delete d.body;
+	d.body = NULL;
+}
+
+void DebrisManager::destroy(Debris& d)
+{
+	removeBody(d);
+	d.entity->detachFromParent();
+	sceneMgr->destroyEntity(d.entity);
+	sceneMgr->destroySceneNode(d.node);
+	if (d.ownsMesh)
+	{
+		hulls->release(d.mesh);
+		MeshBuilder::destroyMesh(d.mesh);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <OgreSceneManager.h>
+#include <OgreEntity.h>
+
+#include <vector>
+
+#include "HullCache.h"
+#include "Simulator.h"
+
+// Owns every fragment in the scene, its entity, node and rigid body, and
+// keeps their total count, triangles and mesh bytes under fixed caps. Going
+// over a cap evicts the fragment that is oldest, counting distance from the
+// viewer as extra age, so far pieces go before near ones of the same age.
+// Evicted pieces leave the simulation at once and shrink away over a short
+// fade before they are destroyed.
+class DebrisManager {
+public:
+	DebrisManager(Ogre::SceneManager* scnMgr, Simulator* sim, HullCache* hullCache);
+	~DebrisManager();
+
+	// 0 lifts a cap
+	void setLimits(int maxFragments, size_t maxTriangles, size_t maxBytes);
+	void setFadeTime(float seconds);
+
+	// Takes the fragment over. The mesh only counts against the byte cap, and
+	// is destroyed along with its hull, when ownsMesh is set; shared meshes
+	// like the precomputed halves stay with their owner. body may be NULL.
+	void add(Ogre::Entity* entity, Ogre::SceneNode* node, btRigidBody* body, bool ownsMesh);
+
+	// Evicts down to the caps and advances the fades, distances are measured
+	// from viewer
+	void update(float seconds, const Ogre::Vector3& viewer);
+
+	// Destroys every fragment at once, fading or not
+	void clear();
+
+	// Fragments that are not fading, and their triangles and bytes
+	int getCount() const;
+	size_t getTriangles() const;
+	size_t getBytes() const;
+	int getEvicted() const;
+
+private:
+	struct Debris {
+		Ogre::Entity* entity;
+		Ogre::SceneNode* node;
+		btRigidBody* body;
+		Ogre::String mesh;
+		bool ownsMesh;
+		size_t triangles;
+		size_t bytes;
+		double born;
+		// Seconds into the fade, negative while the piece is live
+		float fade;
+		Ogre::Vector3 scale;
+	};
+
+	Ogre::SceneManager* sceneMgr;
+	Simulator* simulator;
+	HullCache* hulls;
+
+	std::vector<Debris> debris;
+	int maxFragments;
+	size_t maxTriangles;
+	size_t maxBytes;
+	float fadeTime;
+	double now;
+
+	int live;
+	size_t triangles;
+	size_t bytes;
+	int evicted;
+
+	bool overLimits() const;
+	void startFade(Debris& d);
+	void removeBody(Debris& d);
+	void destroy(Debris& d);
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+static const unsigned long long EDGE_MAP_EMPTY = ~0ull;
+
+// Open addressing hash from 64 bit keys to ints, for the slicer's cut edge
+// and weld lookups. clear() keeps the table, so once it has grown to fit a
+// mesh, refilling it never touches the heap. ~0 is reserved as the empty key.
+class EdgeMap {
+public:
+	EdgeMap() : mask(0), count(0) {}
+
+	// Empties the map and makes room for at least expected keys
+	void clear(size_t expected = 0)
+	{
+		size_t size = 16;
+		while (size < expected * 2)
+			size <<= 1;
+		if (keys.size() < size)
+		{
+			keys.resize(size);
+			values.resize(size);
+		}
+		std::fill(keys.begin(), keys.end(), EDGE_MAP_EMPTY);
+		mask = keys.size() - 1;
+		count = 0;
+	}
+
+	// Value stored under key, inserting value first when the key is new
+	int insert(unsigned long long key, int value)
+	{
+		if ((count + 1) * 2 > keys.size())
+			grow();
+
+		size_t i = hash(key) & mask;
+		while (keys[i] != EDGE_MAP_EMPTY)
+		{
+			if (keys[i] == key)
+				return values[i];
+			i = (i + 1) & mask;
+		}
+		keys[i] = key;
+		values[i] = value;
+		count++;
+		return value;
+	}
+
+	bool find(unsigned long long key, int& value) const
+	{
+		if (keys.empty())
+			return false;
+
+		size_t i = hash(key) & mask;
+		while (keys[i] != EDGE_MAP_EMPTY)
+		{
+			if (keys[i] == key)
+			{
+				value = values[i];
+				return true;
+			}
+			i = (i + 1) & mask;
+		}
+		return false;
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+private:
+	std::vector<unsigned long long> keys;
+	std::vector<int> values;
+	size_t mask;
+	size_t count;
+
+	static size_t hash(unsigned long long key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return (size_t)key;
+	}
+
+	void grow()
+	{
+		std::vector<unsigned long long> oldKeys;
+		std::vector<int> oldValues;
+		oldKeys.swap(keys);
+		oldValues.swap(values);
+
+		size_t size = std::max<size_t>(16, oldKeys.size() * 2);
+		keys.assign(size, EDGE_MAP_EMPTY);
+		values.resize(size);
+		mask = size - 1;
+		count = 0;
+		for (size_t i = 0; i < oldKeys.size(); ++i)
+			if (oldKeys[i] != EDGE_MAP_EMPTY)
+				insert(oldKeys[i], oldValues[i]);
+	}
+};
@@ -0,0 +1,175 @@
+#include "FractureLibrary.h"
+#include "MeshBuilder.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Bytes a half takes once MeshBuilder uploaded it
+static size_t meshBytes(const XML_Mesh& mesh)
+{
+	size_t index = mesh.fitsIn16BitIndices() ? 2 : 4;
+	return mesh.verts.size() * 8 * sizeof(float) + mesh.faces.size() * 3 * index;
+}
+
+static size_t hullBytes(const ConvexHull& hull)
+{
+	return hull.points.size() * sizeof(vec3f) + hull.faces.size() * sizeof(vec3i);
+}
+
+// A plane and its flipped twin make the same cut, keep the one facing +z
+static vec3f canonical(const vec3f& n)
+{
+	float l = sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+	vec3f c(n.x / l, n.y / l, n.z / l);
+	bool flip = c.z < 0.0f || (c.z == 0.0f && (c.y < 0.0f || (c.y == 0.0f && c.x < 0.0f)));
+	return flip ? vec3f(-c.x, -c.y, -c.z) : c;
+}
+
+FractureLibrary::FractureLibrary(size_t budgetBytes, int hullPoints) :
+	budget(budgetBytes), used(0), hullPoints(hullPoints)
+{
+}
+
+FractureLibrary::~FractureLibrary()
+{
+	for (std::map<Ogre::String, Fractures>::iterator m = library.begin(); m != library.end(); ++m)
+		for (Fractures::iterator f = m->second.begin(); f != m->second.end(); ++f)
+			for (int i = 0; i < 2; ++i)
+				MeshBuilder::destroyMesh(f->second.meshes[i]);
+}
+
+// Octahedral projection of the upper hemisphere, 8 bits per axis
+unsigned int FractureLibrary::quantize(const vec3f& normal)
+{
+	vec3f n = canonical(normal);
+	float s = fabs(n.x) + fabs(n.y) + n.z;
+	unsigned int qx = (unsigned int)floor((n.x / s * 0.5f + 0.5f) * 255.0f + 0.5f);
+	unsigned int qy = (unsigned int)floor((n.y / s * 0.5f + 0.5f) * 255.0f + 0.5f);
+	return qx << 8 | qy;
+}
+
+void FractureLibrary::setLodChain(const std::vector<float>& ratios, const std::vector<float>& distances)
+{
+	lodRatios = ratios;
+	lodDistances = distances;
+}
+
+int FractureLibrary::build(const Ogre::String& meshName, XML_Mesh& mesh, int orientations, MeshSlicer& slicer, MeshSimplifier& simplifier, MeshOptimizer& optimizer)
+{
+	if (mesh.verts.empty())
+		return 0;
+
+	vec3f lo = mesh.verts[0], hi = mesh.verts[0];
+	for (size_t i = 1; i < mesh.verts.size(); ++i)
+	{
+		const vec3f& p = mesh.verts[i];
+		lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	vec3f centre((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+
+	Fractures& fractures = library[meshName];
+	slicer.loadMesh(&mesh);
+
+	int added = 0;
+	const float golden = 2.39996323f;
+	for (int i = 0; i < orientations; ++i)
+	{
+		// Fibonacci spiral over the hemisphere, evenly spread for any count
+		float z = 1.0f - (i + 0.5f) / orientations;
+		float r = sqrt(1.0f - z*z);
+		vec3f n(r * cos(golden * i), r * sin(golden * i), z);
+
+		unsigned int key = quantize(n);
+		if (fractures.count(key))
+			continue;
+
+		std::vector<XML_Mesh*> halves;
+		slicer.sliceByPlane(halves, centre, n);
+
+		Entry entry;
+		std::vector<LodLevel> lods[2];
+		size_t bytes = 0;
+		for (int h = 0; h < 2; ++h)
+		{
+			if (hullPoints > 0)
+				buildConvexHull(halves[h]->verts, hullPoints, entry.hulls[h]);
+			computeMassProperties(*halves[h], entry.mass[h]);
+			if (!halves[h]->faces.empty())
+				simplifier.buildLodChain(*halves[h], lodRatios, lods[h]);
+
+			bytes += meshBytes(*halves[h]) + hullBytes(entry.hulls[h]);
+			for (size_t l = 0; l < lods[h].size(); ++l)
+				bytes += meshBytes(*lods[h][l].mesh);
+		}
+
+		bool fits = used + bytes <= budget;
+		if (fits && !halves[0]->faces.empty() && !halves[1]->faces.empty())
+		{
+			entry.normal = canonical(n);
+			entry.bytes = bytes;
+			for (int h = 0; h < 2; ++h)
+			{
+				CacheStats stats = optimizer.optimize(*halves[h]);
+				for (size_t l = 0; l < lods[h].size(); ++l)
+					optimizer.optimize(*lods[h][l].mesh);
+				LOG_DEBUG(LOG_MESH, meshName << " fracture " << key << " half " << h << " ACMR "
+					<< stats.acmrBefore << " -> " << stats.acmrAfter);
+				entry.meshes[h] = meshName + "_lib_" + std::to_string(key) + "_" + std::to_string(h);
+				MeshBuilder::createMesh(*halves[h], entry.meshes[h]);
+				MeshBuilder::addLodLevels(entry.meshes[h], lods[h], lodDistances);
+			}
+			fractures[key] = entry;
+			used += bytes;
+			added++;
+		}
+		for (int h = 0; h < 2; ++h)
+		{
+			for (size_t l = 0; l < lods[h].size(); ++l)
+				delete lods[h][l].mesh;
+			delete halves[h];
+		}
+
+		if (!fits)
+			break;
+	}
+	return added;
+}
+
+const FractureLibrary::Entry* FractureLibrary::closest(const Ogre::String& meshName, const vec3f& normal) const
+{
+	std::map<Ogre::String, Fractures>::const_iterator m = library.find(meshName);
+	if (m == library.end() || m->second.empty())
+		return NULL;
+
+	Fractures::const_iterator exact = m->second.find(quantize(normal));
+	if (exact != m->second.end())
+		return &exact->second;
+
+	// Only a few dozen orientations per mesh, a scan is cheaper than anything smarter
+	vec3f n = canonical(normal);
+	const Entry* best = NULL;
+	float bestDot = -1.0f;
+	for (Fractures::const_iterator f = m->second.begin(); f != m->second.end(); ++f)
+	{
+		const vec3f& e = f->second.normal;
+		float d = fabs(n.x*e.x + n.y*e.y + n.z*e.z);
+		if (d > bestDot)
+		{
+			bestDot = d;
+			best = &f->second;
+		}
+	}
+	return best;
+}
+
+size_t FractureLibrary::getBudget() const
+{
+	return budget;
+}
+
+size_t FractureLibrary::getUsed() const
+{
+	return used;
+}
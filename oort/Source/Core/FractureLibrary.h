@@ -0,0 +1,62 @@
+#pragma once
+
+#include <OgrePrerequisites.h>
+
+#include <map>
+#include <vector>
+
+#include "MeshSlicer.h"
+#include "ConvexHull.h"
+#include "MassProperties.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+// Fractures precomputed at load. Each mesh is cut through its centre along a
+// spread of plane orientations and the halves are kept as Ogre meshes, keyed
+// by the quantized plane normal. A hit then only has to pick the closest one,
+// which costs next to nothing on machines that cannot afford to slice.
+class FractureLibrary {
+public:
+	struct Entry {
+		vec3f normal;
+		Ogre::String meshes[2];
+		// Collision hulls of the halves, empty when built without
+		ConvexHull hulls[2];
+		MassProperties mass[2];
+		size_t bytes;
+	};
+
+	// budgetBytes caps the vertex and index data of all stored halves and
+	// their hulls, which get at most hullPoints vertices, none when 0
+	FractureLibrary(size_t budgetBytes, int hullPoints);
+	~FractureLibrary();
+
+	// Halves built from here on get manual LOD levels at these face ratios
+	// and distances, which count against the budget too
+	void setLodChain(const std::vector<float>& ratios, const std::vector<float>& distances);
+
+	// Cuts mesh along orientations normals over a hemisphere, stopping early
+	// once the budget is spent. Halves and their levels are reordered for the
+	// vertex cache before they become Ogre meshes. Returns how many
+	// fractures were stored.
+	int build(const Ogre::String& meshName, XML_Mesh& mesh, int orientations, MeshSlicer& slicer, MeshSimplifier& simplifier, MeshOptimizer& optimizer);
+
+	// Stored fracture of meshName with the normal closest to normal (mesh
+	// space, either sign), NULL when nothing was built for the mesh
+	const Entry* closest(const Ogre::String& meshName, const vec3f& normal) const;
+
+	size_t getBudget() const;
+	size_t getUsed() const;
+
+	static unsigned int quantize(const vec3f& normal);
+
+private:
+	typedef std::map<unsigned int, Entry> Fractures;
+
+	std::map<Ogre::String, Fractures> library;
+	size_t budget;
+	size_t used;
+	int hullPoints;
+	std::vector<float> lodRatios;
+	std::vector<float> lodDistances;
+};
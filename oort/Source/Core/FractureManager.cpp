@@ -0,0 +1,312 @@
+#include "FractureManager.h"
+#include "Log.h"
+#include "MeshBuilder.h"
+#include "OgreMotionState.h"
+
+#include <algorithm>
+#include <thread>
+
+// Jobs in flight before hits fall back to precomputed fragments
+static const size_t MAX_FRACTURE_JOBS = 64;
+
+// Debris is left out of the game objects' contact tests, whose callbacks
+// expect a GameObject behind every body they touch
+static const short DEBRIS_GROUP = btBroadphaseProxy::DebrisFilter;
+static const short DEBRIS_MASK = btBroadphaseProxy::DebrisFilter | btBroadphaseProxy::StaticFilter;
+
+// Mass per cubic world unit, puts an asteroid's halves at around a hundred
+static const float FRAGMENT_DENSITY = 1e-6f;
+// Speed pieces drift apart at, away from the asteroid's centre
+static const float FRAGMENT_SEPARATION = 150.0f;
+
+// Face ratios of the LOD levels and the camera distances they take over from
+static const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f };
+static const float LOD_DISTANCES[] = { 3000.0f, 6000.0f, 10000.0f };
+
+static void freeResult(FractureService::Result& result)
+{
+	result.fragments.clear();
+	result.lods.clear();
+}
+
+FractureManager::FractureManager(Ogre::SceneManager* scnMgr, Simulator* sim, double budgetMs, size_t libraryBytes, int hullPoints) :
+	slicedCount(0), fallbackCount(0), sceneMgr(scnMgr), simulator(sim), frameBudget(budgetMs), fragmentCount(0), jobCount(0)
+{
+	slicer = new MeshSlicer(NULL);
+	slicer->setThreads(std::max(1u, std::thread::hardware_concurrency()));
+	simplifier = new MeshSimplifier();
+	optimizer = new MeshOptimizer();
+	lodRatios.assign(LOD_RATIOS, LOD_RATIOS + sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]));
+	lodDistances.assign(LOD_DISTANCES, LOD_DISTANCES + sizeof(LOD_DISTANCES) / sizeof(LOD_DISTANCES[0]));
+	library = new FractureLibrary(libraryBytes, hullPoints);
+	library->setLodChain(lodRatios, lodDistances);
+	hulls = new HullCache(hullPoints);
+	debris = new DebrisManager(sceneMgr, simulator, hulls);
+
+	// The render thread keeps a core to itself
+	int threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	service = new FractureService(threads, MAX_FRACTURE_JOBS);
+	precomputedOnly = std::thread::hardware_concurrency() <= 2;
+}
+
+FractureManager::~FractureManager()
+{
+	// Workers may still be reading the sources
+	delete service;
+	for (std::map<Ogre::String, MeshCache*>::iterator i = sources.begin(); i != sources.end(); ++i)
+		delete i->second;
+	delete library;
+	// Fragments release their hulls
+	delete debris;
+	delete hulls;
+	delete optimizer;
+	delete simplifier;
+	delete slicer;
+}
+
+bool FractureManager::loadSource(const Ogre::String& meshName, const std::string& xmlFile, int orientations)
+{
+	MeshCache* cache = new MeshCache();
+	if (!cache->open(xmlFile))
+		LOG_ERROR(LOG_MESH, "Could not load " << xmlFile << ": " << cache->getError());
+	if (cache->view().vertexCount == 0 || cache->view().faceCount == 0)
+	{
+		delete cache;
+		return false;
+	}
+
+	// The library and the LOD chain want a mesh of their own, only for as
+	// long as they are built
+	XML_Mesh mesh = XML_Mesh(std::vector<vec3f>(), std::vector<vec3i>());
+	cache->copyTo(mesh);
+	int built = library->build(meshName, mesh, orientations, *slicer, *simplifier, *optimizer);
+	LOG_INFO(LOG_FRACTURE, "Precomputed " << built << " fractures of " << meshName << ", library at "
+		<< library->getUsed() << " of " << library->getBudget() << " bytes");
+
+	// Far asteroids draw a simplified copy of the shipped mesh
+	std::vector<LodLevel> levels;
+	simplifier->buildLodChain(mesh, lodRatios, levels);
+	for (size_t i = 0; i < levels.size(); ++i)
+		optimizer->optimize(*levels[i].mesh);
+	MeshBuilder::addLodLevels(meshName, levels, lodDistances);
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		LOG_DEBUG(LOG_MESH, meshName << " LOD " << i + 1 << ": " << levels[i].faceCount << " faces, error "
+			<< levels[i].error);
+		delete levels[i].mesh;
+	}
+
+	sources[meshName] = cache;
+	return true;
+}
+
+void FractureManager::setFrameBudget(double budgetMs)
+{
+	frameBudget = budgetMs;
+}
+
+double FractureManager::getFrameBudget() const
+{
+	return frameBudget;
+}
+
+void FractureManager::setPrecomputedOnly(bool only)
+{
+	precomputedOnly = only;
+}
+
+bool FractureManager::isPrecomputedOnly() const
+{
+	return precomputedOnly;
+}
+
+void FractureManager::requestFracture(Asteroid* asteroid)
+{
+	const Ogre::String& meshName = asteroid->getEntity()->getMesh()->getName();
+	std::map<Ogre::String, MeshCache*>::iterator src = sources.find(meshName);
+	if (src == sources.end())
+		return;
+
+	if (precomputedOnly)
+	{
+		usePrecomputed(asteroid, meshName);
+		fallbackCount++;
+		return;
+	}
+
+	FractureService::Job job;
+	job.id = jobCount++;
+	job.mesh = src->second->view();
+	job.point = vec3f(asteroid->hitPoint);
+	job.normal = vec3f(asteroid->hitNormal);
+	job.seed = job.id;
+	job.pieces = 2;
+	job.hullPoints = hulls->getMaxPoints();
+	job.lodRatios = &lodRatios;
+
+	if (service->submit(job))
+		jobs[job.id] = asteroid;
+	else
+	{
+		usePrecomputed(asteroid, meshName);
+		fallbackCount++;
+	}
+}
+
+void FractureManager::update(float seconds, const Ogre::Vector3& viewer)
+{
+	timer.reset();
+	FractureService::Result result;
+	while (timer.getMicroseconds() / 1000.0 < frameBudget && service->poll(result))
+	{
+		std::map<unsigned int, Asteroid*>::iterator job = jobs.find(result.id);
+		if (job == jobs.end())
+		{
+			// Asteroid is gone already
+			freeResult(result);
+			continue;
+		}
+
+		Asteroid* asteroid = job->second;
+		jobs.erase(job);
+		if (result.fragments.empty())
+		{
+			// A grazing hit whose plane missed the mesh. The asteroid still
+			// breaks, along the closest precomputed plane through its middle.
+			freeResult(result);
+			usePrecomputed(asteroid, asteroid->getEntity()->getMesh()->getName());
+			fallbackCount++;
+			continue;
+		}
+
+		attachFragments(asteroid, result);
+		slicedCount++;
+	}
+
+	debris->update(seconds, viewer);
+}
+
+void FractureManager::attachFragments(Asteroid* asteroid, FractureService::Result& result)
+{
+	asteroid->getNode()->detachAllObjects();
+	for (size_t i = 0; i < result.fragments.size(); ++i)
+	{
+		Ogre::String name = "Fragment_" + std::to_string(fragmentCount++);
+		MeshBuilder::createMesh(*result.fragments[i], name);
+		if (i < result.lods.size())
+			MeshBuilder::addLodLevels(name, result.lods[i], lodDistances);
+		attach(asteroid, name, true, i < result.hulls.size() ? &result.hulls[i] : NULL,
+			i < result.mass.size() ? &result.mass[i] : NULL);
+	}
+	freeResult(result);
+}
+
+void FractureManager::usePrecomputed(Asteroid* asteroid, const Ogre::String& meshName)
+{
+	const FractureLibrary::Entry* entry = library->closest(meshName, vec3f(asteroid->hitNormal));
+	asteroid->getNode()->detachAllObjects();
+	if (!entry)
+	{
+		// Nothing to break it along, so it drifts on whole as debris rather
+		// than vanish. The mesh is the asteroid's, shared with the others.
+		attach(asteroid, meshName, false, NULL, NULL);
+		return;
+	}
+
+	// The meshes stay with the library, only the entities are the asteroid's
+	for (int i = 0; i < 2; ++i)
+		attach(asteroid, entry->meshes[i], false, &entry->hulls[i], &entry->mass[i]);
+}
+
+void FractureManager::attach(Asteroid* asteroid, const Ogre::String& meshName, bool owned, const ConvexHull* hull, const MassProperties* mass)
+{
+	Ogre::Entity* ent = sceneMgr->createEntity(asteroid->getName() + "_" + meshName, meshName);
+	ent->setCastShadows(true);
+
+	// A node of its own where the asteroid was, so the piece can move on its own
+	Ogre::SceneNode* source = asteroid->getNode();
+	Ogre::SceneNode* node = sceneMgr->getRootSceneNode()->createChildSceneNode(
+		source->_getDerivedPosition(), source->_getDerivedOrientation());
+	node->setScale(source->_getDerivedScale());
+	node->attachObject(ent);
+
+	btRigidBody* body = hull ? createBody(node, meshName, *hull, mass) : NULL;
+	debris->add(ent, node, body, owned);
+}
+
+btRigidBody* FractureManager::createBody(Ogre::SceneNode* node, const Ogre::String& meshName, const ConvexHull& hull, const MassProperties* mass)
+{
+	// Pieces are closed, the hull only stands in if the mesh integration failed
+	MassProperties props;
+	if (mass && mass->volume > 0.0f)
+		props = *mass;
+	else if (!computeMassProperties(hull.points, hull.faces, props))
+		return NULL;
+
+	btConvexHullShape* hullShape = hulls->get(meshName, hull);
+	if (!hullShape)
+		return NULL;
+
+	// Bullet wants the body frame on the centre of mass along the principal
+	// axes, so the hull sits in a compound shifted back to the mesh frame.
+	// The cached hull is in mesh space and shared, the node's scale goes on
+	// a wrapper.
+	float scale = node->getScale().x;
+	vec3f moments;
+	float axes[3][3];
+	principalAxes(props, moments, axes);
+	btTransform offset(btMatrix3x3(axes[0][0], axes[0][1], axes[0][2],
+		axes[1][0], axes[1][1], axes[1][2],
+		axes[2][0], axes[2][1], axes[2][2]),
+		btVector3(props.centroid.x, props.centroid.y, props.centroid.z) * scale);
+	btCompoundShape* shape = new btCompoundShape();
+	shape->addChildShape(offset.inverse(), new btUniformScalingShape(hullShape, scale));
+
+	const Ogre::Vector3& pos = node->getPosition();
+	const Ogre::Quaternion& rot = node->getOrientation();
+	btTransform start(btQuaternion(rot.x, rot.y, rot.z, rot.w), btVector3(pos.x, pos.y, pos.z));
+	OgreMotionState* motion = new OgreMotionState(start * offset, node);
+	motion->setCenterOfMassOffset(offset);
+
+	// Volume goes with the cube of the scale, moments with the fifth power
+	float scale3 = scale * scale * scale;
+	btScalar bodyMass = FRAGMENT_DENSITY * props.volume * scale3;
+	btVector3 inertia(moments.x, moments.y, moments.z);
+	inertia *= FRAGMENT_DENSITY * scale3 * scale * scale;
+	btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(bodyMass, motion, shape, inertia));
+
+	// Asteroids float, so does what is left of them
+	body->setFlags(body->getFlags() | BT_DISABLE_WORLD_GRAVITY);
+	Ogre::Vector3 away = rot * Ogre::Vector3(props.centroid.x, props.centroid.y, props.centroid.z);
+	away.normalise();
+	away *= FRAGMENT_SEPARATION;
+	body->setLinearVelocity(btVector3(away.x, away.y, away.z));
+
+	simulator->addBody(body, DEBRIS_GROUP, DEBRIS_MASK);
+	return body;
+}
+
+bool FractureManager::isPending(Asteroid* asteroid) const
+{
+	for (std::map<unsigned int, Asteroid*>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+		if (i->second == asteroid)
+			return true;
+	return false;
+}
+
+void FractureManager::release(Asteroid* asteroid)
+{
+	// Its job may still be running, the result is dropped when it comes back
+	for (std::map<unsigned int, Asteroid*>::iterator i = jobs.begin(); i != jobs.end(); )
+	{
+		if (i->second == asteroid)
+			jobs.erase(i++);
+		else
+			++i;
+	}
+}
+
+DebrisManager* FractureManager::getDebris()
+{
+	return debris;
+}
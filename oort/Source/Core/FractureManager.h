@@ -0,0 +1,99 @@
+#pragma once
+
+#include <OgreSceneManager.h>
+#include <OgreEntity.h>
+#include <OgreTimer.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MeshSlicer.h"
+#include "MeshCache.h"
+#include "FractureService.h"
+#include "FractureLibrary.h"
+#include "HullCache.h"
+#include "DebrisManager.h"
+#include "Simulator.h"
+#include "Asteroid.h"
+
+// Splits dead asteroids along the plane of the laser that killed them.
+// The slicing runs on FractureService's threads; the render thread only turns
+// finished fragments into Ogre meshes, at most frameBudget milliseconds of it
+// per frame. Hits the service has no room for, grazing hits whose plane
+// misses the mesh, or every hit when running precomputed only, get the
+// closest fracture from the library built at load.
+// Each fragment gets its own node and a rigid body on a convex hull of at
+// most hullPoints vertices, with mass and inertia integrated over the piece's
+// volume. Pieces only collide with each other and walls. Asteroids, pieces
+// and precomputed halves all get a chain of simplified LOD meshes. Attached
+// pieces belong to the debris manager, which keeps them under its caps.
+class FractureManager {
+public:
+	// libraryBytes is the memory budget of the precomputed fractures
+	FractureManager(Ogre::SceneManager* scnMgr, Simulator* sim, double budgetMs, size_t libraryBytes, int hullPoints);
+	~FractureManager();
+
+	// Loads the .mesh.xml behind an Ogre mesh through its binary cache,
+	// precomputes fractures along that many plane orientations and gives the
+	// Ogre mesh its LOD chain
+	bool loadSource(const Ogre::String& meshName, const std::string& xmlFile, int orientations);
+
+	void setFrameBudget(double budgetMs);
+	double getFrameBudget() const;
+
+	// Skips the fracture threads and only uses the library, the default on
+	// machines with two cores or less
+	void setPrecomputedOnly(bool only);
+	bool isPrecomputedOnly() const;
+
+	// Hands the asteroid's hit plane to the fracture threads
+	void requestFracture(Asteroid* asteroid);
+
+	// Attaches finished fragments until the frame budget is spent, the rest
+	// wait a frame, then lets the debris evict and fade with the frame time
+	void update(float seconds, const Ogre::Vector3& viewer);
+
+	// True while the asteroid waits for its fragments, it must stay until then
+	bool isPending(Asteroid* asteroid) const;
+	// Forgets an asteroid about to be deleted. A job still running for it is
+	// dropped when it comes back; fragments already attached stay as debris.
+	void release(Asteroid* asteroid);
+
+	DebrisManager* getDebris();
+
+	int slicedCount;
+	int fallbackCount;
+
+private:
+
+	Ogre::SceneManager* sceneMgr;
+	Simulator* simulator;
+	HullCache* hulls;
+	DebrisManager* debris;
+	MeshSlicer* slicer;
+	MeshSimplifier* simplifier;
+	MeshOptimizer* optimizer;
+	FractureService* service;
+	FractureLibrary* library;
+	Ogre::Timer timer;
+
+	double frameBudget;
+	bool precomputedOnly;
+	int fragmentCount;
+	unsigned int jobCount;
+
+	// Face ratio of each LOD level and the distance it takes over from
+	std::vector<float> lodRatios;
+	std::vector<float> lodDistances;
+
+	// Mapped for the fracture threads to slice in place
+	std::map<Ogre::String, MeshCache*> sources;
+	// Job id -> asteroid waiting for it
+	std::map<unsigned int, Asteroid*> jobs;
+
+	void attachFragments(Asteroid* asteroid, FractureService::Result& result);
+	void usePrecomputed(Asteroid* asteroid, const Ogre::String& meshName);
+	void attach(Asteroid* asteroid, const Ogre::String& meshName, bool owned, const ConvexHull* hull, const MassProperties* mass);
+	btRigidBody* createBody(Ogre::SceneNode* node, const Ogre::String& meshName, const ConvexHull& hull, const MassProperties* mass);
+};
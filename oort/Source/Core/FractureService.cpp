@@ -0,0 +1,208 @@
+#include "FractureService.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <random>
+
+FractureService::FractureService(int threads, size_t capacity) :
+	jobs(capacity), results(capacity), queued(0), outstanding(0), quit(false)
+{
+	for (int i = 0; i < std::max(1, threads); ++i)
+		workers.push_back(std::thread(&FractureService::work, this));
+}
+
+FractureService::~FractureService()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		quit = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+
+	// Jobs nobody collected
+	Result* r;
+	while (results.pop(r))
+		delete r;
+}
+
+bool FractureService::submit(const Job& job)
+{
+	// Every job in flight has a slot in the result ring, so workers never wait on it
+	if (outstanding.load() >= (int)results.capacity())
+		return false;
+	if (!jobs.push(job))
+		return false;
+
+	outstanding++;
+	queued++;
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+	return true;
+}
+
+bool FractureService::poll(Result& result)
+{
+	Result* r;
+	if (!results.pop(r))
+		return false;
+
+	result.id = r->id;
+	result.fragments.swap(r->fragments);
+	result.hulls.swap(r->hulls);
+	result.mass.swap(r->mass);
+	result.lods.swap(r->lods);
+	delete r;
+	outstanding--;
+	return true;
+}
+
+int FractureService::inFlight() const
+{
+	return outstanding.load();
+}
+
+void FractureService::work()
+{
+	MeshSlicer slicer(NULL);
+	MeshSimplifier simplifier;
+	MeshOptimizer optimizer;
+	for (;;)
+	{
+		Job job;
+		if (!jobs.pop(job))
+		{
+			std::unique_lock<std::mutex> guard(sleepLock);
+			wake.wait(guard, [this] { return quit.load() || queued.load() > 0; });
+			if (quit)
+				return;
+			continue;
+		}
+		queued--;
+
+		Result* r = new Result;
+		r->id = job.id;
+		std::vector<XML_Mesh*> pieces;
+		std::vector<std::vector<LodLevel> > lods;
+		fracture(slicer, job, pieces);
+		buildPhysics(job, pieces, *r);
+		buildLods(simplifier, job, pieces, lods);
+		optimize(optimizer, job, pieces, lods);
+		pack(pieces, lods, *r);
+		results.push(r);
+	}
+}
+
+void FractureService::fracture(MeshSlicer& slicer, const Job& job, std::vector<XML_Mesh*>& pieces)
+{
+	slicer.loadMesh(job.mesh);
+
+	if (job.pieces <= 2)
+	{
+		std::vector<XML_Mesh*> halves;
+		slicer.sliceByPlane(halves, job.point, job.normal);
+		if (halves[0]->faces.empty() || halves[1]->faces.empty())
+		{
+			delete halves[0];
+			delete halves[1];
+			return;
+		}
+		pieces.swap(halves);
+		return;
+	}
+
+	// Seeds spread over half the mesh's extent around the hit
+	const vec3f* verts = job.mesh.verts;
+	vec3f lo = verts[0], hi = verts[0];
+	for (int i = 1; i < job.mesh.vertexCount; ++i)
+	{
+		lo = vec3f(std::min(lo.x, verts[i].x), std::min(lo.y, verts[i].y), std::min(lo.z, verts[i].z));
+		hi = vec3f(std::max(hi.x, verts[i].x), std::max(hi.y, verts[i].y), std::max(hi.z, verts[i].z));
+	}
+	float spread = 0.25f * std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+
+	std::mt19937 rng(job.seed);
+	std::uniform_real_distribution<float> offset(-spread, spread);
+	std::vector<vec3f> seeds;
+	for (int i = 0; i < job.pieces; ++i)
+		seeds.push_back(vec3f(job.point.x + offset(rng), job.point.y + offset(rng), job.point.z + offset(rng)));
+
+	std::vector<Fragment> fragments;
+	slicer.shatterVoronoi(fragments, seeds);
+	if (fragments.size() < 2)
+	{
+		for (size_t i = 0; i < fragments.size(); ++i)
+			delete fragments[i].mesh;
+		return;
+	}
+	for (size_t i = 0; i < fragments.size(); ++i)
+		pieces.push_back(fragments[i].mesh);
+}
+
+void FractureService::buildPhysics(const Job& job, const std::vector<XML_Mesh*>& pieces, Result& result)
+{
+	if (job.hullPoints <= 0)
+		return;
+	result.hulls.resize(pieces.size());
+	result.mass.resize(pieces.size());
+	for (size_t i = 0; i < pieces.size(); ++i)
+	{
+		buildConvexHull(pieces[i]->verts, job.hullPoints, result.hulls[i]);
+		computeMassProperties(*pieces[i], result.mass[i]);
+	}
+}
+
+void FractureService::buildLods(MeshSimplifier& simplifier, const Job& job, const std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods)
+{
+	if (!job.lodRatios || job.lodRatios->empty())
+		return;
+	lods.resize(pieces.size());
+	for (size_t i = 0; i < pieces.size(); ++i)
+		simplifier.buildLodChain(*pieces[i], *job.lodRatios, lods[i]);
+}
+
+void FractureService::optimize(MeshOptimizer& optimizer, const Job& job, std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods)
+{
+	float before = 0.0f, after = 0.0f;
+	size_t faces = 0;
+	for (size_t i = 0; i < pieces.size(); ++i)
+	{
+		XML_Mesh& mesh = *pieces[i];
+		CacheStats stats = optimizer.optimize(mesh);
+		before += stats.acmrBefore * mesh.faces.size();
+		after += stats.acmrAfter * mesh.faces.size();
+		faces += mesh.faces.size();
+	}
+	for (size_t i = 0; i < lods.size(); ++i)
+		for (size_t l = 0; l < lods[i].size(); ++l)
+			optimizer.optimize(*lods[i][l].mesh);
+
+	if (faces > 0)
+		LOG_TRACE(LOG_FRACTURE, "Job " << job.id << " ACMR " << before / faces << " -> " << after / faces);
+}
+
+void FractureService::pack(std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods, Result& result)
+{
+	result.fragments.resize(pieces.size());
+	for (size_t i = 0; i < pieces.size(); ++i)
+	{
+		quantizeMesh(*pieces[i], result.fragments[i]);
+		delete pieces[i];
+	}
+	pieces.clear();
+
+	result.lods.resize(lods.size());
+	for (size_t i = 0; i < lods.size(); ++i)
+	{
+		result.lods[i].resize(lods[i].size());
+		for (size_t l = 0; l < lods[i].size(); ++l)
+		{
+			quantizeMesh(*lods[i][l].mesh, result.lods[i][l]);
+			delete lods[i][l].mesh;
+		}
+	}
+	lods.clear();
+}
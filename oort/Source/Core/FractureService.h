@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MeshSlicer.h"
+#include "ConvexHull.h"
+#include "MassProperties.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "QuantizedMesh.h"
+#include "LockFreeQueue.h"
+
+// Runs fracture jobs on background threads. Jobs go in through a lock free
+// ring and finished fragments come back through another one, which the game
+// drains once per frame, so no slicing happens on the render thread.
+// Hulls, mass and LODs are built from the full precision pieces, which are
+// then handed back in the compact debris format.
+// Each worker owns its slicer, simplifier and optimizer. Jobs slice their
+// source where it lies, usually a mapped MeshCache, which is only read and
+// must outlive every job that refers to it.
+class FractureService {
+public:
+	struct Job {
+		unsigned int id;
+		HostMesh mesh;
+		// Cut plane in mesh space
+		vec3f point;
+		vec3f normal;
+		// Two pieces cut along the plane, more are Voronoi cells around point
+		// scattered from seed, so the same job always breaks the same way
+		unsigned int seed;
+		int pieces;
+		// Vertex cap of each fragment's collision hull, 0 for no hulls
+		int hullPoints;
+		// Face ratios of each fragment's LOD chain, NULL for none. Must
+		// outlive the job like the mesh.
+		const std::vector<float>* lodRatios;
+	};
+
+	struct Result {
+		unsigned int id;
+		// Empty when the plane missed the mesh
+		std::vector<QuantizedMesh> fragments;
+		// One per fragment, empty where the piece is too flat for one
+		std::vector<ConvexHull> hulls;
+		// Unit density, one per fragment along with the hulls
+		std::vector<MassProperties> mass;
+		// LOD chain of each fragment, finest level first
+		std::vector<std::vector<QuantizedMesh> > lods;
+	};
+
+	// capacity bounds the jobs in flight, submit() fails past it
+	FractureService(int threads, size_t capacity);
+	~FractureService();
+
+	// Called from the game thread only. False when the queue is full.
+	bool submit(const Job& job);
+	// Hands back one finished job
+	bool poll(Result& result);
+
+	int inFlight() const;
+
+private:
+	LockFreeQueue<Job> jobs;
+	LockFreeQueue<Result*> results;
+	std::vector<std::thread> workers;
+
+	std::atomic<int> queued;
+	std::atomic<int> outstanding;
+	std::atomic<bool> quit;
+
+	// Only used to park idle workers, the queues themselves take no lock
+	std::mutex sleepLock;
+	std::condition_variable wake;
+
+	void work();
+	static void fracture(MeshSlicer& slicer, const Job& job, std::vector<XML_Mesh*>& pieces);
+	static void buildPhysics(const Job& job, const std::vector<XML_Mesh*>& pieces, Result& result);
+	static void buildLods(MeshSimplifier& simplifier, const Job& job, const std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods);
+	// Reorders pieces and LOD levels for the vertex cache
+	static void optimize(MeshOptimizer& optimizer, const Job& job, std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods);
+	// Quantizes pieces and levels into the result and frees them
+	static void pack(std::vector<XML_Mesh*>& pieces, std::vector<std::vector<LodLevel> >& lods, Result& result);
+};
@@ -0,0 +1,860 @@
+#include "HalfEdgeMesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Same tolerance as the slicer, points closer to the plane lie on it
+static const float PLANE_EPSILON = 1e-5f;
+
+static inline int nextEdge(int h)
+{
+	return h % 3 == 2 ? h - 2 : h + 1;
+}
+
+static inline unsigned long long edgeKey(int a, int b)
+{
+	return a < b ? ((unsigned long long)a << 32 | (unsigned)b) : ((unsigned long long)b << 32 | (unsigned)a);
+}
+
+static inline unsigned long long directedKey(int a, int b)
+{
+	return (unsigned long long)a << 32 | (unsigned)b;
+}
+
+static inline float dot(const vec3f& a, const vec3f& b)
+{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static inline vec3f lerp3(const vec3f& a, const vec3f& b, float t)
+{
+	return vec3f(a.x + t*(b.x - a.x), a.y + t*(b.y - a.y), a.z + t*(b.z - a.z));
+}
+
+HalfEdgeMesh::HalfEdgeMesh() :
+	attributes(false), deadFaces(0), stamp(0), planeD(0.0f)
+{
+}
+
+HalfEdgeMesh::HalfEdgeMesh(const HalfEdgeMesh& other) :
+	stamp(0), planeD(0.0f)
+{
+	*this = other;
+}
+
+HalfEdgeMesh& HalfEdgeMesh::operator=(const HalfEdgeMesh& other)
+{
+	points = other.points;
+	vertPoint = other.vertPoint;
+	normals = other.normals;
+	texcoords = other.texcoords;
+	attributes = other.attributes;
+	corners = other.corners;
+	twins = other.twins;
+	chunks = other.chunks;
+	deadFaces = other.deadFaces;
+	return *this;
+}
+
+void HalfEdgeMesh::fromMesh(const XML_Mesh& mesh, int facesPerChunk)
+{
+	clear();
+	const std::vector<vec3f>& v = mesh.verts;
+	int count = (int)v.size();
+	attributes = count > 0 && mesh.normals.size() == v.size() && mesh.texcoords.size() == v.size();
+
+	// Sorted by position, a run of equal positions is one point
+	std::vector<int> order(count);
+	for (int i = 0; i < count; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&v](int a, int b) {
+		if (v[a].x != v[b].x) return v[a].x < v[b].x;
+		if (v[a].y != v[b].y) return v[a].y < v[b].y;
+		return v[a].z < v[b].z;
+	});
+	vertPoint.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		const vec3f& p = v[order[i]];
+		if (i == 0 || p.x != points.back().x || p.y != points.back().y || p.z != points.back().z)
+			points.push_back(p);
+		vertPoint[order[i]] = (int)points.size() - 1;
+	}
+
+	if (attributes)
+	{
+		normals = mesh.normals;
+		texcoords = mesh.texcoords;
+	}
+	else
+	{
+		normals.assign(count, vec3f(0.0f));
+		texcoords.assign(count, vec2f(0.0f));
+	}
+
+	// Faces folded onto an edge have no place in a half-edge mesh
+	corners.reserve(mesh.faces.size() * 3);
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		const vec3i& t = mesh.faces[f];
+		int a = vertPoint[t.x], b = vertPoint[t.y], c = vertPoint[t.z];
+		if (a == b || b == c || c == a)
+			continue;
+		corners.push_back(t.x);
+		corners.push_back(t.y);
+		corners.push_back(t.z);
+	}
+	twins.assign(corners.size(), -1);
+
+	std::vector<int>& all = capEdges[0];
+	all.resize(corners.size());
+	for (size_t h = 0; h < corners.size(); ++h)
+		all[h] = (int)h;
+	linkEdges(all);
+
+	int faces = (int)corners.size() / 3;
+	for (int first = 0; first < faces; first += facesPerChunk)
+	{
+		chunks.push_back(Chunk());
+		Chunk& chunk = chunks.back();
+		for (int f = first; f < std::min(faces, first + facesPerChunk); ++f)
+			chunk.faces.push_back(f);
+		fitChunk(chunk);
+	}
+}
+
+void HalfEdgeMesh::toMesh(XML_Mesh& mesh) const
+{
+	mesh.verts.clear();
+	mesh.normals.clear();
+	mesh.texcoords.clear();
+	mesh.faces.clear();
+	mesh.chunks.clear();
+	mesh.chunkVerts.clear();
+
+	std::vector<int> remap(vertPoint.size(), -1);
+	int faces = (int)corners.size() / 3;
+	mesh.faces.reserve(faceCount());
+	for (int f = 0; f < faces; ++f)
+	{
+		if (corners[3*f] < 0)
+			continue;
+
+		int idx[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			int r = corners[3*f + k];
+			if (remap[r] < 0)
+			{
+				remap[r] = (int)mesh.verts.size();
+				mesh.verts.push_back(points[vertPoint[r]]);
+				if (attributes)
+				{
+					mesh.normals.push_back(normals[r]);
+					mesh.texcoords.push_back(texcoords[r]);
+				}
+			}
+			idx[k] = remap[r];
+		}
+		mesh.faces.push_back(vec3i(idx[0], idx[1], idx[2]));
+	}
+}
+
+void HalfEdgeMesh::clear()
+{
+	points.clear();
+	vertPoint.clear();
+	normals.clear();
+	texcoords.clear();
+	attributes = false;
+	corners.clear();
+	twins.clear();
+	chunks.clear();
+	deadFaces = 0;
+}
+
+void HalfEdgeMesh::swap(HalfEdgeMesh& other)
+{
+	points.swap(other.points);
+	vertPoint.swap(other.vertPoint);
+	normals.swap(other.normals);
+	texcoords.swap(other.texcoords);
+	std::swap(attributes, other.attributes);
+	corners.swap(other.corners);
+	twins.swap(other.twins);
+	chunks.swap(other.chunks);
+	std::swap(deadFaces, other.deadFaces);
+}
+
+int HalfEdgeMesh::faceCount() const
+{
+	return (int)corners.size() / 3 - deadFaces;
+}
+
+bool HalfEdgeMesh::empty() const
+{
+	return faceCount() == 0;
+}
+
+int HalfEdgeMesh::borderEdges() const
+{
+	int border = 0;
+	for (size_t h = 0; h < corners.size(); ++h)
+		border += corners[h] >= 0 && twins[h] < 0;
+	return border;
+}
+
+int HalfEdgeMesh::pointOf(int h) const
+{
+	return vertPoint[corners[h]];
+}
+
+int HalfEdgeMesh::endPointOf(int h) const
+{
+	return vertPoint[corners[nextEdge(h)]];
+}
+
+float HalfEdgeMesh::distance(int p)
+{
+	if (distStamp[p] != stamp)
+	{
+		dist[p] = dot(planeNormal, points[p]) + planeD;
+		distStamp[p] = stamp;
+	}
+	return dist[p];
+}
+
+int HalfEdgeMesh::sideOf(int p)
+{
+	float d = distance(p);
+	return d > PLANE_EPSILON ? 1 : (d < -PLANE_EPSILON ? -1 : 0);
+}
+
+// 1 or -1 for the side a face is on, 0 when the plane crosses it
+int HalfEdgeMesh::classify(int f, int* onPlane)
+{
+	int above = 0, below = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		int s = sideOf(pointOf(3*f + k));
+		above += s > 0;
+		below += s < 0;
+	}
+	if (onPlane)
+		*onPlane = 3 - above - below;
+	if (above && below)
+		return 0;
+	if (above || below)
+		return above ? 1 : -1;
+
+	// A face in the plane caps the side it faces away from
+	const vec3f& a = points[pointOf(3*f)];
+	const vec3f& b = points[pointOf(3*f + 1)];
+	const vec3f& c = points[pointOf(3*f + 2)];
+	vec3f u(b.x - a.x, b.y - a.y, b.z - a.z), v(c.x - a.x, c.y - a.y, c.z - a.z);
+	vec3f n(u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x);
+	return dot(n, planeNormal) < 0.0f ? 1 : -1;
+}
+
+// Points made by a slice lie on its plane
+int HalfEdgeMesh::newPoint(const vec3f& p)
+{
+	points.push_back(p);
+	dist.push_back(0.0f);
+	distStamp.push_back(stamp);
+	return (int)points.size() - 1;
+}
+
+int HalfEdgeMesh::newVertex(int point, const vec3f& n, const vec2f& uv)
+{
+	vertPoint.push_back(point);
+	normals.push_back(n);
+	texcoords.push_back(uv);
+	return (int)vertPoint.size() - 1;
+}
+
+int HalfEdgeMesh::addFace(int a, int b, int c, int side, int chunk)
+{
+	int f = (int)corners.size() / 3;
+	corners.push_back(a);
+	corners.push_back(b);
+	corners.push_back(c);
+	for (int k = 0; k < 3; ++k)
+		twins.push_back(-1);
+	faceSide.push_back((signed char)side);
+	faceStamp.push_back(0);
+	chunks[chunk].faces.push_back(f);
+	return f;
+}
+
+// Render vertex where the edge between render vertices a and b crosses the
+// plane. Both faces along the edge get the same point; they share the render
+// vertex too unless the edge is a seam.
+int HalfEdgeMesh::splitEdge(int a, int b)
+{
+	unsigned long long key = edgeKey(a, b);
+	int v;
+	if (splitVerts.find(key, v))
+		return v;
+
+	int pa = vertPoint[a], pb = vertPoint[b];
+	int p;
+	if (!splitPoints.find(edgeKey(pa, pb), p))
+	{
+		// Always from the lower point, so the position does not depend on
+		// which face got there first
+		int lo = std::min(pa, pb), hi = std::max(pa, pb);
+		vec3f pos = lerp3(points[lo], points[hi], dist[lo] / (dist[lo] - dist[hi]));
+		p = newPoint(pos);
+		splitPoints.insert(edgeKey(pa, pb), p);
+	}
+
+	float t = dist[pa] / (dist[pa] - dist[pb]);
+	vec3f n = lerp3(normals[a], normals[b], t);
+	float l = sqrt(dot(n, n));
+	if (l > 0.0f)
+		n = vec3f(n.x / l, n.y / l, n.z / l);
+	vec2f uv(texcoords[a].u + t*(texcoords[b].u - texcoords[a].u), texcoords[a].v + t*(texcoords[b].v - texcoords[a].v));
+	v = newVertex(p, n, uv);
+	splitVerts.insert(key, v);
+	return v;
+}
+
+// Replaces a crossed face by its pieces on either side, the first one in its
+// slot. Their twins are found again by relinking.
+void HalfEdgeMesh::splitFace(int f, int chunk)
+{
+	int idx[3], side[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		idx[k] = corners[3*f + k];
+		side[k] = sideOf(vertPoint[idx[k]]);
+	}
+
+	// Walk the edges in order so both pieces keep the face winding
+	int pos[4], neg[4];
+	int np = 0, nn = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		int j = (k + 1) % 3;
+		if (side[k] >= 0)
+			pos[np++] = idx[k];
+		if (side[k] <= 0)
+			neg[nn++] = idx[k];
+		if (side[k] * side[j] < 0)
+		{
+			int c = splitEdge(idx[k], idx[j]);
+			pos[np++] = c;
+			neg[nn++] = c;
+		}
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		corners[3*f + k] = pos[k];
+		twins[3*f + k] = -1;
+		relink.push_back(3*f + k);
+	}
+	faceSide[f] = 1;
+
+	for (int k = 2; k + 1 < np; ++k)
+	{
+		int g = addFace(pos[0], pos[k], pos[k+1], 1, chunk);
+		for (int e = 0; e < 3; ++e)
+			relink.push_back(3*g + e);
+	}
+	for (int k = 1; k + 1 < nn; ++k)
+	{
+		int g = addFace(neg[0], neg[k], neg[k+1], -1, chunk);
+		for (int e = 0; e < 3; ++e)
+			relink.push_back(3*g + e);
+	}
+}
+
+// Twins every unlinked half-edge in edges with the one running the other way
+// between the same points. Where more than two faces meet, the first pair wins.
+void HalfEdgeMesh::linkEdges(const std::vector<int>& edges)
+{
+	links.clear(edges.size());
+	for (size_t i = 0; i < edges.size(); ++i)
+		links.insert(directedKey(pointOf(edges[i]), endPointOf(edges[i])), edges[i]);
+
+	for (size_t i = 0; i < edges.size(); ++i)
+	{
+		int h = edges[i], g;
+		if (twins[h] >= 0 || !links.find(directedKey(endPointOf(h), pointOf(h)), g))
+			continue;
+		if (g != h && twins[g] < 0)
+		{
+			twins[h] = g;
+			twins[g] = h;
+		}
+	}
+}
+
+// 1 when the box is wholly on the side the normal points to, -1 when wholly
+// on the other, 0 when the plane passes through it
+static int boxSide(const vec3f& lo, const vec3f& hi, const vec3f& n, float d)
+{
+	float s = n.x * (lo.x + hi.x) * 0.5f + n.y * (lo.y + hi.y) * 0.5f + n.z * (lo.z + hi.z) * 0.5f + d;
+	float r = fabs(n.x) * (hi.x - lo.x) * 0.5f + fabs(n.y) * (hi.y - lo.y) * 0.5f + fabs(n.z) * (hi.z - lo.z) * 0.5f;
+	if (s - r > PLANE_EPSILON)
+		return 1;
+	if (s + r < -PLANE_EPSILON)
+		return -1;
+	return 0;
+}
+
+bool HalfEdgeMesh::slice(const vec3f& pp, const vec3f& pn, HalfEdgeMesh& back)
+{
+	back.clear();
+	back.attributes = attributes;
+	float l = sqrt(dot(pn, pn));
+	if (!(l > 0.0f) || empty())
+		return false;
+
+	planeNormal = vec3f(pn.x / l, pn.y / l, pn.z / l);
+	planeD = -dot(planeNormal, pp);
+	stamp++;
+	dist.resize(points.size());
+	distStamp.resize(points.size());
+	size_t faces = corners.size() / 3;
+	faceStamp.resize(faces);
+	faceSide.resize(faces);
+
+	// One plane test per chunk, only the crossed ones are looked at face by face
+	chunkSide.resize(chunks.size());
+	crossing.clear();
+	crossed.clear();
+	crossedChunk.clear();
+	flat.clear();
+	relink.clear();
+	cuts.clear();
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		chunkSide[c] = (signed char)boxSide(chunks[c].min, chunks[c].max, planeNormal, planeD);
+		if (chunkSide[c] == 0)
+			crossing.push_back((int)c);
+	}
+
+	for (size_t i = 0; i < crossing.size(); ++i)
+	{
+		const std::vector<int>& list = chunks[crossing[i]].faces;
+		for (size_t k = 0; k < list.size(); ++k)
+		{
+			int f = list[k], onPlane;
+			faceSide[f] = (signed char)classify(f, &onPlane);
+			if (faceSide[f] == 0)
+			{
+				faceStamp[f] = stamp;
+				crossed.push_back(f);
+				crossedChunk.push_back(crossing[i]);
+			}
+			else if (onPlane >= 2)
+				flat.push_back(f);
+		}
+	}
+
+	// Faces on either side of an edge lying in the plane come apart there.
+	// Both faces touch the plane, so both are in crossed chunks.
+	for (size_t i = 0; i < flat.size(); ++i)
+	{
+		int f = flat[i];
+		for (int e = 0; e < 3; ++e)
+		{
+			int h = 3*f + e, t = twins[h];
+			if (t < 0 || faceSide[t / 3] == faceSide[f] || sideOf(pointOf(h)) != 0 || sideOf(endPointOf(h)) != 0)
+				continue;
+			twins[h] = -1;
+			twins[t] = -1;
+			cuts.push_back(faceSide[f] > 0 ? std::make_pair(h, t) : std::make_pair(t, h));
+		}
+	}
+
+	// Neighbours of crossed faces lose their twin until the pieces are relinked
+	for (size_t i = 0; i < crossed.size(); ++i)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			int t = twins[3*crossed[i] + e];
+			if (t < 0 || faceStamp[t / 3] == stamp)
+				continue;
+			twins[t] = -1;
+			faceSide[t / 3] = (signed char)classify(t / 3);
+			relink.push_back(t);
+		}
+	}
+
+	splitVerts.clear(crossed.size());
+	splitPoints.clear(crossed.size());
+	for (size_t i = 0; i < crossed.size(); ++i)
+		splitFace(crossed[i], crossedChunk[i]);
+
+	// Pieces on the same side link up again, pairs across the plane are the cut
+	links.clear(relink.size());
+	for (size_t i = 0; i < relink.size(); ++i)
+		links.insert(directedKey(pointOf(relink[i]), endPointOf(relink[i])), relink[i]);
+	for (size_t i = 0; i < relink.size(); ++i)
+	{
+		int h = relink[i], g;
+		if (twins[h] >= 0 || !links.find(directedKey(endPointOf(h), pointOf(h)), g) || g == h || twins[g] >= 0)
+			continue;
+		if (faceSide[h / 3] == faceSide[g / 3])
+		{
+			twins[h] = g;
+			twins[g] = h;
+		}
+		else if (faceSide[h / 3] > 0)
+			cuts.push_back(std::make_pair(h, g));
+	}
+
+	capLoops();
+
+	int front = 0, behind = 0;
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		const std::vector<int>& list = chunks[c].faces;
+		if (chunkSide[c] != 0)
+		{
+			(chunkSide[c] > 0 ? front : behind) += (int)list.size();
+			continue;
+		}
+		for (size_t k = 0; k < list.size(); ++k)
+			(faceSide[list[k]] > 0 ? front : behind)++;
+	}
+
+	if (behind == 0)
+		return false;
+	if (front == 0)
+	{
+		swap(back);
+		return false;
+	}
+
+	// Only the smaller side is copied, the bigger one stays where it is
+	if (front < behind)
+	{
+		moveSide(1, back);
+		swap(back);
+	}
+	else
+		moveSide(-1, back);
+	return true;
+}
+
+// Chains the cut edges into loops along the front side and closes both sides
+// with the same triangulation, front cap facing back along the normal. Loops
+// winding the other way are holes and bridged into the loop around them, as
+// buildCutCap does. The cap shares the loop's points, so its edges twin the
+// cut edges.
+void HalfEdgeMesh::capLoops()
+{
+	if (cuts.size() < 3)
+		return;
+
+	// Plane basis with u x v = n, as buildCutCap uses
+	const vec3f& n = planeNormal;
+	vec3f u = fabs(n.x) < 0.9f ? vec3f(0.0f, -n.z, n.y) : vec3f(-n.z, 0.0f, n.x);
+	float ul = sqrt(dot(u, u));
+	u = vec3f(u.x / ul, u.y / ul, u.z / ul);
+	vec3f v(n.y*u.z - n.z*u.y, n.z*u.x - n.x*u.z, n.x*u.y - n.y*u.x);
+
+	// Planar texcoords span the whole cut so all loops of it share one mapping
+	vec2f lo(1e30f), hi(-1e30f);
+	links.clear(cuts.size());
+	for (size_t i = 0; i < cuts.size(); ++i)
+	{
+		const vec3f& p = points[pointOf(cuts[i].first)];
+		float pu = dot(p, u), pv = dot(p, v);
+		lo = vec2f(std::min(lo.u, pu), std::min(lo.v, pv));
+		hi = vec2f(std::max(hi.u, pu), std::max(hi.v, pv));
+		links.insert((unsigned long long)pointOf(cuts[i].first), (int)i);
+	}
+	float extent = std::max(hi.u - lo.u, hi.v - lo.v);
+	if (extent <= 0.0f)
+		return;
+
+	// Every loop's cut edges back to back, loop l from loopStart[l]. Chains
+	// that do not close are walked from their first edge and capped end to
+	// end. 1 once walked, 2 for edges some other edge leads to.
+	cutVisited.assign(cuts.size(), 0);
+	for (size_t i = 0; i < cuts.size(); ++i)
+	{
+		int k;
+		if (links.find((unsigned long long)endPointOf(cuts[i].first), k))
+			cutVisited[k] = 2;
+	}
+	loop.clear();
+	loopStart.clear();
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (size_t start = 0; start < cuts.size(); ++start)
+		{
+			if (cutVisited[start] == 1 || (pass == 0 && cutVisited[start] == 2))
+				continue;
+
+			size_t first = loop.size();
+			int k = (int)start;
+			while (cutVisited[k] != 1)
+			{
+				cutVisited[k] = 1;
+				loop.push_back(k);
+				if (!links.find((unsigned long long)endPointOf(cuts[k].first), k))
+					break;
+			}
+			if (loop.size() - first < 3)
+				loop.resize(first);
+			else
+				loopStart.push_back((int)first);
+		}
+	}
+	loopStart.push_back((int)loop.size());
+	if (loop.empty())
+		return;
+
+	poly.clear();
+	for (size_t i = 0; i < loop.size(); ++i)
+	{
+		const vec3f& p = points[pointOf(cuts[loop[i]].first)];
+		poly.push_back(vec2f(dot(p, u), dot(p, v)));
+	}
+	triangulateCut(poly, loopStart, loopTris, centres, capScratch);
+	if (loopTris.empty())
+		return;
+
+	// Fan centres lifted back onto the plane, u and v only span it
+	float d = dot(n, points[pointOf(cuts[loop[0]].first)]);
+	int centreBase = (int)points.size();
+	for (size_t i = 0; i < centres.size(); ++i)
+		newPoint(vec3f(u.x*centres[i].u + v.x*centres[i].v + n.x*d,
+			u.y*centres[i].u + v.y*centres[i].v + n.y*d,
+			u.z*centres[i].u + v.z*centres[i].v + n.z*d));
+
+	int capChunk[2] = { -1, -1 };
+	for (int side = 0; side < 2; ++side)
+	{
+		capChunk[side] = (int)chunks.size();
+		chunks.push_back(Chunk());
+		chunkSide.push_back(side == 0 ? 1 : -1);
+		capEdges[side].clear();
+
+		// Only points a triangle uses get a cap vertex, and only their cut
+		// edges can twin a cap edge
+		vec3f cn = side == 0 ? vec3f(-n.x, -n.y, -n.z) : n;
+		capVerts.assign(poly.size() + centres.size(), -1);
+		for (size_t t = 0; t < loopTris.size(); t += 3)
+		{
+			int r[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				int i = loopTris[t + k];
+				if (capVerts[i] < 0)
+				{
+					bool centre = i >= (int)poly.size();
+					const vec2f& uv = centre ? centres[i - poly.size()] : poly[i];
+					capVerts[i] = newVertex(centre ? centreBase + i - (int)poly.size() : pointOf(cuts[loop[i]].first),
+						cn, vec2f((uv.u - lo.u) / extent, (uv.v - lo.v) / extent));
+				}
+				r[k] = capVerts[i];
+			}
+			int f = side == 0 ? addFace(r[0], r[2], r[1], 1, capChunk[0]) : addFace(r[0], r[1], r[2], -1, capChunk[1]);
+			for (int e = 0; e < 3; ++e)
+				capEdges[side].push_back(3*f + e);
+		}
+		for (size_t i = 0; i < loop.size(); ++i)
+			if (capVerts[i] >= 0)
+				capEdges[side].push_back(side == 0 ? cuts[loop[i]].first : cuts[loop[i]].second);
+	}
+
+	for (int side = 0; side < 2; ++side)
+	{
+		if (capChunk[side] < 0)
+			continue;
+		linkEdges(capEdges[side]);
+		fitChunk(chunks[capChunk[side]]);
+	}
+}
+
+int HalfEdgeMesh::moveFace(int f, HalfEdgeMesh& out)
+{
+	int nf = (int)out.corners.size() / 3;
+	for (int k = 0; k < 3; ++k)
+	{
+		int r = corners[3*f + k];
+		if (vertStamp[r] != stamp)
+		{
+			int p = vertPoint[r];
+			if (pointStamp[p] != stamp)
+			{
+				pointStamp[p] = stamp;
+				pointMap[p] = (int)out.points.size();
+				out.points.push_back(points[p]);
+			}
+			vertStamp[r] = stamp;
+			vertMap[r] = (int)out.vertPoint.size();
+			out.vertPoint.push_back(pointMap[p]);
+			out.normals.push_back(normals[r]);
+			out.texcoords.push_back(texcoords[r]);
+		}
+		out.corners.push_back(vertMap[r]);
+	}
+	for (int k = 0; k < 3; ++k)
+		out.twins.push_back(-1);
+
+	faceStamp[f] = stamp;
+	faceMap[f] = nf;
+	moved.push_back(f);
+	return nf;
+}
+
+// Copies every face of side into out, chunk by chunk, and leaves holes where
+// they were. Chunks the plane missed move whole with their bounds.
+void HalfEdgeMesh::moveSide(int side, HalfEdgeMesh& out)
+{
+	stamp++;
+	vertStamp.resize(vertPoint.size());
+	vertMap.resize(vertPoint.size());
+	pointStamp.resize(points.size());
+	pointMap.resize(points.size());
+	size_t faces = corners.size() / 3;
+	faceStamp.resize(faces);
+	faceMap.resize(faces);
+	moved.clear();
+
+	size_t keep = 0;
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		Chunk& chunk = chunks[c];
+		if (chunkSide[c] == side)
+		{
+			out.chunks.push_back(Chunk());
+			Chunk& dst = out.chunks.back();
+			dst.min = chunk.min;
+			dst.max = chunk.max;
+			dst.faces.swap(chunk.faces);
+			for (size_t k = 0; k < dst.faces.size(); ++k)
+				dst.faces[k] = moveFace(dst.faces[k], out);
+		}
+		else if (chunkSide[c] == 0)
+		{
+			Chunk dst;
+			size_t kept = 0;
+			for (size_t k = 0; k < chunk.faces.size(); ++k)
+			{
+				int f = chunk.faces[k];
+				if (faceSide[f] == side)
+					dst.faces.push_back(moveFace(f, out));
+				else
+					chunk.faces[kept++] = f;
+			}
+			chunk.faces.resize(kept);
+			if (!dst.faces.empty())
+			{
+				out.fitChunk(dst);
+				out.chunks.push_back(dst);
+			}
+			fitChunk(chunk);
+		}
+
+		if (!chunk.faces.empty())
+		{
+			if (keep != c)
+				std::swap(chunks[keep], chunk);
+			keep++;
+		}
+	}
+	chunks.resize(keep);
+
+	// Cuts left no twin across the plane, so every twin of a moved face moved too
+	for (size_t i = 0; i < moved.size(); ++i)
+	{
+		int f = moved[i], nf = faceMap[f];
+		for (int k = 0; k < 3; ++k)
+		{
+			int t = twins[3*f + k];
+			out.twins[3*nf + k] = t >= 0 && faceStamp[t / 3] == stamp ? 3*faceMap[t / 3] + t % 3 : -1;
+			corners[3*f + k] = -1;
+			twins[3*f + k] = -1;
+		}
+	}
+	deadFaces += (int)moved.size();
+
+	if (deadFaces > faceCount())
+		compact();
+}
+
+void HalfEdgeMesh::fitChunk(Chunk& chunk) const
+{
+	vec3f lo(1e30f), hi(-1e30f);
+	for (size_t k = 0; k < chunk.faces.size(); ++k)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const vec3f& p = points[pointOf(3*chunk.faces[k] + e)];
+			lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+	}
+	chunk.min = lo;
+	chunk.max = hi;
+}
+
+// Drops moved faces and whatever only they used. Faces keep their order and
+// chunks their faces.
+void HalfEdgeMesh::compact()
+{
+	int faces = (int)corners.size() / 3;
+	faceMap.resize(faces);
+	int live = 0;
+	for (int f = 0; f < faces; ++f)
+		faceMap[f] = corners[3*f] >= 0 ? live++ : -1;
+
+	vertMap.assign(vertPoint.size(), -1);
+	pointMap.assign(points.size(), -1);
+	std::vector<vec3f> keptPoints;
+	std::vector<int> keptVertPoint;
+	std::vector<vec3f> keptNormals;
+	std::vector<vec2f> keptTexcoords;
+	keptVertPoint.reserve(vertPoint.size() / 2);
+	keptNormals.reserve(vertPoint.size() / 2);
+	keptTexcoords.reserve(vertPoint.size() / 2);
+
+	for (int f = 0; f < faces; ++f)
+	{
+		int nf = faceMap[f];
+		if (nf < 0)
+			continue;
+		for (int k = 0; k < 3; ++k)
+		{
+			int r = corners[3*f + k];
+			if (vertMap[r] < 0)
+			{
+				int p = vertPoint[r];
+				if (pointMap[p] < 0)
+				{
+					pointMap[p] = (int)keptPoints.size();
+					keptPoints.push_back(points[p]);
+				}
+				vertMap[r] = (int)keptVertPoint.size();
+				keptVertPoint.push_back(pointMap[p]);
+				keptNormals.push_back(normals[r]);
+				keptTexcoords.push_back(texcoords[r]);
+			}
+			// Faces only move down, so face f is read before anything lands on it
+			int t = twins[3*f + k];
+			corners[3*nf + k] = vertMap[r];
+			twins[3*nf + k] = t >= 0 ? 3*faceMap[t / 3] + t % 3 : -1;
+		}
+	}
+	corners.resize(3 * live);
+	twins.resize(3 * live);
+	points.swap(keptPoints);
+	vertPoint.swap(keptVertPoint);
+	normals.swap(keptNormals);
+	texcoords.swap(keptTexcoords);
+
+	for (size_t c = 0; c < chunks.size(); ++c)
+		for (size_t k = 0; k < chunks[c].faces.size(); ++k)
+			chunks[c].faces[k] = faceMap[chunks[c].faces[k]];
+	deadFaces = 0;
+}
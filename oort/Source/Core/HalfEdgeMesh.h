@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Triangle mesh with adjacency, for pieces that get cut again. Half-edge h
+// leaves corner h of face h / 3 towards the next corner of the same face,
+// so next and face are implicit and only the twin is stored. Render vertices
+// carry normal and texcoord and share a point with every other render vertex
+// at the same position, and twins are matched by point, so texture seams do
+// not split the surface.
+// Faces are kept in chunks with bounds. A slice only visits the chunks the
+// plane crosses, splits and relinks the faces it cuts and caps the loops it
+// leaves, then moves the smaller side out to the other mesh. Faces and
+// vertices left behind are dropped once they outnumber the live ones.
+class HalfEdgeMesh {
+public:
+	HalfEdgeMesh();
+	// Copies take the geometry only, every mesh grows its own scratch
+	HalfEdgeMesh(const HalfEdgeMesh& other);
+	HalfEdgeMesh& operator=(const HalfEdgeMesh& other);
+
+	// Welds render vertices of the same position into points and links
+	// twins. Faces are chunked in the mesh's own order, which is along a
+	// Morton curve for loaded meshes.
+	void fromMesh(const XML_Mesh& mesh, int facesPerChunk = 32);
+	// Live faces and the render vertices they use, in the order faces first
+	// use them. Normals and texcoords only when the source had them.
+	void toMesh(XML_Mesh& mesh) const;
+
+	// Cuts the mesh in place. This mesh keeps the side the normal points to
+	// and back gets the other one, each capped like MeshSlicer caps its
+	// halves and linked across the cap. False when the plane misses the
+	// surface, with the whole mesh on its side and the other one empty.
+	bool slice(const vec3f& planepoint, const vec3f& planenormal, HalfEdgeMesh& back);
+
+	void clear();
+	// Exchanges the geometry, scratch stays where it is
+	void swap(HalfEdgeMesh& other);
+
+	int faceCount() const;
+	bool empty() const;
+	// Half-edges without a twin, 0 for a closed surface
+	int borderEdges() const;
+
+private:
+	struct Chunk
+	{
+		vec3f min;
+		vec3f max;
+		std::vector<int> faces;
+	};
+
+	std::vector<vec3f> points;
+	// Render vertices
+	std::vector<int> vertPoint;
+	std::vector<vec3f> normals;
+	std::vector<vec2f> texcoords;
+	bool attributes;
+	// Render vertex of each corner, -1 for faces that were moved out
+	std::vector<int> corners;
+	std::vector<int> twins;
+	std::vector<Chunk> chunks;
+	int deadFaces;
+
+	// Slice scratch, stamped so nothing is cleared per slice
+	int stamp;
+	vec3f planeNormal;
+	float planeD;
+	std::vector<float> dist;
+	std::vector<int> distStamp;
+	std::vector<int> faceStamp;
+	std::vector<signed char> faceSide;
+	std::vector<signed char> chunkSide;
+	std::vector<int> crossing;
+	std::vector<int> crossed;
+	std::vector<int> crossedChunk;
+	// Uncrossed faces with an edge in the plane
+	std::vector<int> flat;
+	std::vector<int> relink;
+	EdgeMap splitVerts;
+	EdgeMap splitPoints;
+	EdgeMap links;
+	// Cut edges as (front half-edge, back half-edge)
+	std::vector<std::pair<int, int> > cuts;
+	std::vector<char> cutVisited;
+	std::vector<int> loop;
+	std::vector<int> loopStart;
+	std::vector<vec2f> poly;
+	std::vector<int> loopTris;
+	std::vector<vec2f> centres;
+	// Cap render vertex of each loop point and centre, -1 until a face uses it
+	std::vector<int> capVerts;
+	// Cap and cut edges of each side, linked once the caps are built
+	std::vector<int> capEdges[2];
+	CutCap capScratch;
+	std::vector<int> vertMap;
+	std::vector<int> vertStamp;
+	std::vector<int> pointMap;
+	std::vector<int> pointStamp;
+	std::vector<int> faceMap;
+	std::vector<int> moved;
+
+	int pointOf(int halfEdge) const;
+	int endPointOf(int halfEdge) const;
+	float distance(int point);
+	int sideOf(int point);
+	int classify(int face, int* onPlane = NULL);
+	int newPoint(const vec3f& p);
+	int newVertex(int point, const vec3f& n, const vec2f& uv);
+	int addFace(int a, int b, int c, int side, int chunk);
+	int splitEdge(int a, int b);
+	void splitFace(int face, int chunk);
+	void linkEdges(const std::vector<int>& edges);
+	void capLoops();
+	void moveSide(int side, HalfEdgeMesh& out);
+	int moveFace(int face, HalfEdgeMesh& out);
+	void fitChunk(Chunk& chunk) const;
+	void compact();
+};
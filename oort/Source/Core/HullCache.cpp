@@ -0,0 +1,63 @@
+#include "HullCache.h"
+
+HullCache::HullCache(int maxPoints) :
+	maxPoints(maxPoints)
+{
+}
+
+HullCache::~HullCache()
+{
+	for (std::map<Ogre::String, btConvexHullShape*>::iterator i = shapes.begin(); i != shapes.end(); ++i)
+		delete i->second;
+}
+
+int HullCache::getMaxPoints() const
+{
+	return maxPoints;
+}
+
+btConvexHullShape* HullCache::get(const Ogre::String& name, const ConvexHull& hull)
+{
+	btConvexHullShape* shape = find(name);
+	if (shape || hull.points.empty())
+		return shape;
+
+	btAlignedObjectArray<btVector3> points;
+	points.resize((int)hull.points.size());
+	for (size_t i = 0; i < hull.points.size(); ++i)
+		points[(int)i] = btVector3(hull.points[i].x, hull.points[i].y, hull.points[i].z);
+	shape = new btConvexHullShape(&points[0].getX(), points.size(), sizeof(btVector3));
+	shapes[name] = shape;
+	return shape;
+}
+
+btConvexHullShape* HullCache::get(const Ogre::String& name, const XML_Mesh& mesh)
+{
+	btConvexHullShape* shape = find(name);
+	if (shape)
+		return shape;
+
+	ConvexHull hull;
+	buildConvexHull(mesh.verts, maxPoints, hull);
+	return get(name, hull);
+}
+
+btConvexHullShape* HullCache::find(const Ogre::String& name) const
+{
+	std::map<Ogre::String, btConvexHullShape*>::const_iterator i = shapes.find(name);
+	return i == shapes.end() ? NULL : i->second;
+}
+
+void HullCache::release(const Ogre::String& name)
+{
+	std::map<Ogre::String, btConvexHullShape*>::iterator i = shapes.find(name);
+	if (i == shapes.end())
+		return;
+	delete i->second;
+	shapes.erase(i);
+}
+
+size_t HullCache::size() const
+{
+	return shapes.size();
+}
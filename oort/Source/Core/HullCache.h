@@ -0,0 +1,36 @@
+#pragma once
+
+#include <btBulletDynamicsCommon.h>
+#include <OgrePrerequisites.h>
+
+#include <map>
+
+#include "ConvexHull.h"
+
+// Collision hulls of fragment meshes, in mesh space and keyed by the Ogre
+// mesh name, so every body made from the same mesh shares one shape. Hulls
+// are capped at maxPoints vertices, which bounds the narrowphase cost of a
+// piece no matter how many triangles the slicer left on it.
+class HullCache {
+public:
+	HullCache(int maxPoints);
+	~HullCache();
+
+	int getMaxPoints() const;
+
+	// Shape of the named mesh, made from hull the first time it is asked for.
+	// NULL when the hull is empty.
+	btConvexHullShape* get(const Ogre::String& name, const ConvexHull& hull);
+	// Same, building the hull from the mesh's vertices on this thread
+	btConvexHullShape* get(const Ogre::String& name, const XML_Mesh& mesh);
+	btConvexHullShape* find(const Ogre::String& name) const;
+
+	// Deletes the shape, no body may still use it
+	void release(const Ogre::String& name);
+
+	size_t size() const;
+
+private:
+	int maxPoints;
+	std::map<Ogre::String, btConvexHullShape*> shapes;
+};
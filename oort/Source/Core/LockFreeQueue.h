@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded multi producer / multi consumer ring. Every cell carries a sequence
+// number saying whose turn it is, so push and pop only ever race on one
+// compare-exchange of the head or tail and never block.
+template <class T>
+class LockFreeQueue {
+public:
+	// capacity is rounded up to a power of two
+	LockFreeQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		mask = size - 1;
+		cells = new Cell[size];
+		for (size_t i = 0; i < size; ++i)
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	~LockFreeQueue()
+	{
+		delete[] cells;
+	}
+
+	// False when the ring is full
+	bool push(const T& value)
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[pos & mask];
+			size_t seq = cell.seq.load(std::memory_order_acquire);
+			std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+			if (diff == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = value;
+					cell.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	// False when the ring is empty
+	bool pop(T& value)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[pos & mask];
+			size_t seq = cell.seq.load(std::memory_order_acquire);
+			std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = cell.value;
+					cell.seq.store(pos + mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = head.load(std::memory_order_relaxed);
+		}
+	}
+
+	size_t capacity() const
+	{
+		return mask + 1;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> seq;
+		T value;
+	};
+
+	Cell* cells;
+	size_t mask;
+	// Producers and consumers each get their own cache line
+	alignas(64) std::atomic<size_t> tail;
+	alignas(64) std::atomic<size_t> head;
+
+	LockFreeQueue(const LockFreeQueue&);
+	LockFreeQueue& operator=(const LockFreeQueue&);
+};
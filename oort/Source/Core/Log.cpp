@@ -0,0 +1,226 @@
+#include "Log.h"
+#include "LockFreeQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace Log {
+
+static const char* LEVEL_NAMES[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+static const char* CATEGORY_NAMES[LOG_CATEGORY_COUNT] = { "game", "mesh", "slicer", "fracture", "audio" };
+
+// Lines waiting for the sink before writers fall back to writing themselves
+static const size_t SINK_CAPACITY = 4096;
+
+typedef std::chrono::steady_clock Clock;
+
+// Fixed one second windows, good enough to keep a per face trace from
+// flooding the terminal
+struct RateLimit {
+	std::atomic<int> level;
+	std::atomic<int> perSecond;
+	std::atomic<long long> windowStart;
+	std::atomic<int> count;
+	std::atomic<int> dropped;
+};
+
+// Owns the writer thread. Created on first use, drained and joined at exit.
+class Sink {
+public:
+	Sink() :
+		async(true), lines(SINK_CAPACITY), start(Clock::now()), queued(0), written(0), quit(false)
+	{
+		for (int i = 0; i < LOG_CATEGORY_COUNT; ++i)
+		{
+			limits[i].level = LOG_LEVEL_INFO;
+			limits[i].perSecond = 0;
+			limits[i].windowStart = 0;
+			limits[i].count = 0;
+			limits[i].dropped = 0;
+		}
+		writer = std::thread(&Sink::work, this);
+	}
+
+	~Sink()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		wake.notify_one();
+		writer.join();
+		drain();
+		fflush(stdout);
+	}
+
+	RateLimit limits[LOG_CATEGORY_COUNT];
+	std::atomic<bool> async;
+
+	long long millis() const
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+	}
+
+	void push(const std::string& line, bool now)
+	{
+		// Anything queued goes out first so lines stay in order
+		if (now)
+			flush();
+		else if (async)
+		{
+			std::string* copy = new std::string(line);
+			if (lines.push(copy))
+			{
+				queued++;
+				{
+					std::lock_guard<std::mutex> guard(lock);
+				}
+				wake.notify_one();
+				return;
+			}
+			// Sink is behind, the line is written here rather than lost
+			delete copy;
+		}
+
+		std::lock_guard<std::mutex> guard(output);
+		fwrite(line.data(), 1, line.size(), stdout);
+		fflush(stdout);
+	}
+
+	void flush()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		idle.wait(guard, [this] { return written.load() == queued.load(); });
+	}
+
+private:
+	LockFreeQueue<std::string*> lines;
+	Clock::time_point start;
+	std::thread writer;
+	std::atomic<long long> queued;
+	std::atomic<long long> written;
+	bool quit;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	// Keeps synchronous writes and the sink from interleaving
+	std::mutex output;
+
+	void drain()
+	{
+		std::string* line;
+		std::lock_guard<std::mutex> guard(output);
+		while (lines.pop(line))
+		{
+			fwrite(line->data(), 1, line->size(), stdout);
+			delete line;
+			written++;
+		}
+		fflush(stdout);
+	}
+
+	void work()
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [this] { return quit || written.load() != queued.load(); });
+				if (quit)
+					return;
+			}
+
+			drain();
+
+			std::lock_guard<std::mutex> guard(lock);
+			if (written.load() == queued.load())
+				idle.notify_all();
+		}
+	}
+};
+
+static Sink& sink()
+{
+	static Sink instance;
+	return instance;
+}
+
+void setLevel(LogCategory category, int level)
+{
+	sink().limits[category].level = level;
+}
+
+int getLevel(LogCategory category)
+{
+	return sink().limits[category].level;
+}
+
+void setRateLimit(LogCategory category, int messagesPerSecond)
+{
+	sink().limits[category].perSecond = messagesPerSecond;
+}
+
+void setAsync(bool async)
+{
+	if (!async)
+		sink().flush();
+	sink().async = async;
+}
+
+bool enabled(LogCategory category, int level)
+{
+	Sink& s = sink();
+	RateLimit& limit = s.limits[category];
+	if (level < limit.level)
+		return false;
+
+	// Errors always get through
+	int perSecond = limit.perSecond;
+	if (perSecond <= 0 || level >= LOG_LEVEL_ERROR)
+		return true;
+
+	long long now = s.millis();
+	long long window = limit.windowStart;
+	if (now - window >= 1000 && limit.windowStart.compare_exchange_strong(window, now))
+	{
+		limit.count = 0;
+		int dropped = limit.dropped.exchange(0);
+		if (dropped > 0)
+		{
+			std::ostringstream line;
+			line << dropped << " messages suppressed by the rate limit";
+			write(category, LOG_LEVEL_WARN, line.str());
+		}
+	}
+
+	if (limit.count++ < perSecond)
+		return true;
+	limit.dropped++;
+	return false;
+}
+
+void write(LogCategory category, int level, const std::string& message)
+{
+	Sink& s = sink();
+	char prefix[48];
+	long long ms = s.millis();
+	snprintf(prefix, sizeof(prefix), "%lld.%03lld %s %s: ", ms / 1000, ms % 1000, LEVEL_NAMES[level], CATEGORY_NAMES[category]);
+
+	std::string line(prefix);
+	line += message;
+	line += '\n';
+	// Errors skip the queue, they are often the last thing before a crash
+	s.push(line, level >= LOG_LEVEL_ERROR);
+}
+
+void flush()
+{
+	sink().flush();
+}
+
+}
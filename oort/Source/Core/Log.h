@@ -0,0 +1,103 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+// Levels, numbered so they can be compared in #if
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+// Messages below this level are compiled out, arguments and all. Release
+// builds keep info and up unless the build sets it.
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+#endif
+
+enum LogCategory {
+	LOG_GAME,
+	LOG_MESH,
+	LOG_SLICER,
+	LOG_FRACTURE,
+	LOG_AUDIO,
+	LOG_CATEGORY_COUNT
+};
+
+// Game side logging. Lines are formatted on the calling thread and written by
+// a background sink, so logging never blocks on the terminal. Each category
+// has a runtime level and an optional rate limit on top of the compile time cut.
+namespace Log {
+	void setLevel(LogCategory category, int level);
+	int getLevel(LogCategory category);
+
+	// At most messagesPerSecond lines per category, 0 lifts the limit. Dropped
+	// lines are counted and reported once the category may log again.
+	void setRateLimit(LogCategory category, int messagesPerSecond);
+
+	// Synchronous writes are handy when chasing a crash
+	void setAsync(bool async);
+
+	// Level and rate check, done before the message is formatted
+	bool enabled(LogCategory category, int level);
+	void write(LogCategory category, int level, const std::string& message);
+
+	// Blocks until every queued line is written
+	void flush();
+}
+
+#define LOG_AT(category, level, message) \
+	do { \
+		if (Log::enabled(category, level)) { \
+			std::ostringstream logStream_; \
+			logStream_ << message; \
+			Log::write(category, level, logStream_.str()); \
+		} \
+	} while (0)
+
+// Still names what the message uses, so variables kept only for logging do
+// not warn as unused, but never evaluates it
+#define LOG_STRIPPED(category, message) \
+	do { \
+		if (false) { \
+			std::ostringstream logStream_; \
+			logStream_ << message; \
+			(void)(category); \
+		} \
+	} while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(category, message) LOG_AT(category, LOG_LEVEL_TRACE, message)
+#else
+#define LOG_TRACE(category, message) LOG_STRIPPED(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, message) LOG_AT(category, LOG_LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(category, message) LOG_STRIPPED(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(category, message) LOG_AT(category, LOG_LEVEL_INFO, message)
+#else
+#define LOG_INFO(category, message) LOG_STRIPPED(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(category, message) LOG_AT(category, LOG_LEVEL_WARN, message)
+#else
+#define LOG_WARN(category, message) LOG_STRIPPED(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(category, message) LOG_AT(category, LOG_LEVEL_ERROR, message)
+#else
+#define LOG_ERROR(category, message) LOG_STRIPPED(category, message)
+#endif
@@ -0,0 +1,181 @@
+#include "MassProperties.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Faces are gathered into blocks of flat arrays and summed in LANES
+// independent accumulators, which the compiler turns into SIMD adds without
+// having to reorder float sums itself. Each block folds into doubles.
+static const int MASS_BLOCK = 64;
+static const int LANES = 4;
+
+// Integrals of 1, x, y, z, x^2, y^2, z^2, xy, yz and zx over the volume
+enum { I_1, I_X, I_Y, I_Z, I_XX, I_YY, I_ZZ, I_XY, I_YZ, I_ZX, INTEGRALS };
+
+static void integrateBlock(const float (*p)[MASS_BLOCK], int n, double* total)
+{
+	const float* x0 = p[0]; const float* y0 = p[1]; const float* z0 = p[2];
+	const float* x1 = p[3]; const float* y1 = p[4]; const float* z1 = p[5];
+	const float* x2 = p[6]; const float* y2 = p[7]; const float* z2 = p[8];
+
+	float acc[INTEGRALS][LANES] = {};
+	for (int i = 0; i < n; i += LANES)
+	{
+		for (int l = 0; l < LANES; ++l)
+		{
+			int k = i + l;
+			// Six times the signed volume of the tetrahedron with the origin
+			float d = x0[k] * (y1[k] * z2[k] - z1[k] * y2[k])
+				- y0[k] * (x1[k] * z2[k] - z1[k] * x2[k])
+				+ z0[k] * (x1[k] * y2[k] - y1[k] * x2[k]);
+			float sx = x0[k] + x1[k] + x2[k];
+			float sy = y0[k] + y1[k] + y2[k];
+			float sz = z0[k] + z1[k] + z2[k];
+
+			acc[I_1][l] += d;
+			acc[I_X][l] += d * sx;
+			acc[I_Y][l] += d * sy;
+			acc[I_Z][l] += d * sz;
+			// Sum over pairs with repeats is (s^2 + sum of squares) / 2,
+			// the divisions are folded into the constants below
+			acc[I_XX][l] += d * (sx * sx + x0[k] * x0[k] + x1[k] * x1[k] + x2[k] * x2[k]);
+			acc[I_YY][l] += d * (sy * sy + y0[k] * y0[k] + y1[k] * y1[k] + y2[k] * y2[k]);
+			acc[I_ZZ][l] += d * (sz * sz + z0[k] * z0[k] + z1[k] * z1[k] + z2[k] * z2[k]);
+			acc[I_XY][l] += d * (sx * sy + x0[k] * y0[k] + x1[k] * y1[k] + x2[k] * y2[k]);
+			acc[I_YZ][l] += d * (sy * sz + y0[k] * z0[k] + y1[k] * z1[k] + y2[k] * z2[k]);
+			acc[I_ZX][l] += d * (sz * sx + z0[k] * x0[k] + z1[k] * x1[k] + z2[k] * x2[k]);
+		}
+	}
+	for (int j = 0; j < INTEGRALS; ++j)
+		for (int l = 0; l < LANES; ++l)
+			total[j] += acc[j][l];
+}
+
+bool computeMassProperties(const std::vector<vec3f>& verts, const std::vector<vec3i>& faces, MassProperties& props)
+{
+	props.volume = 0.0f;
+	if (verts.empty() || faces.empty())
+		return false;
+
+	// Relative to a vertex of the mesh, so far away meshes lose no precision
+	const vec3f& ref = verts[0];
+	double total[INTEGRALS] = {};
+	float block[9][MASS_BLOCK];
+
+	for (size_t first = 0; first < faces.size(); first += MASS_BLOCK)
+	{
+		int n = (int)std::min<size_t>(MASS_BLOCK, faces.size() - first);
+		for (int k = 0; k < n; ++k)
+		{
+			const vec3i& f = faces[first + k];
+			const vec3f* c[3] = { &verts[f.x], &verts[f.y], &verts[f.z] };
+			for (int v = 0; v < 3; ++v)
+			{
+				block[v * 3 + 0][k] = c[v]->x - ref.x;
+				block[v * 3 + 1][k] = c[v]->y - ref.y;
+				block[v * 3 + 2][k] = c[v]->z - ref.z;
+			}
+		}
+		// Padding faces are degenerate and add nothing
+		int padded = (n + LANES - 1) / LANES * LANES;
+		for (int k = n; k < padded; ++k)
+			for (int j = 0; j < 9; ++j)
+				block[j][k] = 0.0f;
+		integrateBlock(block, padded, total);
+	}
+
+	double volume = total[I_1] / 6.0;
+	if (!(volume > 0.0))
+		return false;
+
+	double cx = total[I_X] / 24.0 / volume;
+	double cy = total[I_Y] / 24.0 / volume;
+	double cz = total[I_Z] / 24.0 / volume;
+	double xx = total[I_XX] / 120.0, yy = total[I_YY] / 120.0, zz = total[I_ZZ] / 120.0;
+	double xy = total[I_XY] / 120.0, yz = total[I_YZ] / 120.0, zx = total[I_ZX] / 120.0;
+
+	// Second moments moved from the reference point to the centroid
+	xx -= volume * cx * cx;
+	yy -= volume * cy * cy;
+	zz -= volume * cz * cz;
+	xy -= volume * cx * cy;
+	yz -= volume * cy * cz;
+	zx -= volume * cz * cx;
+
+	props.volume = (float)volume;
+	props.centroid = vec3f((float)(cx + ref.x), (float)(cy + ref.y), (float)(cz + ref.z));
+	props.inertia[0][0] = (float)(yy + zz);
+	props.inertia[1][1] = (float)(zz + xx);
+	props.inertia[2][2] = (float)(xx + yy);
+	props.inertia[0][1] = props.inertia[1][0] = (float)-xy;
+	props.inertia[1][2] = props.inertia[2][1] = (float)-yz;
+	props.inertia[2][0] = props.inertia[0][2] = (float)-zx;
+	return true;
+}
+
+bool computeMassProperties(const XML_Mesh& mesh, MassProperties& props)
+{
+	return computeMassProperties(mesh.verts, mesh.faces, props);
+}
+
+// Cyclic Jacobi, a handful of sweeps is plenty for 3x3
+void principalAxes(const MassProperties& props, vec3f& moments, float axes[3][3])
+{
+	double a[3][3], v[3][3];
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+		{
+			a[i][j] = props.inertia[i][j];
+			v[i][j] = i == j ? 1.0 : 0.0;
+		}
+
+	for (int sweep = 0; sweep < 16; ++sweep)
+	{
+		double off = a[0][1] * a[0][1] + a[1][2] * a[1][2] + a[2][0] * a[2][0];
+		double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+		if (off <= 1e-24 * diag)
+			break;
+
+		for (int p = 0; p < 2; ++p)
+			for (int q = p + 1; q < 3; ++q)
+			{
+				if (a[p][q] == 0.0)
+					continue;
+				double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+				for (int k = 0; k < 3; ++k)
+				{
+					double kp = a[k][p], kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					double pk = a[p][k], qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					double kp = v[k][p], kq = v[k][q];
+					v[k][p] = c * kp - s * kq;
+					v[k][q] = s * kp + c * kq;
+				}
+			}
+	}
+
+	// Rotations only ever multiply in, but flip one axis if rounding disagrees
+	double det = v[0][0] * (v[1][1] * v[2][2] - v[1][2] * v[2][1])
+		- v[0][1] * (v[1][0] * v[2][2] - v[1][2] * v[2][0])
+		+ v[0][2] * (v[1][0] * v[2][1] - v[1][1] * v[2][0]);
+	if (det < 0.0)
+		for (int k = 0; k < 3; ++k)
+			v[k][2] = -v[k][2];
+
+	moments = vec3f((float)a[0][0], (float)a[1][1], (float)a[2][2]);
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			axes[i][j] = (float)v[i][j];
+}
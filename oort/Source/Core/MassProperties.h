@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Mass properties of a closed, outward wound triangle mesh at unit density.
+// Multiply volume by the density for the mass, and the inertia tensor by the
+// density too; scaling the mesh by s scales them by s^3 and s^5.
+struct MassProperties
+{
+	float volume;
+	vec3f centroid;
+	// About the centroid, row major
+	float inertia[3][3];
+};
+
+// Sums the signed tetrahedra every face makes with a reference point. False,
+// with the volume set to 0, when the mesh encloses no volume, which also
+// catches inside out meshes.
+bool computeMassProperties(const std::vector<vec3f>& verts, const std::vector<vec3i>& faces, MassProperties& props);
+bool computeMassProperties(const XML_Mesh& mesh, MassProperties& props);
+
+// Diagonalizes the inertia tensor. Column k of axes is the axis of moments[k];
+// the axes form a rotation, so a body frame built on them stays right handed.
+void principalAxes(const MassProperties& props, vec3f& moments, float axes[3][3]);
@@ -0,0 +1,234 @@
+#include "MeshBuilder.h"
+
+#include <OgreSubMesh.h>
+#include <OgreHardwareBufferManager.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace MeshBuilder {
+
+// Area weighted vertex normals, used when the source mesh has none for a vertex
+static void computeNormals(const std::vector<vec3f>& verts, const std::vector<vec3i>& faces, std::vector<vec3f>& out)
+{
+	out.assign(verts.size(), vec3f(0.0f));
+
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		const vec3i& f = faces[i];
+		const vec3f& a = verts[f.x];
+		const vec3f& b = verts[f.y];
+		const vec3f& c = verts[f.z];
+
+		float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+		float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+		vec3f n(uy*vz - uz*vy, uz*vx - ux*vz, ux*vy - uy*vx);
+
+		int idx[3] = { f.x, f.y, f.z };
+		for (int k = 0; k < 3; ++k)
+		{
+			out[idx[k]].x += n.x;
+			out[idx[k]].y += n.y;
+			out[idx[k]].z += n.z;
+		}
+	}
+
+	for (size_t i = 0; i < out.size(); ++i)
+	{
+		float l = std::sqrt(out[i].x*out[i].x + out[i].y*out[i].y + out[i].z*out[i].z);
+		if (l > 0.0f)
+		{
+			out[i].x /= l;
+			out[i].y /= l;
+			out[i].z /= l;
+		}
+	}
+}
+
+// Creates (or replaces) the mesh resource from vcount vertices, which
+// vertex(i, position, normal, texcoord) hands out one at a time
+template <class Vertex>
+static Ogre::MeshPtr buildMesh(size_t vcount, const std::vector<vec3i>& faces, Vertex vertex,
+	const Ogre::String& name, const Ogre::String& material, const Ogre::String& group)
+{
+	Ogre::MeshManager& mm = Ogre::MeshManager::getSingleton();
+	if (mm.resourceExists(name))
+		mm.remove(name);
+
+	Ogre::MeshPtr ogreMesh = mm.createManual(name, group);
+	Ogre::SubMesh* sub = ogreMesh->createSubMesh();
+
+	size_t icount = faces.size() * 3;
+
+	// Interleaved position / normal / texcoord, same layout OgreXMLConverter produces
+	ogreMesh->sharedVertexData = new Ogre::VertexData();
+	ogreMesh->sharedVertexData->vertexCount = vcount;
+
+	Ogre::VertexDeclaration* decl = ogreMesh->sharedVertexData->vertexDeclaration;
+	size_t offset = 0;
+	decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+	offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+	decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+	offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+	decl->addElement(0, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+	offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
+
+	Ogre::HardwareVertexBufferSharedPtr vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+		offset, vcount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+
+	Ogre::Vector3 vmin(0.0f), vmax(0.0f);
+	// Squared distance of the farthest vertex, the box corners can be nearer
+	float radius = 0.0f;
+	float* pv = static_cast<float*>(vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+	for (size_t i = 0; i < vcount; ++i)
+	{
+		vec3f p, n;
+		vec2f t;
+		vertex(i, p, n, t);
+
+		*pv++ = p.x; *pv++ = p.y; *pv++ = p.z;
+		*pv++ = n.x; *pv++ = n.y; *pv++ = n.z;
+		*pv++ = t.u; *pv++ = t.v;
+
+		Ogre::Vector3 v(p.x, p.y, p.z);
+		if (i == 0)
+		{
+			vmin = v;
+			vmax = v;
+		}
+		else
+		{
+			vmin.makeFloor(v);
+			vmax.makeCeil(v);
+		}
+		radius = std::max(radius, v.squaredLength());
+	}
+	vbuf->unlock();
+	ogreMesh->sharedVertexData->vertexBufferBinding->setBinding(0, vbuf);
+
+	// 16 bit indices whenever the vertex count allows it
+	Ogre::HardwareIndexBuffer::IndexType itype = vcount <= 65536 ? Ogre::HardwareIndexBuffer::IT_16BIT : Ogre::HardwareIndexBuffer::IT_32BIT;
+	Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+		itype, icount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+
+	if (itype == Ogre::HardwareIndexBuffer::IT_16BIT)
+	{
+		Ogre::uint16* pi = static_cast<Ogre::uint16*>(ibuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			*pi++ = static_cast<Ogre::uint16>(faces[i].x);
+			*pi++ = static_cast<Ogre::uint16>(faces[i].y);
+			*pi++ = static_cast<Ogre::uint16>(faces[i].z);
+		}
+	}
+	else
+	{
+		// vec3i is three packed ints, so the face list already is a 32 bit index buffer
+		Ogre::uint32* pi = static_cast<Ogre::uint32*>(ibuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+		std::memcpy(pi, faces.data(), icount * sizeof(Ogre::uint32));
+	}
+	ibuf->unlock();
+
+	sub->useSharedVertices = true;
+	sub->indexData->indexBuffer = ibuf;
+	sub->indexData->indexCount = icount;
+	sub->indexData->indexStart = 0;
+	sub->setMaterialName(material);
+
+	ogreMesh->_setBounds(Ogre::AxisAlignedBox(vmin, vmax));
+	ogreMesh->_setBoundingSphereRadius(std::sqrt(radius));
+	ogreMesh->load();
+
+	return ogreMesh;
+}
+
+Ogre::MeshPtr createMesh(const XML_Mesh& mesh, const Ogre::String& name, const Ogre::String& material, const Ogre::String& group)
+{
+	size_t vcount = mesh.verts.size();
+
+	// Only rebuild normals if some vertex is actually missing one
+	std::vector<vec3f> generated;
+	const std::vector<vec3f>* normals = &mesh.normals;
+	if (mesh.normals.size() < vcount)
+	{
+		computeNormals(mesh.verts, mesh.faces, generated);
+		for (size_t i = 0; i < mesh.normals.size(); ++i)
+			generated[i] = mesh.normals[i];
+		normals = &generated;
+	}
+
+	return buildMesh(vcount, mesh.faces,
+		[&](size_t i, vec3f& p, vec3f& n, vec2f& t) {
+			p = mesh.verts[i];
+			n = (*normals)[i];
+			t = i < mesh.texcoords.size() ? mesh.texcoords[i] : vec2f(0.0f);
+		}, name, material, group);
+}
+
+Ogre::MeshPtr createMesh(const QuantizedMesh& mesh, const Ogre::String& name, const Ogre::String& material, const Ogre::String& group)
+{
+	// Decoded straight into the vertex buffer, only normals the source did
+	// not have need the positions up front
+	std::vector<vec3f> generated;
+	if (!mesh.normals)
+	{
+		std::vector<vec3f> positions(mesh.verts.size());
+		for (size_t i = 0; i < positions.size(); ++i)
+			positions[i] = mesh.position((int)i);
+		computeNormals(positions, mesh.faces, generated);
+	}
+
+	return buildMesh(mesh.verts.size(), mesh.faces,
+		[&](size_t i, vec3f& p, vec3f& n, vec2f& t) {
+			p = mesh.position((int)i);
+			n = mesh.normals ? mesh.normal((int)i) : generated[i];
+			t = mesh.texcoord((int)i);
+		}, name, material, group);
+}
+
+void addLodLevels(const Ogre::String& name, const std::vector<LodLevel>& levels, const std::vector<float>& distances, const Ogre::String& group)
+{
+	Ogre::MeshPtr base = Ogre::MeshManager::getSingleton().load(name, group);
+	Ogre::String material = base->getSubMesh(0)->getMaterialName();
+	for (size_t i = 0; i < levels.size() && i < distances.size(); ++i)
+	{
+		Ogre::String lodName = name + "_lod" + std::to_string(i + 1);
+		createMesh(*levels[i].mesh, lodName, material, group);
+		base->createManualLodLevel(distances[i], lodName, group);
+	}
+}
+
+void addLodLevels(const Ogre::String& name, const std::vector<QuantizedMesh>& levels, const std::vector<float>& distances, const Ogre::String& group)
+{
+	Ogre::MeshPtr base = Ogre::MeshManager::getSingleton().load(name, group);
+	Ogre::String material = base->getSubMesh(0)->getMaterialName();
+	for (size_t i = 0; i < levels.size() && i < distances.size(); ++i)
+	{
+		Ogre::String lodName = name + "_lod" + std::to_string(i + 1);
+		createMesh(levels[i], lodName, material, group);
+		base->createManualLodLevel(distances[i], lodName, group);
+	}
+}
+
+void destroyMesh(const Ogre::String& name)
+{
+	Ogre::MeshManager& mm = Ogre::MeshManager::getSingleton();
+	if (!mm.resourceExists(name))
+		return;
+
+	// Manual LOD levels are meshes of their own
+	std::vector<Ogre::String> lods;
+	Ogre::MeshPtr mesh = mm.getByName(name);
+	for (unsigned short i = 1; i < mesh->getNumLodLevels(); ++i)
+		if (!mesh->getLodLevel(i).manualName.empty())
+			lods.push_back(mesh->getLodLevel(i).manualName);
+
+	mesh.setNull();
+	mm.remove(name);
+	for (size_t i = 0; i < lods.size(); ++i)
+		if (mm.resourceExists(lods[i]))
+			mm.remove(lods[i]);
+}
+
+}
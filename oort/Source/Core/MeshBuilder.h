@@ -0,0 +1,46 @@
+#pragma once
+
+#include <OgreMesh.h>
+#include <OgreMeshManager.h>
+#include <OgreResourceGroupManager.h>
+
+#include "MeshSlicer.h"
+#include "MeshSimplifier.h"
+#include "QuantizedMesh.h"
+
+// Turns an XML_Mesh straight into a registered Ogre mesh backed by hardware
+// vertex and index buffers, so sliced geometry never has to touch the disk
+// or go through OgreXMLConverter before createEntity can use it.
+namespace MeshBuilder {
+
+	// Default material of the asteroid meshes (see Stone_temp.mesh.xml)
+	const Ogre::String DEFAULT_MATERIAL = "StonesMat_01";
+
+	// Creates (or replaces) the mesh resource called name from the given XML_Mesh.
+	// Missing normals are rebuilt from the faces, missing texcoords are zeroed.
+	Ogre::MeshPtr createMesh(const XML_Mesh& mesh,
+		const Ogre::String& name,
+		const Ogre::String& material = DEFAULT_MATERIAL,
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+
+	// Same from the compact debris format, decoded straight into the vertex
+	// buffer. That keeps the float layout, the fixed function materials
+	// cannot decode the packed one.
+	Ogre::MeshPtr createMesh(const QuantizedMesh& mesh,
+		const Ogre::String& name,
+		const Ogre::String& material = DEFAULT_MATERIAL,
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+
+	// Registers levels as manual LODs of the named mesh, which is loaded if it
+	// is not yet; level k takes over from distances[k] on. Each level becomes a
+	// mesh of its own named name_lod1, name_lod2 and so on, with the material
+	// of the base mesh.
+	void addLodLevels(const Ogre::String& name, const std::vector<LodLevel>& levels, const std::vector<float>& distances,
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	void addLodLevels(const Ogre::String& name, const std::vector<QuantizedMesh>& levels, const std::vector<float>& distances,
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+
+	// Frees a mesh created with createMesh and its LOD meshes. Entities using
+	// it must be destroyed first.
+	void destroyMesh(const Ogre::String& name);
+}
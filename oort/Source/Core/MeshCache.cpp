@@ -0,0 +1,445 @@
+#include "MeshCache.h"
+#include "Log.h"
+#include "MeshXmlReader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// "OMCH" in the machine's byte order, a cache written on a machine with the
+// other order fails the check and is rebuilt
+static const unsigned int MAGIC = 0x4f4d4348;
+// Bump on any change to the header or the arrays
+static const unsigned int VERSION = 2;
+static const size_t ALIGNMENT = 16;
+
+static const unsigned int HAS_NORMALS = 1;
+static const unsigned int HAS_TEXCOORDS = 2;
+
+// The arrays are the structs' own memory, the file layout depends on them
+static_assert(sizeof(vec3f) == 12 && sizeof(vec2f) == 8 && sizeof(vec3i) == 12, "mesh cache expects packed vectors");
+static_assert(sizeof(FaceChunk) == 40, "mesh cache expects packed face chunks");
+
+struct CacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	// What the source looked like when the cache was built
+	unsigned long long sourceSize;
+	long long sourceTime;
+	unsigned long long sourceHash;
+	// Bytes of the whole file, a torn write comes out shorter
+	unsigned long long fileSize;
+	unsigned int vertexCount;
+	unsigned int faceCount;
+	unsigned int chunkCount;
+	unsigned int chunkVertCount;
+	unsigned int flags;
+	float min[3];
+	float max[3];
+	unsigned int reserved;
+	// Array offsets from the start of the file, 0 for arrays left out
+	unsigned long long positions;
+	unsigned long long normals;
+	unsigned long long texcoords;
+	unsigned long long faces;
+	unsigned long long chunks;
+	unsigned long long chunkVerts;
+};
+
+static size_t alignUp(size_t n)
+{
+	return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// True when count elements at offset lie inside a file of size bytes
+static bool inside(unsigned long long offset, unsigned int count, size_t element, size_t size)
+{
+	if (count == 0)
+		return true;
+	return offset % ALIGNMENT == 0 && offset >= sizeof(CacheHeader) && offset <= size && count <= (size - offset) / element;
+}
+
+MeshCache::MeshCache() :
+	mapped(NULL), mappedSize(0), mapping(NULL), normals(NULL), texcoords(NULL), chunkVertCount(0),
+	min(0.0f), max(0.0f), cached(false)
+{
+}
+
+MeshCache::~MeshCache()
+{
+	close();
+}
+
+std::string MeshCache::cachePath(const std::string& filename)
+{
+	return filename + ".cache";
+}
+
+// FNV-1a over 8 byte words, then the bytes left over. Only has to notice a
+// changed file, and a word at a time keeps it well below the parse it saves.
+bool MeshCache::readSource(const std::string& filename, Source& source)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		return false;
+	source.size = (unsigned long long)st.st_size;
+	source.time = (long long)st.st_mtime;
+
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+		return false;
+	std::vector<unsigned char> block(64 * 1024);
+	unsigned long long hash = 14695981039346656037ULL;
+	size_t n;
+	while ((n = fread(&block[0], 1, block.size(), file)) > 0)
+	{
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			unsigned long long word;
+			memcpy(&word, &block[i], sizeof(word));
+			hash = (hash ^ word) * 1099511628211ULL;
+		}
+		for (; i < n; ++i)
+			hash = (hash ^ block[i]) * 1099511628211ULL;
+	}
+	fclose(file);
+	source.hash = hash;
+	return true;
+}
+
+size_t MeshCache::buildImage(const XML_Mesh& mesh, const Source& source, std::vector<unsigned long long>& image)
+{
+	size_t n = mesh.verts.size();
+	bool hasNormals = n > 0 && mesh.normals.size() == n;
+	bool hasTexcoords = n > 0 && mesh.texcoords.size() == n;
+
+	CacheHeader h;
+	memset(&h, 0, sizeof(h));
+	h.magic = MAGIC;
+	h.version = VERSION;
+	h.sourceSize = source.size;
+	h.sourceTime = source.time;
+	h.sourceHash = source.hash;
+	h.vertexCount = (unsigned int)n;
+	h.faceCount = (unsigned int)mesh.faces.size();
+	h.chunkCount = (unsigned int)mesh.chunks.size();
+	h.chunkVertCount = (unsigned int)mesh.chunkVerts.size();
+	h.flags = (hasNormals ? HAS_NORMALS : 0) | (hasTexcoords ? HAS_TEXCOORDS : 0);
+
+	if (n > 0)
+	{
+		vec3f lo = mesh.verts[0], hi = mesh.verts[0];
+		for (size_t i = 1; i < n; ++i)
+		{
+			const vec3f& p = mesh.verts[i];
+			lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+		h.min[0] = lo.x; h.min[1] = lo.y; h.min[2] = lo.z;
+		h.max[0] = hi.x; h.max[1] = hi.y; h.max[2] = hi.z;
+	}
+
+	size_t offset = alignUp(sizeof(CacheHeader));
+	h.positions = offset;
+	offset = alignUp(offset + n * sizeof(vec3f));
+	if (hasNormals)
+	{
+		h.normals = offset;
+		offset = alignUp(offset + n * sizeof(vec3f));
+	}
+	if (hasTexcoords)
+	{
+		h.texcoords = offset;
+		offset = alignUp(offset + n * sizeof(vec2f));
+	}
+	h.faces = offset;
+	offset = alignUp(offset + mesh.faces.size() * sizeof(vec3i));
+	h.chunks = offset;
+	offset = alignUp(offset + mesh.chunks.size() * sizeof(FaceChunk));
+	h.chunkVerts = offset;
+	offset = alignUp(offset + mesh.chunkVerts.size() * sizeof(int));
+	h.fileSize = offset;
+
+	// Zeroed, so the padding between arrays is the same on every write
+	image.assign(offset / sizeof(unsigned long long), 0);
+	char* data = reinterpret_cast<char*>(&image[0]);
+	memcpy(data, &h, sizeof(h));
+	if (n > 0)
+		memcpy(data + h.positions, &mesh.verts[0], n * sizeof(vec3f));
+	if (hasNormals)
+		memcpy(data + h.normals, &mesh.normals[0], n * sizeof(vec3f));
+	if (hasTexcoords)
+		memcpy(data + h.texcoords, &mesh.texcoords[0], n * sizeof(vec2f));
+	if (!mesh.faces.empty())
+		memcpy(data + h.faces, &mesh.faces[0], mesh.faces.size() * sizeof(vec3i));
+	if (!mesh.chunks.empty())
+		memcpy(data + h.chunks, &mesh.chunks[0], mesh.chunks.size() * sizeof(FaceChunk));
+	if (!mesh.chunkVerts.empty())
+		memcpy(data + h.chunkVerts, &mesh.chunkVerts[0], mesh.chunkVerts.size() * sizeof(int));
+	return offset;
+}
+
+bool MeshCache::attach(const char* data, size_t size, const Source& source)
+{
+	if (size < sizeof(CacheHeader))
+		return false;
+	CacheHeader h;
+	memcpy(&h, data, sizeof(h));
+	if (h.magic != MAGIC || h.version != VERSION || h.fileSize != size)
+		return false;
+	if (h.sourceSize != source.size || h.sourceTime != source.time || h.sourceHash != source.hash)
+		return false;
+
+	// The slicer trusts every index it reads, so a damaged file has to stop here
+	bool hasNormals = (h.flags & HAS_NORMALS) != 0;
+	bool hasTexcoords = (h.flags & HAS_TEXCOORDS) != 0;
+	if (!inside(h.positions, h.vertexCount, sizeof(vec3f), size)
+		|| (hasNormals && !inside(h.normals, h.vertexCount, sizeof(vec3f), size))
+		|| (hasTexcoords && !inside(h.texcoords, h.vertexCount, sizeof(vec2f), size))
+		|| !inside(h.faces, h.faceCount, sizeof(vec3i), size)
+		|| !inside(h.chunks, h.chunkCount, sizeof(FaceChunk), size)
+		|| !inside(h.chunkVerts, h.chunkVertCount, sizeof(int), size))
+		return false;
+
+	int vertexCount = (int)h.vertexCount;
+	const vec3i* faces = reinterpret_cast<const vec3i*>(data + h.faces);
+	for (unsigned int i = 0; i < h.faceCount; ++i)
+	{
+		const vec3i& f = faces[i];
+		if (f.x < 0 || f.y < 0 || f.z < 0 || f.x >= vertexCount || f.y >= vertexCount || f.z >= vertexCount)
+			return false;
+	}
+	const FaceChunk* chunks = reinterpret_cast<const FaceChunk*>(data + h.chunks);
+	const int* chunkVerts = reinterpret_cast<const int*>(data + h.chunkVerts);
+	int faceEnd = 0;
+	for (unsigned int c = 0; c < h.chunkCount; ++c)
+	{
+		const FaceChunk& chunk = chunks[c];
+		if (chunk.faceBegin != faceEnd || chunk.faceEnd < chunk.faceBegin || chunk.faceEnd > (int)h.faceCount
+			|| chunk.vertBegin < 0 || chunk.vertEnd < chunk.vertBegin || chunk.vertEnd > (int)h.chunkVertCount)
+			return false;
+		faceEnd = chunk.faceEnd;
+	}
+	if (h.chunkCount > 0 && faceEnd != (int)h.faceCount)
+		return false;
+	for (unsigned int i = 0; i < h.chunkVertCount; ++i)
+		if (chunkVerts[i] < 0 || chunkVerts[i] >= vertexCount)
+			return false;
+
+	host = HostMesh();
+	host.vertexCount = vertexCount;
+	host.faceCount = (int)h.faceCount;
+	host.verts = vertexCount > 0 ? reinterpret_cast<const vec3f*>(data + h.positions) : NULL;
+	normals = hasNormals && vertexCount > 0 ? reinterpret_cast<const vec3f*>(data + h.normals) : NULL;
+	texcoords = hasTexcoords && vertexCount > 0 ? reinterpret_cast<const vec2f*>(data + h.texcoords) : NULL;
+	if (normals && texcoords)
+	{
+		host.normals = normals;
+		host.texcoords = texcoords;
+	}
+	host.faces = h.faceCount > 0 ? faces : NULL;
+	if (h.chunkCount > 0)
+	{
+		host.chunks = chunks;
+		host.chunkVerts = chunkVerts;
+		host.chunkCount = (int)h.chunkCount;
+	}
+	chunkVertCount = (int)h.chunkVertCount;
+	min = vec3f(h.min[0], h.min[1], h.min[2]);
+	max = vec3f(h.max[0], h.max[1], h.max[2]);
+	return true;
+}
+
+bool MeshCache::open(const std::string& filename)
+{
+	close();
+
+	Source source;
+	if (!readSource(filename, source))
+	{
+		error = "cannot open file";
+		return false;
+	}
+
+	std::string path = cachePath(filename);
+	if (map(path))
+	{
+		if (attach(static_cast<const char*>(mapped), mappedSize, source))
+		{
+			cached = true;
+			LOG_DEBUG(LOG_MESH, "Mapped " << path << ", " << host.vertexCount << " verts, " << host.faceCount << " faces");
+			return true;
+		}
+		LOG_INFO(LOG_MESH, path << " is out of date, rebuilding it");
+		unmap();
+	}
+
+	XML_Mesh mesh = XML_Mesh(std::vector<vec3f>(), std::vector<vec3i>());
+	MeshXmlReader reader;
+	if (!reader.read(filename, mesh))
+	{
+		error = reader.getError();
+		return false;
+	}
+	mesh.buildChunks();
+	size_t bytes = buildImage(mesh, source, image);
+
+	// Written under another name and moved over, so a crash never leaves
+	// half a cache behind
+	std::string temp = path + ".tmp";
+	FILE* file = fopen(temp.c_str(), "wb");
+	bool written = file && fwrite(&image[0], 1, bytes, file) == bytes;
+	if (file)
+		written = fclose(file) == 0 && written;
+#ifdef _WIN32
+	// rename does not replace on Windows
+	if (written)
+		remove(path.c_str());
+#endif
+	written = written && rename(temp.c_str(), path.c_str()) == 0;
+	if (file && !written)
+		remove(temp.c_str());
+
+	if (written && map(path) && attach(static_cast<const char*>(mapped), mappedSize, source))
+	{
+		std::vector<unsigned long long>().swap(image);
+		LOG_INFO(LOG_MESH, "Built " << path << ", " << bytes << " bytes");
+		return true;
+	}
+	unmap();
+	LOG_WARN(LOG_MESH, "Could not write " << path << ", keeping " << filename << " in memory");
+	attach(reinterpret_cast<const char*>(&image[0]), bytes, source);
+	return true;
+}
+
+void MeshCache::close()
+{
+	unmap();
+	std::vector<unsigned long long>().swap(image);
+	host = HostMesh();
+	normals = NULL;
+	texcoords = NULL;
+	chunkVertCount = 0;
+	min = max = vec3f(0.0f);
+	cached = false;
+	error.clear();
+}
+
+bool MeshCache::isOpen() const
+{
+	return mapped != NULL || !image.empty();
+}
+
+bool MeshCache::wasCached() const
+{
+	return cached;
+}
+
+const HostMesh& MeshCache::view() const
+{
+	return host;
+}
+
+const vec3f& MeshCache::getMin() const
+{
+	return min;
+}
+
+const vec3f& MeshCache::getMax() const
+{
+	return max;
+}
+
+void MeshCache::copyTo(XML_Mesh& mesh) const
+{
+	int n = host.vertexCount;
+	mesh.verts.assign(host.verts, host.verts + n);
+	if (normals)
+		mesh.normals.assign(normals, normals + n);
+	else
+		mesh.normals.clear();
+	if (texcoords)
+		mesh.texcoords.assign(texcoords, texcoords + n);
+	else
+		mesh.texcoords.clear();
+	mesh.faces.assign(host.faces, host.faces + host.faceCount);
+	mesh.chunks.assign(host.chunks, host.chunks + host.chunkCount);
+	mesh.chunkVerts.assign(host.chunkVerts, host.chunkVerts + chunkVertCount);
+}
+
+const std::string& MeshCache::getError() const
+{
+	return error;
+}
+
+bool MeshCache::map(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE view = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!view)
+		return false;
+	mapped = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+	if (!mapped)
+	{
+		CloseHandle(view);
+		return false;
+	}
+	mapping = view;
+	mappedSize = (size_t)size.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file open by itself
+	::close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	mapped = p;
+	mappedSize = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+void MeshCache::unmap()
+{
+	if (!mapped)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(mapped);
+	CloseHandle(static_cast<HANDLE>(mapping));
+#else
+	munmap(mapped, mappedSize);
+#endif
+	mapped = NULL;
+	mapping = NULL;
+	mappedSize = 0;
+}
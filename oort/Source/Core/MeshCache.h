@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Binary copy of a .mesh.xml, written next to it as <file>.cache the first
+// time the file is loaded and mapped straight into memory on later runs.
+// Positions, normals, texcoords, faces and the chunks buildChunks makes are
+// each one 16 byte aligned array in the file, so view() slices the mapped
+// pages where they are, nothing is parsed or copied. The header keeps the
+// format version, the bounds, and the source's size, modification time and
+// a hash of its bytes; a cache that disagrees with the source on any of
+// them is rebuilt from the XML.
+class MeshCache {
+public:
+	MeshCache();
+	~MeshCache();
+
+	// Maps the cache of filename, building it first when it is missing or
+	// stale. A cache that cannot be written, e.g. next to a read only
+	// install, is kept in memory instead. False when the XML cannot be read,
+	// with the reason in getError().
+	bool open(const std::string& filename);
+	void close();
+
+	bool isOpen() const;
+	// True when open found a valid cache and parsed nothing
+	bool wasCached() const;
+
+	// Valid until close, for MeshSlicer::loadMesh
+	const HostMesh& view() const;
+	const vec3f& getMin() const;
+	const vec3f& getMax() const;
+	// Copies the arrays into mesh, chunks included, for code that needs a
+	// mesh of its own
+	void copyTo(XML_Mesh& mesh) const;
+
+	const std::string& getError() const;
+
+	static std::string cachePath(const std::string& filename);
+
+private:
+	// Size, modification time and hash of the .mesh.xml
+	struct Source
+	{
+		unsigned long long size;
+		long long time;
+		unsigned long long hash;
+	};
+
+	// Mapped file, or the image kept in memory when it could not be written
+	void* mapped;
+	size_t mappedSize;
+	void* mapping;
+	std::vector<unsigned long long> image;
+
+	HostMesh host;
+	// Kept apart from the view, which only has them in pairs
+	const vec3f* normals;
+	const vec2f* texcoords;
+	int chunkVertCount;
+	vec3f min;
+	vec3f max;
+	bool cached;
+	std::string error;
+
+	bool map(const std::string& path);
+	void unmap();
+	// Points the view at data, false when it is not a cache of source
+	bool attach(const char* data, size_t size, const Source& source);
+
+	static bool readSource(const std::string& filename, Source& source);
+	// Lays mesh out as a cache file in image, returns its size in bytes
+	static size_t buildImage(const XML_Mesh& mesh, const Source& source, std::vector<unsigned long long>& image);
+};
@@ -0,0 +1,231 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+
+// Weights from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const float LAST_FACE_SCORE = 0.75f;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+MeshOptimizer::MeshOptimizer()
+{
+	for (int i = 0; i < SCORE_CACHE_SIZE; ++i)
+	{
+		// The three corners of the face just drawn score the same, whichever
+		// way round they went in
+		if (i < 3)
+			positionScore[i] = LAST_FACE_SCORE;
+		else
+			positionScore[i] = powf(1.0f - (float)(i - 3) / (SCORE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+	// Vertices with few faces left are worth finishing off
+	valenceScore[0] = 0.0f;
+	for (int i = 1; i < VALENCE_TABLE_SIZE; ++i)
+		valenceScore[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+}
+
+float MeshOptimizer::score(int vertex) const
+{
+	int left = remaining[vertex];
+	if (left == 0)
+		return -1.0f;
+	int position = cachePosition[vertex];
+	float s = position >= 0 ? positionScore[position] : 0.0f;
+	return s + valenceScore[left < VALENCE_TABLE_SIZE ? left : VALENCE_TABLE_SIZE - 1];
+}
+
+CacheStats MeshOptimizer::optimize(XML_Mesh& mesh)
+{
+	CacheStats stats;
+	int vertexCount = (int)mesh.verts.size();
+	stats.acmrBefore = cacheMissRatio(mesh.faces, vertexCount);
+	if (!mesh.faces.empty())
+	{
+		reorderFaces(mesh.faces, vertexCount);
+		reorderVertices(mesh);
+	}
+	stats.acmrAfter = cacheMissRatio(mesh.faces, (int)mesh.verts.size());
+	return stats;
+}
+
+float MeshOptimizer::cacheMissRatio(const std::vector<vec3i>& faces, int vertexCount, int cacheSize)
+{
+	if (faces.empty())
+		return 0.0f;
+
+	// A vertex is cached while fewer than cacheSize misses came after its own
+	int time = 0;
+	cacheTime.assign(vertexCount, -cacheSize - 1);
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		const int corners[3] = { faces[f].x, faces[f].y, faces[f].z };
+		for (int c = 0; c < 3; ++c)
+		{
+			if (time - cacheTime[corners[c]] >= cacheSize)
+				cacheTime[corners[c]] = time++;
+		}
+	}
+	return (float)time / faces.size();
+}
+
+void MeshOptimizer::reorderFaces(std::vector<vec3i>& faces, int vertexCount)
+{
+	int faceCount = (int)faces.size();
+
+	remaining.assign(vertexCount, 0);
+	for (int f = 0; f < faceCount; ++f)
+	{
+		remaining[faces[f].x]++;
+		remaining[faces[f].y]++;
+		remaining[faces[f].z]++;
+	}
+	adjacencyStart.resize(vertexCount + 1);
+	adjacencyStart[0] = 0;
+	for (int v = 0; v < vertexCount; ++v)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+	adjacency.resize(adjacencyStart[vertexCount]);
+	remaining.assign(vertexCount, 0);
+	for (int f = 0; f < faceCount; ++f)
+	{
+		const int corners[3] = { faces[f].x, faces[f].y, faces[f].z };
+		for (int c = 0; c < 3; ++c)
+			adjacency[adjacencyStart[corners[c]] + remaining[corners[c]]++] = f;
+	}
+
+	cachePosition.assign(vertexCount, -1);
+	vertexScore.resize(vertexCount);
+	for (int v = 0; v < vertexCount; ++v)
+		vertexScore[v] = score(v);
+	emitted.assign(faceCount, 0);
+	reordered.clear();
+	reordered.reserve(faceCount);
+
+	// The three new corners push the rest back, so the cache briefly holds
+	// three more than it models before they are evicted
+	int cache[SCORE_CACHE_SIZE + 3];
+	int nextCache[SCORE_CACHE_SIZE + 3];
+	int cached = 0;
+
+	int best = -1;
+	int cursor = 0;
+	while ((int)reordered.size() < faceCount)
+	{
+		// Nothing in the cache has faces left, start again from the first
+		// face not drawn yet, which keeps the scan linear
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = cursor;
+		}
+
+		const vec3i face = faces[best];
+		reordered.push_back(face);
+		emitted[best] = 1;
+
+		const int corners[3] = { face.x, face.y, face.z };
+		int next = 0;
+		for (int c = 0; c < 3; ++c)
+		{
+			int v = corners[c];
+			int* list = &adjacency[adjacencyStart[v]];
+			int last = --remaining[v];
+			for (int i = 0; i <= last; ++i)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[last];
+					break;
+				}
+			}
+			bool present = false;
+			for (int i = 0; i < next; ++i)
+				present |= nextCache[i] == v;
+			if (!present)
+				nextCache[next++] = v;
+		}
+		for (int i = 0; i < cached; ++i)
+		{
+			int v = cache[i];
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+				nextCache[next++] = v;
+		}
+
+		// Rescore everything that moved, then only the faces of cached
+		// vertices can be the next best
+		for (int i = 0; i < next; ++i)
+		{
+			int v = nextCache[i];
+			cachePosition[v] = i < SCORE_CACHE_SIZE ? i : -1;
+			vertexScore[v] = score(v);
+		}
+		cached = next < SCORE_CACHE_SIZE ? next : SCORE_CACHE_SIZE;
+		for (int i = 0; i < cached; ++i)
+			cache[i] = nextCache[i];
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < cached; ++i)
+		{
+			int v = cache[i];
+			const int* list = &adjacency[adjacencyStart[v]];
+			for (int j = 0; j < remaining[v]; ++j)
+			{
+				int f = list[j];
+				float s = vertexScore[faces[f].x] + vertexScore[faces[f].y] + vertexScore[faces[f].z];
+				if (s > bestScore)
+				{
+					bestScore = s;
+					best = f;
+				}
+			}
+		}
+	}
+
+	faces.swap(reordered);
+}
+
+void MeshOptimizer::reorderVertices(XML_Mesh& mesh)
+{
+	int vertexCount = (int)mesh.verts.size();
+	remap.assign(vertexCount, -1);
+	int used = 0;
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		vec3i& face = mesh.faces[f];
+		if (remap[face.x] < 0)
+			remap[face.x] = used++;
+		if (remap[face.y] < 0)
+			remap[face.y] = used++;
+		if (remap[face.z] < 0)
+			remap[face.z] = used++;
+		face = vec3i(remap[face.x], remap[face.y], remap[face.z]);
+	}
+
+	vertScratch.resize(used);
+	for (int v = 0; v < vertexCount; ++v)
+		if (remap[v] >= 0)
+			vertScratch[remap[v]] = mesh.verts[v];
+	mesh.verts.swap(vertScratch);
+
+	if ((int)mesh.normals.size() == vertexCount)
+	{
+		vertScratch.resize(used);
+		for (int v = 0; v < vertexCount; ++v)
+			if (remap[v] >= 0)
+				vertScratch[remap[v]] = mesh.normals[v];
+		mesh.normals.swap(vertScratch);
+	}
+	if ((int)mesh.texcoords.size() == vertexCount)
+	{
+		uvScratch.resize(used);
+		for (int v = 0; v < vertexCount; ++v)
+			if (remap[v] >= 0)
+				uvScratch[remap[v]] = mesh.texcoords[v];
+		mesh.texcoords.swap(uvScratch);
+	}
+
+	mesh.chunks.clear();
+	mesh.chunkVerts.clear();
+}
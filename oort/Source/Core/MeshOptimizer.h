@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Average cache miss ratio, transformed vertices per face, of a mesh before
+// and after it was optimized. 3 is every corner missing, 0.5 is about the
+// best a closed mesh gets.
+struct CacheStats
+{
+	float acmrBefore;
+	float acmrAfter;
+};
+
+// Reorders a mesh for the GPU. Faces are sorted for the post transform
+// cache with Forsyth's linear speed heuristic, then vertices are renumbered
+// in the order the faces first use them so fetches walk the vertex buffer
+// forwards. Both passes are linear in the face count and keep their scratch
+// between runs, so one optimizer per thread can run on every mesh the game
+// produces.
+class MeshOptimizer {
+public:
+	// Entries of the FIFO the miss ratio is measured with, a typical
+	// post transform cache
+	static const int MEASURE_CACHE_SIZE = 16;
+
+	MeshOptimizer();
+
+	// Vertices no face uses are dropped. Chunks no longer match the faces
+	// afterwards and are cleared, buildChunks again before slicing.
+	CacheStats optimize(XML_Mesh& mesh);
+
+	// Transformed vertices per face with a FIFO cache of cacheSize entries
+	float cacheMissRatio(const std::vector<vec3i>& faces, int vertexCount, int cacheSize = MEASURE_CACHE_SIZE);
+
+private:
+	// Size of the LRU cache Forsyth's scores model
+	static const int SCORE_CACHE_SIZE = 32;
+	// Vertices with more faces left than this all get the last valence score
+	static const int VALENCE_TABLE_SIZE = 32;
+
+	float positionScore[SCORE_CACHE_SIZE];
+	float valenceScore[VALENCE_TABLE_SIZE];
+
+	// Faces of each vertex that are not emitted yet, packed per vertex
+	std::vector<int> adjacency;
+	std::vector<int> adjacencyStart;
+	std::vector<int> remaining;
+	std::vector<int> cachePosition;
+	std::vector<float> vertexScore;
+	std::vector<char> emitted;
+	std::vector<vec3i> reordered;
+
+	std::vector<int> cacheTime;
+	std::vector<int> remap;
+	std::vector<vec3f> vertScratch;
+	std::vector<vec2f> uvScratch;
+
+	float score(int vertex) const;
+	void reorderFaces(std::vector<vec3i>& faces, int vertexCount);
+	void reorderVertices(XML_Mesh& mesh);
+};
@@ -0,0 +1,932 @@
+#include "MeshSlicer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Same on-plane tolerance as sliceByPlane
+static const float SHATTER_EPSILON = 1e-5f;
+
+static const size_t MAX_SHATTER_PLANES = 32;
+
+// A Voronoi cell is cut out by its bisectors with all other seeds
+static const size_t MAX_VORONOI_SEEDS = MAX_SHATTER_PLANES + 1;
+
+// Planes meeting at a smaller angle than this have their common point taken
+// on the edge being split instead of solved for
+static const float MEET_EPSILON = 1e-3f;
+
+// Multi plane clipper behind shatterByPlanes and shatterVoronoi. Every host
+// face is walked once and split against all planes; vertices created on a
+// cut are shared through one edge -> vertex map per plane, the same way the
+// single plane slice does it. Vertex ids past the host's count refer to added.
+//
+// Caps are cut along the lines where planes meet before they are
+// triangulated, from outlines made of the very points the side faces have,
+// so a cell's caps and sides share every vertex and fragments are closed.
+template <class Layout>
+class Shatter
+{
+public:
+	typedef typename Layout::Vertex Vertex;
+
+	Shatter(const HostMesh& host, bool caps) :
+		mHost(host), mCaps(caps), mHostCount(host.vertexCount), mInsideOnly(false)
+	{}
+
+	void byPlanes(const std::vector<vec3f>& points, const std::vector<vec3f>& normals, std::vector<Fragment>& out);
+	void voronoi(const std::vector<vec3f>& seeds, std::vector<Fragment>& out);
+
+private:
+	struct Plane
+	{
+		vec3f n;
+		float d;
+	};
+
+	typedef std::vector<int> Polygon;
+
+	// Part of a cross section inside one cell of the other planes, as loops
+	// of vertex ids back to back like CutCap's. along is the plane the edge
+	// leaving each point lies in besides its own, -1 on the outline.
+	struct Region
+	{
+		std::vector<int> verts;
+		std::vector<int> along;
+		std::vector<int> loopStart;
+		unsigned int code;
+	};
+
+	// Run of kept edges of a loop, count points from first on
+	struct Chain
+	{
+		int begin;
+		int size;
+		int first;
+		int count;
+	};
+
+	const HostMesh& mHost;
+	bool mCaps;
+	int mHostCount;
+
+	std::vector<Plane> mPlanes;
+	// Signed distance of every host vertex to every plane, plane major
+	std::vector<float> mDist;
+	// Sign code of every host vertex, and whether it lies on some plane
+	std::vector<unsigned int> mVertexCodes;
+	std::vector<char> mVertexOn;
+	std::vector<EdgeMap> mEdgeVerts;
+	std::vector<Vertex> mAdded;
+	// Edges the face pieces left in every plane, in the winding of its positive side
+	std::vector<std::vector<std::pair<int, int> > > mSegments;
+	// Points where three planes meet, by their sorted indices
+	std::unordered_map<unsigned int, int> mMeets;
+	// Faces of every cell
+	std::vector<std::vector<vec3i> > mCells;
+
+	// Sign code -> cell
+	std::unordered_map<unsigned int, int> mCodes;
+	// Only the cell on the negative side of every plane is kept
+	bool mInsideOnly;
+
+	// Scratch
+	std::vector<Polygon> mWork;
+	std::vector<unsigned int> mWorkCodes;
+	Polygon mPos, mNeg;
+	std::vector<int> mSides;
+	std::vector<char> mOnPlane;
+	CutCap mCap;
+	std::vector<std::pair<vec3f, vec3f> > mCapSegments;
+	std::vector<Region> mRegions, mNextRegions;
+	// Region being clipped with its crossings put in, and their sides
+	Region mCut;
+	std::vector<int> mCutSides;
+	std::vector<char> mKeep;
+	std::vector<Chain> mChains;
+	std::vector<std::pair<float, int> > mEntries, mExits;
+	std::vector<int> mChainNext;
+	std::vector<char> mChainDone;
+	std::vector<std::pair<double, unsigned int> > mMeetOrder;
+	std::vector<vec3f> mMeetPoints;
+	std::vector<unsigned int> mMeetKeys;
+	std::vector<int> mMeetMade;
+
+	void addPlane(const vec3f& point, const vec3f& normal);
+	void computeDistances();
+	vec3f position(int v) const;
+	float distance(int plane, int v) const;
+	int side(int plane, int v) const;
+	Vertex vertex(int v) const;
+	int edgeVertex(int plane, int a, int b);
+	void computeMeets();
+	int meetVertex(int p, int q, int r, int a, int b);
+	void split(const Polygon& in, int plane, Polygon& pos, Polygon& neg);
+	void emit(const Polygon& poly, int cell);
+	int cellOf(unsigned int code);
+
+	void arrange(const Polygon& poly);
+	void walkFaces();
+
+	void capPlanes();
+	void capPlane(int plane);
+	void clipRegion(int plane, const Region& in, int by, Region& pos, Region& neg);
+	void gather(int sign, const vec3f& dir, int by, Region& out);
+	void closeLoop(Region& out, size_t start);
+	void emitCaps(int plane);
+
+	void build(std::vector<Fragment>& out);
+};
+
+template <class Layout>
+void Shatter<Layout>::addPlane(const vec3f& point, const vec3f& normal)
+{
+	float l = sqrt(normal.x*normal.x + normal.y*normal.y + normal.z*normal.z);
+	Plane p;
+	p.n = vec3f(normal.x / l, normal.y / l, normal.z / l);
+	p.d = -(p.n.x*point.x + p.n.y*point.y + p.n.z*point.z);
+	mPlanes.push_back(p);
+}
+
+template <class Layout>
+void Shatter<Layout>::computeDistances()
+{
+	const vec3f* verts = mHost.verts;
+	mDist.resize(mPlanes.size() * mHostCount);
+	mVertexCodes.assign(mHostCount, 0);
+	mVertexOn.assign(mHostCount, 0);
+	for (size_t k = 0; k < mPlanes.size(); ++k)
+	{
+		const Plane& p = mPlanes[k];
+		float* d = &mDist[k * mHostCount];
+		for (int i = 0; i < mHostCount; ++i)
+		{
+			d[i] = p.n.x*verts[i].x + p.n.y*verts[i].y + p.n.z*verts[i].z + p.d;
+			if (d[i] > SHATTER_EPSILON)
+				mVertexCodes[i] |= 1u << k;
+			else if (d[i] >= -SHATTER_EPSILON)
+				mVertexOn[i] = 1;
+		}
+	}
+	mEdgeVerts.resize(mPlanes.size());
+	for (size_t k = 0; k < mPlanes.size(); ++k)
+		mEdgeVerts[k].clear();
+	mSegments.assign(mPlanes.size(), std::vector<std::pair<int, int> >());
+}
+
+template <class Layout>
+vec3f Shatter<Layout>::position(int v) const
+{
+	return v < mHostCount ? mHost.verts[v] : mAdded[v - mHostCount].p;
+}
+
+// Host vertices use the table, created ones are evaluated on the spot
+template <class Layout>
+float Shatter<Layout>::distance(int plane, int v) const
+{
+	if (v < mHostCount)
+		return mDist[plane * mHostCount + v];
+	const Plane& p = mPlanes[plane];
+	const vec3f& q = mAdded[v - mHostCount].p;
+	return p.n.x*q.x + p.n.y*q.y + p.n.z*q.z + p.d;
+}
+
+template <class Layout>
+int Shatter<Layout>::side(int plane, int v) const
+{
+	float d = distance(plane, v);
+	return d > SHATTER_EPSILON ? 1 : (d < -SHATTER_EPSILON ? -1 : 0);
+}
+
+template <class Layout>
+typename Shatter<Layout>::Vertex Shatter<Layout>::vertex(int v) const
+{
+	return v < mHostCount ? Layout::fetch(mHost, v) : mAdded[v - mHostCount];
+}
+
+template <class Layout>
+int Shatter<Layout>::edgeVertex(int plane, int a, int b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	unsigned long long key = ((unsigned long long)a << 32) | (unsigned int)b;
+	int index = mHostCount + (int)mAdded.size();
+	int found = mEdgeVerts[plane].insert(key, index);
+	if (found != index)
+		return found;
+
+	// Always from the end below the plane, not the lower index: seam copies
+	// of an edge and the caps' copies of a cut edge come with other indices
+	// and must still get the same bits
+	int from = distance(plane, a) < 0.0f ? a : b, to = from == a ? b : a;
+	float df = distance(plane, from);
+	float t = df / (df - distance(plane, to));
+	mAdded.push_back(Layout::lerp(vertex(from), vertex(to), t));
+	return index;
+}
+
+// Solves for the points where three planes meet inside the host's bounds,
+// best conditioned first. More than three planes may meet at one point, e.g.
+// planes through a hit point; the point solved most precisely stands for
+// every triple whose planes it lies on, so all caps through it share it.
+template <class Layout>
+void Shatter<Layout>::computeMeets()
+{
+	mMeets.clear();
+	if (mHostCount == 0)
+		return;
+	const vec3f* verts = mHost.verts;
+	vec3f lo = verts[0], hi = verts[0];
+	for (int i = 1; i < mHostCount; ++i)
+	{
+		lo = vec3f(std::min(lo.x, verts[i].x), std::min(lo.y, verts[i].y), std::min(lo.z, verts[i].z));
+		hi = vec3f(std::max(hi.x, verts[i].x), std::max(hi.y, verts[i].y), std::max(hi.z, verts[i].z));
+	}
+
+	// Solved in double, so a point lands on its planes within their own rounding
+	int count = (int)mPlanes.size();
+	std::vector<std::pair<double, unsigned int> >& order = mMeetOrder;
+	std::vector<vec3f>& points = mMeetPoints;
+	std::vector<unsigned int>& keys = mMeetKeys;
+	order.clear();
+	points.clear();
+	keys.clear();
+	for (int i = 0; i < count; ++i)
+	{
+		for (int j = i + 1; j < count; ++j)
+		{
+			for (int k = j + 1; k < count; ++k)
+			{
+				const Plane* pl[3] = { &mPlanes[i], &mPlanes[j], &mPlanes[k] };
+				vec3d n[3], c[3];
+				for (int e = 0; e < 3; ++e)
+					n[e] = vec3d(pl[e]->n.x, pl[e]->n.y, pl[e]->n.z);
+				for (int e = 0; e < 3; ++e)
+				{
+					const vec3d& f = n[(e + 1) % 3];
+					const vec3d& g = n[(e + 2) % 3];
+					c[e] = vec3d(f.y*g.z - f.z*g.y, f.z*g.x - f.x*g.z, f.x*g.y - f.y*g.x);
+				}
+				double det = n[0].x*c[0].x + n[0].y*c[0].y + n[0].z*c[0].z;
+				if (fabs(det) < MEET_EPSILON)
+					continue;
+
+				vec3d x(0.0);
+				for (int e = 0; e < 3; ++e)
+				{
+					double s = -pl[e]->d / det;
+					x = vec3d(x.x + c[e].x*s, x.y + c[e].y*s, x.z + c[e].z*s);
+				}
+				vec3f p((float)x.x, (float)x.y, (float)x.z);
+				if (p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x > hi.x || p.y > hi.y || p.z > hi.z)
+					continue;
+				order.push_back(std::make_pair(-fabs(det), (unsigned int)points.size()));
+				points.push_back(p);
+				keys.push_back((unsigned int)(i << 10 | j << 5 | k));
+			}
+		}
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<int>& made = mMeetMade;
+	made.clear();
+	for (size_t m = 0; m < order.size(); ++m)
+	{
+		unsigned int key = keys[order[m].second];
+		int i = key >> 10, j = key >> 5 & 31, k = key & 31;
+		int index = -1;
+		for (size_t e = 0; e < made.size() && index < 0; ++e)
+			if (side(i, made[e]) == 0 && side(j, made[e]) == 0 && side(k, made[e]) == 0)
+				index = made[e];
+		if (index < 0)
+		{
+			index = mHostCount + (int)mAdded.size();
+			mAdded.push_back(Layout::make(points[order[m].second], mPlanes[i].n, vec2f()));
+			made.push_back(index);
+		}
+		mMeets[key] = index;
+	}
+}
+
+// The point planes p, q and r share. a-b is the edge of p's cap along q
+// being split by r, which is used where the planes nearly share a line.
+template <class Layout>
+int Shatter<Layout>::meetVertex(int p, int q, int r, int a, int b)
+{
+	int i = std::min(p, std::min(q, r));
+	int k = std::max(p, std::max(q, r));
+	int j = p + q + r - i - k;
+	unsigned int key = (unsigned int)(i << 10 | j << 5 | k);
+	std::unordered_map<unsigned int, int>::iterator it = mMeets.find(key);
+	if (it != mMeets.end())
+		return it->second;
+	int index = edgeVertex(r, a, b);
+	mMeets[key] = index;
+	return index;
+}
+
+// Splits a convex polygon, keeping its winding on both sides. Vertices on the
+// plane go to both, a polygon touching it from one side stays whole. The
+// edge a piece leaves in the plane goes on its outline for the caps.
+template <class Layout>
+void Shatter<Layout>::split(const Polygon& in, int plane, Polygon& pos, Polygon& neg)
+{
+	pos.clear();
+	neg.clear();
+
+	int n = (int)in.size();
+	mSides.resize(n);
+	int* s = &mSides[0];
+	int above = 0, below = 0;
+	for (int k = 0; k < n; ++k)
+	{
+		s[k] = side(plane, in[k]);
+		above += s[k] > 0;
+		below += s[k] < 0;
+	}
+
+	if (below == 0 || above == 0)
+	{
+		if (below == 0)
+			pos = in;
+		else
+			neg = in;
+		// Off to one side, it only matters with an edge lying in the plane
+		if (!mCaps || above + below == 0)
+			return;
+		for (int k = 0; k < n; ++k)
+		{
+			int j = (k + 1) % n;
+			if (s[k] == 0 && s[j] == 0)
+			{
+				mSegments[plane].push_back(below == 0 ? std::make_pair(in[k], in[j]) : std::make_pair(in[j], in[k]));
+				break;
+			}
+		}
+		return;
+	}
+
+	mOnPlane.clear();
+	for (int k = 0; k < n; ++k)
+	{
+		int j = (k + 1) % n;
+		if (s[k] >= 0)
+		{
+			pos.push_back(in[k]);
+			mOnPlane.push_back(s[k] == 0);
+		}
+		if (s[k] <= 0)
+			neg.push_back(in[k]);
+		if (s[k] * s[j] < 0)
+		{
+			int c = edgeVertex(plane, in[k], in[j]);
+			pos.push_back(c);
+			mOnPlane.push_back(1);
+			neg.push_back(c);
+		}
+	}
+
+	if (!mCaps)
+		return;
+	int np = (int)pos.size();
+	for (int k = 0; k < np; ++k)
+	{
+		int j = (k + 1) % np;
+		if (mOnPlane[k] && mOnPlane[j])
+		{
+			mSegments[plane].push_back(std::make_pair(pos[k], pos[j]));
+			break;
+		}
+	}
+}
+
+template <class Layout>
+void Shatter<Layout>::emit(const Polygon& poly, int cell)
+{
+	if (cell < 0)
+		return;
+	std::vector<vec3i>& faces = mCells[cell];
+	for (size_t k = 1; k + 1 < poly.size(); ++k)
+		faces.push_back(vec3i(poly[0], poly[k], poly[k+1]));
+}
+
+// Every cell of the arrangement is a fragment of its own, unless only the
+// inside one is kept; -1 for cells that are dropped
+template <class Layout>
+int Shatter<Layout>::cellOf(unsigned int code)
+{
+	if (mInsideOnly)
+		return code == 0 ? 0 : -1;
+
+	std::unordered_map<unsigned int, int>::iterator it = mCodes.find(code);
+	if (it != mCodes.end())
+		return it->second;
+	int cell = (int)mCells.size();
+	mCells.push_back(std::vector<vec3i>());
+	mCodes[code] = cell;
+	return cell;
+}
+
+// Splits a polygon by every plane, bit k of a piece's code is set when it
+// lies on the positive side of plane k
+template <class Layout>
+void Shatter<Layout>::arrange(const Polygon& poly)
+{
+	mWork.resize(1);
+	mWork[0] = poly;
+	mWorkCodes.assign(1, 0);
+
+	for (int k = 0; k < (int)mPlanes.size(); ++k)
+	{
+		size_t count = mWork.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			split(mWork[i], k, mPos, mNeg);
+			if (mNeg.empty())
+				mWorkCodes[i] |= 1u << k;
+			else if (!mPos.empty())
+			{
+				mWork[i].swap(mNeg);
+				mWork.push_back(mPos);
+				mWorkCodes.push_back(mWorkCodes[i] | (1u << k));
+			}
+		}
+	}
+
+	for (size_t i = 0; i < mWork.size(); ++i)
+		emit(mWork[i], cellOf(mWorkCodes[i]));
+}
+
+// The single walk over the host faces. A face whose corners are off every
+// plane and share a code lies in that cell and needs no splitting.
+template <class Layout>
+void Shatter<Layout>::walkFaces()
+{
+	Polygon face(3);
+	for (int fi = 0; fi < mHost.faceCount; ++fi)
+	{
+		const vec3i& f = mHost.faces[fi];
+		unsigned int code = mVertexCodes[f.x];
+		if (!mVertexOn[f.x] && !mVertexOn[f.y] && !mVertexOn[f.z] && mVertexCodes[f.y] == code && mVertexCodes[f.z] == code)
+		{
+			int cell = cellOf(code);
+			if (cell >= 0)
+				mCells[cell].push_back(f);
+			continue;
+		}
+		face[0] = f.x;
+		face[1] = f.y;
+		face[2] = f.z;
+		arrange(face);
+	}
+}
+
+template <class Layout>
+void Shatter<Layout>::capPlanes()
+{
+	computeMeets();
+	for (int k = 0; k < (int)mPlanes.size(); ++k)
+		capPlane(k);
+}
+
+// Cuts the cross section on a plane into its parts in the cells of the other
+// planes and caps each of them
+template <class Layout>
+void Shatter<Layout>::capPlane(int plane)
+{
+	const std::vector<std::pair<int, int> >& segments = mSegments[plane];
+	mCapSegments.resize(segments.size());
+	for (size_t s = 0; s < segments.size(); ++s)
+		mCapSegments[s] = std::make_pair(position(segments[s].first), position(segments[s].second));
+	chainCutLoops(mCapSegments, mPlanes[plane].n, mCap);
+	if (mCap.loop.empty())
+		return;
+
+	// Seam copies are welded into the first id seen at their position
+	mRegions.resize(1);
+	Region& whole = mRegions[0];
+	whole.verts.clear();
+	whole.along.clear();
+	whole.loopStart = mCap.loopStart;
+	whole.code = 0;
+	for (size_t k = 0; k < mCap.loop.size(); ++k)
+	{
+		int end = mCap.firstEnd[mCap.loop[k]];
+		const std::pair<int, int>& s = segments[end >> 1];
+		whole.verts.push_back(end & 1 ? s.second : s.first);
+		whole.along.push_back(-1);
+	}
+
+	for (int k = 0; k < (int)mPlanes.size(); ++k)
+	{
+		if (k == plane)
+			continue;
+		mNextRegions.resize(2 * mRegions.size());
+		size_t count = 0;
+		for (size_t r = 0; r < mRegions.size(); ++r)
+		{
+			Region* out = &mNextRegions[count];
+			clipRegion(plane, mRegions[r], k, out[0], out[1]);
+			// Nothing on the positive side of a plane is inside
+			if (mInsideOnly)
+				out[0].verts.clear();
+			if (out[0].verts.empty())
+				std::swap(out[0], out[1]);
+			count += !out[0].verts.empty() + !out[1].verts.empty();
+		}
+		mNextRegions.resize(count);
+		mRegions.swap(mNextRegions);
+	}
+
+	emitCaps(plane);
+}
+// Splits a region of the cross section on plane by plane by, both sides
+// keep their loops' winding. Edges crossing it get a point first: on the
+// outline the one the side faces have, on an edge along a third plane the
+// point all three share.
+template <class Layout>
+void Shatter<Layout>::clipRegion(int plane, const Region& in, int by, Region& pos, Region& neg)
+{
+	Region* out[2] = { &pos, &neg };
+	for (int i = 0; i < 2; ++i)
+	{
+		out[i]->verts.clear();
+		out[i]->along.clear();
+		out[i]->loopStart.assign(1, 0);
+	}
+	pos.code = in.code | (1u << by);
+	neg.code = in.code;
+
+	int n = (int)in.verts.size();
+	mSides.resize(n);
+	int above = 0, below = 0;
+	for (int k = 0; k < n; ++k)
+	{
+		mSides[k] = side(by, in.verts[k]);
+		above += mSides[k] > 0;
+		below += mSides[k] < 0;
+	}
+	if (above + below == 0)
+		return;
+	if (below == 0 || above == 0)
+	{
+		Region& all = below == 0 ? pos : neg;
+		all.verts = in.verts;
+		all.along = in.along;
+		all.loopStart = in.loopStart;
+		return;
+	}
+
+	Region& cut = mCut;
+	cut.verts.clear();
+	cut.along.clear();
+	cut.loopStart.assign(1, 0);
+	mCutSides.clear();
+	for (size_t l = 0; l + 1 < in.loopStart.size(); ++l)
+	{
+		int begin = in.loopStart[l], end = in.loopStart[l + 1];
+		for (int k = begin; k < end; ++k)
+		{
+			int j = k + 1 < end ? k + 1 : begin;
+			cut.verts.push_back(in.verts[k]);
+			cut.along.push_back(in.along[k]);
+			mCutSides.push_back(mSides[k]);
+			if (mSides[k] * mSides[j] < 0)
+			{
+				int a = in.verts[k], b = in.verts[j];
+				cut.verts.push_back(in.along[k] < 0 ? edgeVertex(by, a, b) : meetVertex(plane, in.along[k], by, a, b));
+				cut.along.push_back(in.along[k]);
+				mCutSides.push_back(0);
+			}
+		}
+		cut.loopStart.push_back((int)cut.verts.size());
+	}
+
+	// The line both planes share, run so the positive side of by is on the
+	// left seen from the positive side of plane, like the loops' insides
+	const vec3f& a = mPlanes[by].n;
+	const vec3f& b = mPlanes[plane].n;
+	vec3f dir(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+	gather(1, dir, by, pos);
+	gather(-1, vec3f(-dir.x, -dir.y, -dir.z), by, neg);
+}
+
+// Collects the loops of mCut on one side of plane by into out. Loops that
+// cross it fall apart into chains of kept edges; along the cut line each
+// chain's last point is joined to the next chain's first (Weiler-Atherton,
+// with the line's crossings pairing off in order since the region's parts
+// of it do not overlap).
+template <class Layout>
+void Shatter<Layout>::gather(int sign, const vec3f& dir, int by, Region& out)
+{
+	const Region& cut = mCut;
+	const std::vector<int>& sides = mCutSides;
+	mChains.clear();
+	for (size_t l = 0; l + 1 < cut.loopStart.size(); ++l)
+	{
+		int begin = cut.loopStart[l], size = cut.loopStart[l + 1] - begin;
+		mKeep.resize(size);
+		int kept = 0;
+		for (int k = 0; k < size; ++k)
+		{
+			int i = begin + k, j = begin + (k + 1) % size;
+			int si = sign * sides[i], sj = sign * sides[j];
+			// An edge in the plane bounds the side the loop's inside is on
+			bool keep = si >= 0 && sj >= 0;
+			if (keep && si == 0 && sj == 0)
+			{
+				vec3f p = position(cut.verts[i]), q = position(cut.verts[j]);
+				keep = (q.x - p.x)*dir.x + (q.y - p.y)*dir.y + (q.z - p.z)*dir.z > 0.0f;
+			}
+			mKeep[k] = keep;
+			kept += keep;
+		}
+
+		if (kept == size)
+		{
+			out.verts.insert(out.verts.end(), cut.verts.begin() + begin, cut.verts.begin() + begin + size);
+			out.along.insert(out.along.end(), cut.along.begin() + begin, cut.along.begin() + begin + size);
+			out.loopStart.push_back((int)out.verts.size());
+			continue;
+		}
+		for (int k = 0; k < size; ++k)
+		{
+			if (!mKeep[k] || mKeep[(k + size - 1) % size])
+				continue;
+			Chain c = { begin, size, k, 1 };
+			while (mKeep[(k + c.count - 1) % size])
+				c.count++;
+			mChains.push_back(c);
+		}
+	}
+	if (mChains.empty())
+		return;
+
+	mEntries.clear();
+	mExits.clear();
+	for (size_t c = 0; c < mChains.size(); ++c)
+	{
+		const Chain& ch = mChains[c];
+		vec3f p = position(cut.verts[ch.begin + ch.first]);
+		vec3f q = position(cut.verts[ch.begin + (ch.first + ch.count - 1) % ch.size]);
+		mEntries.push_back(std::make_pair(p.x*dir.x + p.y*dir.y + p.z*dir.z, (int)c));
+		mExits.push_back(std::make_pair(q.x*dir.x + q.y*dir.y + q.z*dir.z, (int)c));
+	}
+	std::sort(mEntries.begin(), mEntries.end());
+	std::sort(mExits.begin(), mExits.end());
+	mChainNext.resize(mChains.size());
+	for (size_t k = 0; k < mExits.size(); ++k)
+		mChainNext[mExits[k].second] = mEntries[k].second;
+
+	mChainDone.assign(mChains.size(), 0);
+	for (size_t c = 0; c < mChains.size(); ++c)
+	{
+		if (mChainDone[c])
+			continue;
+		size_t start = out.verts.size();
+		int k = (int)c;
+		while (!mChainDone[k])
+		{
+			mChainDone[k] = 1;
+			const Chain& ch = mChains[k];
+			for (int v = 0; v < ch.count; ++v)
+			{
+				int i = ch.begin + (ch.first + v) % ch.size;
+				out.verts.push_back(cut.verts[i]);
+				out.along.push_back(v + 1 < ch.count ? cut.along[i] : by);
+			}
+			k = mChainNext[k];
+		}
+		closeLoop(out, start);
+	}
+}
+
+// Ends the loop from start on. Chains that meet at a point need no edge
+// between them, and a loop left with less than three points is dropped.
+template <class Layout>
+void Shatter<Layout>::closeLoop(Region& out, size_t start)
+{
+	size_t w = start;
+	for (size_t k = start; k < out.verts.size(); ++k)
+	{
+		if (w > start)
+		{
+			vec3f p = position(out.verts[w - 1]), q = position(out.verts[k]);
+			if (p.x == q.x && p.y == q.y && p.z == q.z)
+			{
+				out.along[w - 1] = out.along[k];
+				continue;
+			}
+		}
+		out.verts[w] = out.verts[k];
+		out.along[w] = out.along[k];
+		w++;
+	}
+	if (w - start > 1)
+	{
+		vec3f p = position(out.verts[w - 1]), q = position(out.verts[start]);
+		if (p.x == q.x && p.y == q.y && p.z == q.z)
+			w--;
+	}
+	if (w - start < 3)
+		w = start;
+	out.verts.resize(w);
+	out.along.resize(w);
+	if (w > start)
+		out.loopStart.push_back((int)w);
+}
+
+// Triangulates every region of the cross section and caps the cells on both
+// sides of it, facing away from each. The mapping spans the whole cut, so
+// texcoords run on across the regions.
+template <class Layout>
+void Shatter<Layout>::emitCaps(int plane)
+{
+	const Plane& pl = mPlanes[plane];
+	const vec3f& n = pl.n;
+	const vec3f& u = mCap.u;
+	const vec3f& v = mCap.v;
+	const vec2f& lo = mCap.lo;
+	float extent = std::max(mCap.hi.u - lo.u, mCap.hi.v - lo.v);
+	std::vector<vec2f>& poly = mCap.poly;
+	std::vector<int>& tris = mCap.loopTris;
+	std::vector<vec2f>& centres = mCap.centres;
+
+	for (size_t r = 0; r < mRegions.size(); ++r)
+	{
+		const Region& region = mRegions[r];
+		int cells[2] = { cellOf(region.code), cellOf(region.code | (1u << plane)) };
+		if (cells[0] < 0 && cells[1] < 0)
+			continue;
+
+		// Projected relative to a point of the region, so the area of a small
+		// one far from the origin is not lost to rounding
+		vec3f o = position(region.verts[0]);
+		vec2f origin(o.x*u.x + o.y*u.y + o.z*u.z, o.x*v.x + o.y*v.y + o.z*v.z);
+		poly.clear();
+		for (size_t k = 0; k < region.verts.size(); ++k)
+		{
+			vec3f p = position(region.verts[k]);
+			p = vec3f(p.x - o.x, p.y - o.y, p.z - o.z);
+			poly.push_back(vec2f(p.x*u.x + p.y*u.y + p.z*u.z, p.x*v.x + p.y*v.y + p.z*v.z));
+		}
+		triangulateCut(poly, region.loopStart, tris, centres, mCap);
+		if (tris.empty())
+			continue;
+
+		for (int s = 0; s < 2; ++s)
+		{
+			bool positive = s == 1;
+			if (cells[s] < 0)
+				continue;
+			vec3f cn = positive ? vec3f(-n.x, -n.y, -n.z) : n;
+			int base = mHostCount + (int)mAdded.size();
+			for (size_t k = 0; k < poly.size() + centres.size(); ++k)
+			{
+				const vec2f& q = k < poly.size() ? poly[k] : centres[k - poly.size()];
+				// Fan centres are moved back onto the plane, u and v only span it
+				vec3f p = position(k < poly.size() ? region.verts[k] : region.verts[0]);
+				if (k >= poly.size())
+				{
+					float off = -(n.x*p.x + n.y*p.y + n.z*p.z) - pl.d;
+					p = vec3f(p.x + u.x*q.u + v.x*q.v + n.x*off, p.y + u.y*q.u + v.y*q.v + n.y*off, p.z + u.z*q.u + v.z*q.v + n.z*off);
+				}
+				mAdded.push_back(Layout::make(p, cn, vec2f((origin.u + q.u - lo.u) / extent, (origin.v + q.v - lo.v) / extent)));
+			}
+			std::vector<vec3i>& faces = mCells[cells[s]];
+			for (size_t t = 0; t < tris.size(); t += 3)
+			{
+				if (positive)
+					faces.push_back(vec3i(base + tris[t], base + tris[t+2], base + tris[t+1]));
+				else
+					faces.push_back(vec3i(base + tris[t], base + tris[t+1], base + tris[t+2]));
+			}
+		}
+	}
+}
+
+template <class Layout>
+void Shatter<Layout>::byPlanes(const std::vector<vec3f>& points, const std::vector<vec3f>& normals, std::vector<Fragment>& out)
+{
+	size_t count = std::min(std::min(points.size(), normals.size()), MAX_SHATTER_PLANES);
+	for (size_t k = 0; k < count; ++k)
+		addPlane(points[k], normals[k]);
+	computeDistances();
+
+	walkFaces();
+	if (mCaps)
+		capPlanes();
+
+	build(out);
+}
+
+// Every cell is cut out on its own by its bisectors with the other seeds,
+// pointing away from it. Three seeds' bisectors share a line, which the
+// arrangement of all of them could not cut cleanly along; one cell's do not.
+template <class Layout>
+void Shatter<Layout>::voronoi(const std::vector<vec3f>& seeds, std::vector<Fragment>& out)
+{
+	int n = (int)std::min(seeds.size(), MAX_VORONOI_SEEDS);
+	for (int i = 0; i < n; ++i)
+	{
+		Shatter cell(mHost, mCaps);
+		cell.mInsideOnly = true;
+		cell.mCells.resize(1);
+		const vec3f& a = seeds[i];
+		bool empty = false;
+		for (int j = 0; j < n && !empty; ++j)
+		{
+			const vec3f& b = seeds[j];
+			vec3f dir(b.x - a.x, b.y - a.y, b.z - a.z);
+			// Of equal seeds the first gets the cell
+			if (dir.x == 0.0f && dir.y == 0.0f && dir.z == 0.0f)
+			{
+				empty = j < i;
+				continue;
+			}
+			cell.addPlane(vec3f((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f), dir);
+		}
+		if (empty)
+			continue;
+		cell.computeDistances();
+
+		cell.walkFaces();
+		if (mCaps)
+			cell.capPlanes();
+		cell.build(out);
+	}
+}
+
+// Compacts every non empty cell into its own mesh, like buildHalf
+template <class Layout>
+void Shatter<Layout>::build(std::vector<Fragment>& out)
+{
+	std::vector<int> remap(mHostCount + mAdded.size(), -1);
+
+	for (size_t c = 0; c < mCells.size(); ++c)
+	{
+		const std::vector<vec3i>& faces = mCells[c];
+		if (faces.empty())
+			continue;
+
+		Fragment frag;
+		frag.mesh = new XML_Mesh(std::vector<vec3f>(), std::vector<vec3i>());
+		frag.mesh->faces.reserve(faces.size());
+
+		int count = 0;
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			int idx[3] = { faces[i].x, faces[i].y, faces[i].z };
+			for (int k = 0; k < 3; ++k)
+			{
+				int& r = remap[idx[k]];
+				if (r < 0)
+				{
+					r = count++;
+					Vertex v = vertex(idx[k]);
+					Layout::append(*frag.mesh, v);
+					if (r == 0)
+					{
+						frag.min = v.p;
+						frag.max = v.p;
+					}
+					frag.min = vec3f(std::min(frag.min.x, v.p.x), std::min(frag.min.y, v.p.y), std::min(frag.min.z, v.p.z));
+					frag.max = vec3f(std::max(frag.max.x, v.p.x), std::max(frag.max.y, v.p.y), std::max(frag.max.z, v.p.z));
+				}
+				idx[k] = r;
+			}
+			frag.mesh->faces.push_back(vec3i(idx[0], idx[1], idx[2]));
+		}
+
+		// Only the entries this cell touched need resetting
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			remap[faces[i].x] = -1;
+			remap[faces[i].y] = -1;
+			remap[faces[i].z] = -1;
+		}
+
+		frag.vertexCount = count;
+		frag.faceCount = (int)faces.size();
+		out.push_back(frag);
+	}
+}
+
+void MeshSlicer::shatterByPlanes(std::vector<Fragment>& fragments, const std::vector<vec3f>& pp, const std::vector<vec3f>& pn)
+{
+	syncHost();
+	if (mSource.normals)
+		Shatter<RenderLayout>(mSource, mCaps).byPlanes(pp, pn, fragments);
+	else
+		Shatter<PositionLayout>(mSource, mCaps).byPlanes(pp, pn, fragments);
+}
+
+void MeshSlicer::shatterVoronoi(std::vector<Fragment>& fragments, const std::vector<vec3f>& seeds)
+{
+	syncHost();
+	if (mSource.normals)
+		Shatter<RenderLayout>(mSource, mCaps).voronoi(seeds, fragments);
+	else
+		Shatter<PositionLayout>(mSource, mCaps).voronoi(seeds, fragments);
+}
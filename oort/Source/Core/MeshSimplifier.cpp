@@ -0,0 +1,465 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Boundary edges get a plane at right angles to their face, weighted this
+// much more than the faces, so open borders do not shrink
+static const double BOUNDARY_WEIGHT = 10.0;
+// A collapse may not turn a face by more than about 80 degrees
+static const float MIN_FACE_TURN_COS = 0.2f;
+// Fewer faces than a tetrahedron is no longer a closed surface
+static const int MIN_FACES = 4;
+
+static inline unsigned long long edgeKey(int a, int b)
+{
+	return a < b ? ((unsigned long long)a << 32 | (unsigned)b) : ((unsigned long long)b << 32 | (unsigned)a);
+}
+
+static inline vec3f faceNormal(const vec3f& a, const vec3f& b, const vec3f& c)
+{
+	float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+	float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+	return vec3f(uy*vz - uz*vy, uz*vx - ux*vz, ux*vy - uy*vx);
+}
+
+static inline float dot(const vec3f& a, const vec3f& b)
+{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+MeshSimplifier::MeshSimplifier() :
+	live(0), markStamp(0)
+{
+}
+
+void MeshSimplifier::weld(const XML_Mesh& mesh)
+{
+	const std::vector<vec3f>& v = mesh.verts;
+	int count = (int)v.size();
+	order.resize(count);
+	for (int i = 0; i < count; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&v](int a, int b) {
+		if (v[a].x != v[b].x) return v[a].x < v[b].x;
+		if (v[a].y != v[b].y) return v[a].y < v[b].y;
+		return v[a].z < v[b].z;
+	});
+
+	group.resize(count);
+	groupPos.clear();
+	for (int i = 0; i < count; ++i)
+	{
+		const vec3f& p = v[order[i]];
+		if (i == 0 || p.x != groupPos.back().x || p.y != groupPos.back().y || p.z != groupPos.back().z)
+			groupPos.push_back(p);
+		group[order[i]] = (int)groupPos.size() - 1;
+	}
+
+	size_t groups = groupPos.size();
+	groupStamp.assign(groups, 0);
+	groupAlive.assign(groups, 1);
+	mark.assign(groups, 0);
+	markStamp = 0;
+	// Inner lists keep their capacity from earlier runs
+	if (groupFaces.size() < groups)
+		groupFaces.resize(groups);
+	for (size_t g = 0; g < groups; ++g)
+		groupFaces[g].clear();
+
+	faces = mesh.faces;
+	faceAlive.assign(faces.size(), 1);
+	live = 0;
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		int a = group[faces[f].x], b = group[faces[f].y], c = group[faces[f].z];
+		if (a == b || b == c || c == a)
+		{
+			faceAlive[f] = 0;
+			continue;
+		}
+		groupFaces[a].push_back((int)f);
+		groupFaces[b].push_back((int)f);
+		groupFaces[c].push_back((int)f);
+		live++;
+	}
+}
+
+static void addPlane(double* q, double& weight, const vec3f& n, float d, double w)
+{
+	double p[4] = { n.x, n.y, n.z, d };
+	int k = 0;
+	for (int i = 0; i < 4; ++i)
+		for (int j = i; j < 4; ++j)
+			q[k++] += w * p[i] * p[j];
+	weight += w;
+}
+
+void MeshSimplifier::buildQuadrics()
+{
+	Quadric zero;
+	std::fill(zero.a, zero.a + 10, 0.0);
+	zero.weight = 0.0;
+	quadrics.assign(groupPos.size(), zero);
+
+	edges.clear(faces.size() * 3);
+	edgeUse.clear();
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		vec3f n = faceNormal(groupPos[g[0]], groupPos[g[1]], groupPos[g[2]]);
+		float len = sqrt(dot(n, n));
+		if (len > 0.0f)
+		{
+			n = vec3f(n.x / len, n.y / len, n.z / len);
+			float d = -dot(n, groupPos[g[0]]);
+			// Area weighted, so a sliver cannot pin a vertex down
+			for (int k = 0; k < 3; ++k)
+				addPlane(quadrics[g[k]].a, quadrics[g[k]].weight, n, d, 0.5 * len);
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			int index = edges.insert(edgeKey(g[k], g[(k + 1) % 3]), (int)edgeUse.size());
+			if (index == (int)edgeUse.size())
+				edgeUse.push_back(0);
+			edgeUse[index]++;
+		}
+	}
+
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		vec3f n = faceNormal(groupPos[g[0]], groupPos[g[1]], groupPos[g[2]]);
+		for (int k = 0; k < 3; ++k)
+		{
+			int a = g[k], b = g[(k + 1) % 3];
+			int index = 0;
+			edges.find(edgeKey(a, b), index);
+			if (edgeUse[index] != 1)
+				continue;
+			const vec3f& pa = groupPos[a];
+			const vec3f& pb = groupPos[b];
+			vec3f e(pb.x - pa.x, pb.y - pa.y, pb.z - pa.z);
+			vec3f side(e.y*n.z - e.z*n.y, e.z*n.x - e.x*n.z, e.x*n.y - e.y*n.x);
+			float len = sqrt(dot(side, side));
+			if (len <= 0.0f)
+				continue;
+			side = vec3f(side.x / len, side.y / len, side.z / len);
+			float d = -dot(side, pa);
+			double w = BOUNDARY_WEIGHT * dot(e, e);
+			addPlane(quadrics[a].a, quadrics[a].weight, side, d, w);
+			addPlane(quadrics[b].a, quadrics[b].weight, side, d, w);
+		}
+	}
+}
+
+// Mean squared distance of the merged planes to the target position
+double MeshSimplifier::cost(int from, int to) const
+{
+	const double* a = quadrics[from].a;
+	const double* b = quadrics[to].a;
+	double weight = quadrics[from].weight + quadrics[to].weight;
+	const vec3f& p = groupPos[to];
+	double x = p.x, y = p.y, z = p.z;
+	double e = (a[0] + b[0]) * x * x + 2.0 * (a[1] + b[1]) * x * y + 2.0 * (a[2] + b[2]) * x * z + 2.0 * (a[3] + b[3]) * x
+		+ (a[4] + b[4]) * y * y + 2.0 * (a[5] + b[5]) * y * z + 2.0 * (a[6] + b[6]) * y
+		+ (a[7] + b[7]) * z * z + 2.0 * (a[8] + b[8]) * z
+		+ (a[9] + b[9]);
+	return weight > 0.0 ? std::max(0.0, e / weight) : 0.0;
+}
+
+void MeshSimplifier::push(int a, int b)
+{
+	Candidate c;
+	double ab = cost(a, b), ba = cost(b, a);
+	c.cost = std::min(ab, ba);
+	c.from = ab <= ba ? a : b;
+	c.to = ab <= ba ? b : a;
+	c.fromStamp = groupStamp[c.from];
+	c.toStamp = groupStamp[c.to];
+	heap.push_back(c);
+	std::push_heap(heap.begin(), heap.end());
+}
+
+bool MeshSimplifier::canCollapse(int from, int to)
+{
+	// Link condition: the ends may only share the neighbours across the
+	// faces on the edge, otherwise the collapse pinches the surface
+	markStamp += 2;
+	int shared = 0;
+	for (size_t i = 0; i < groupFaces[from].size(); ++i)
+	{
+		int f = groupFaces[from][i];
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		if (g[0] == to || g[1] == to || g[2] == to)
+			shared++;
+		for (int k = 0; k < 3; ++k)
+			if (g[k] != from && g[k] != to)
+				mark[g[k]] = markStamp;
+	}
+	if (shared == 0)
+		return false;
+
+	int common = 0;
+	for (size_t i = 0; i < groupFaces[to].size(); ++i)
+	{
+		int f = groupFaces[to][i];
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		for (int k = 0; k < 3; ++k)
+			if (mark[g[k]] == markStamp)
+			{
+				mark[g[k]] = markStamp + 1;
+				common++;
+			}
+	}
+	if (common != shared)
+		return false;
+
+	// No face that stays may fold over or collapse to a line
+	const vec3f& target = groupPos[to];
+	for (size_t i = 0; i < groupFaces[from].size(); ++i)
+	{
+		int f = groupFaces[from][i];
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		if (g[0] == to || g[1] == to || g[2] == to)
+			continue;
+		vec3f p[3];
+		for (int k = 0; k < 3; ++k)
+			p[k] = g[k] == from ? target : groupPos[g[k]];
+		vec3f before = faceNormal(groupPos[g[0]], groupPos[g[1]], groupPos[g[2]]);
+		vec3f after = faceNormal(p[0], p[1], p[2]);
+		float lb = sqrt(dot(before, before)), la = sqrt(dot(after, after));
+		if (la <= 1e-6f * lb || dot(before, after) <= MIN_FACE_TURN_COS * la * lb)
+			return false;
+	}
+	return true;
+}
+
+void MeshSimplifier::collapse(int from, int to, const XML_Mesh& mesh)
+{
+	std::vector<int>& fromFaces = groupFaces[from];
+	std::vector<int>& toFaces = groupFaces[to];
+
+	// Each vertex of from goes to the vertex of to it shares an edge with,
+	// so seams stay seams; the rest take the closest normal and texcoord
+	targets.clear();
+	for (size_t i = 0; i < toFaces.size(); ++i)
+	{
+		int f = toFaces[i];
+		if (!faceAlive[f])
+			continue;
+		int v[3] = { faces[f].x, faces[f].y, faces[f].z };
+		for (int k = 0; k < 3; ++k)
+			if (group[v[k]] == to && std::find(targets.begin(), targets.end(), v[k]) == targets.end())
+				targets.push_back(v[k]);
+	}
+	for (size_t i = 0; i < fromFaces.size(); ++i)
+	{
+		int f = fromFaces[i];
+		if (!faceAlive[f])
+			continue;
+		int v[3] = { faces[f].x, faces[f].y, faces[f].z };
+		for (int k = 0; k < 3; ++k)
+			if (group[v[k]] == to)
+				for (int j = 0; j < 3; ++j)
+					if (group[v[j]] == from && remap[v[j]] < 0)
+					{
+						remap[v[j]] = v[k];
+						touched.push_back(v[j]);
+					}
+	}
+
+	bool attributes = mesh.normals.size() == mesh.verts.size() && mesh.texcoords.size() == mesh.verts.size();
+	for (size_t i = 0; i < fromFaces.size(); ++i)
+	{
+		int f = fromFaces[i];
+		if (!faceAlive[f])
+			continue;
+		int v[3] = { faces[f].x, faces[f].y, faces[f].z };
+		bool dies = false;
+		for (int k = 0; k < 3; ++k)
+			dies |= group[v[k]] == to;
+		if (dies)
+		{
+			faceAlive[f] = 0;
+			live--;
+			continue;
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (group[v[k]] != from)
+				continue;
+			if (remap[v[k]] < 0)
+			{
+				int best = targets[0];
+				float bestDist = 1e30f;
+				for (size_t t = 0; attributes && t < targets.size(); ++t)
+				{
+					const vec3f& na = mesh.normals[v[k]];
+					const vec3f& nb = mesh.normals[targets[t]];
+					float du = mesh.texcoords[v[k]].u - mesh.texcoords[targets[t]].u;
+					float dv = mesh.texcoords[v[k]].v - mesh.texcoords[targets[t]].v;
+					float dist = 1.0f - dot(na, nb) + du*du + dv*dv;
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						best = targets[t];
+					}
+				}
+				remap[v[k]] = best;
+				touched.push_back(v[k]);
+			}
+			v[k] = remap[v[k]];
+		}
+		faces[f] = vec3i(v[0], v[1], v[2]);
+		toFaces.push_back(f);
+	}
+
+	for (size_t i = 0; i < touched.size(); ++i)
+		remap[touched[i]] = -1;
+	touched.clear();
+	fromFaces.clear();
+	groupAlive[from] = 0;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < toFaces.size(); ++i)
+		if (faceAlive[toFaces[i]])
+			toFaces[kept++] = toFaces[i];
+	toFaces.resize(kept);
+
+	for (int k = 0; k < 10; ++k)
+		quadrics[to].a[k] += quadrics[from].a[k];
+	quadrics[to].weight += quadrics[from].weight;
+	groupStamp[to]++;
+
+	// Every edge of to changed cost
+	markStamp += 2;
+	for (size_t i = 0; i < toFaces.size(); ++i)
+	{
+		const vec3i& f = faces[toFaces[i]];
+		int g3[3] = { group[f.x], group[f.y], group[f.z] };
+		for (int k = 0; k < 3; ++k)
+		{
+			int g = g3[k];
+			if (g != to && mark[g] != markStamp)
+			{
+				mark[g] = markStamp;
+				push(to, g);
+			}
+		}
+	}
+}
+
+float MeshSimplifier::simplify(const XML_Mesh& mesh, int targetFaces, float maxError, XML_Mesh& out)
+{
+	weld(mesh);
+	buildQuadrics();
+	remap.assign(mesh.verts.size(), -1);
+	targetFaces = std::max(targetFaces, MIN_FACES);
+
+	heap.clear();
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		if (!faceAlive[f])
+			continue;
+		int g[3] = { group[faces[f].x], group[faces[f].y], group[faces[f].z] };
+		// Each edge once, the face with the lower first group pushes it
+		for (int k = 0; k < 3; ++k)
+			if (g[k] < g[(k + 1) % 3])
+				push(g[k], g[(k + 1) % 3]);
+			else
+			{
+				int index = 0;
+				edges.find(edgeKey(g[k], g[(k + 1) % 3]), index);
+				if (edgeUse[index] == 1)
+					push(g[k], g[(k + 1) % 3]);
+			}
+	}
+
+	double worst = 0.0;
+	double limit = (double)maxError * maxError;
+	while (live > targetFaces && !heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end());
+		Candidate c = heap.back();
+		heap.pop_back();
+
+		if (!groupAlive[c.from] || !groupAlive[c.to] ||
+			c.fromStamp != groupStamp[c.from] || c.toStamp != groupStamp[c.to])
+			continue;
+		if (c.cost > limit)
+			break;
+		if (!canCollapse(c.from, c.to))
+			continue;
+
+		collapse(c.from, c.to, mesh);
+		worst = std::max(worst, c.cost);
+	}
+
+	// Compact to the vertices the faces that are left use
+	out.verts.clear();
+	out.normals.clear();
+	out.texcoords.clear();
+	out.faces.clear();
+	out.chunks.clear();
+	out.chunkVerts.clear();
+	std::fill(remap.begin(), remap.end(), -1);
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		if (!faceAlive[f])
+			continue;
+		int v[3] = { faces[f].x, faces[f].y, faces[f].z };
+		int idx[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			if (remap[v[k]] < 0)
+			{
+				remap[v[k]] = (int)out.verts.size();
+				out.verts.push_back(mesh.verts[v[k]]);
+				if (v[k] < (int)mesh.normals.size())
+					out.normals.push_back(mesh.normals[v[k]]);
+				if (v[k] < (int)mesh.texcoords.size())
+					out.texcoords.push_back(mesh.texcoords[v[k]]);
+			}
+			idx[k] = remap[v[k]];
+		}
+		out.faces.push_back(vec3i(idx[0], idx[1], idx[2]));
+	}
+	return (float)sqrt(worst);
+}
+
+void MeshSimplifier::buildLodChain(const XML_Mesh& mesh, const std::vector<float>& ratios, std::vector<LodLevel>& levels, float maxError)
+{
+	const XML_Mesh* prev = &mesh;
+	float error = 0.0f;
+	for (size_t i = 0; i < ratios.size(); ++i)
+	{
+		int target = (int)(ratios[i] * mesh.faces.size());
+		XML_Mesh* lod = new XML_Mesh();
+		// Errors of successive levels add up to a bound against the source
+		error += simplify(*prev, target, maxError - error, *lod);
+		if (lod->faces.size() >= prev->faces.size())
+		{
+			delete lod;
+			break;
+		}
+
+		LodLevel level;
+		level.mesh = lod;
+		level.faceCount = (int)lod->faces.size();
+		level.error = error;
+		levels.push_back(level);
+		prev = lod;
+	}
+}
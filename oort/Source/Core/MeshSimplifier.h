@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// One step of an LOD chain. error is the RMS distance, in mesh units, the
+// worst collapse moved the surface by.
+struct LodLevel
+{
+	XML_Mesh* mesh;
+	int faceCount;
+	float error;
+};
+
+// Quadric error edge collapse (Garland and Heckbert). Vertices that only
+// differ in normal or texcoord are collapsed as one, so seams do not tear,
+// and collapses that would fold a face over or pinch the surface into a non
+// manifold are skipped. Vertices collapse onto an edge's endpoint and keep
+// their attributes, which needs no attribute interpolation.
+// Scratch is kept between runs, so one simplifier per thread costs no heap
+// traffic once it has seen its largest mesh.
+class MeshSimplifier {
+public:
+	MeshSimplifier();
+
+	// Collapses edges until at most targetFaces faces are left or the next
+	// collapse would move the surface more than maxError. Returns the error
+	// of the worst collapse done.
+	float simplify(const XML_Mesh& mesh, int targetFaces, float maxError, XML_Mesh& out);
+
+	// One level per ratio of the source's face count, in decreasing order,
+	// each simplified from the one before. The caller owns the meshes.
+	// Levels that could not get below the previous one are left out.
+	void buildLodChain(const XML_Mesh& mesh, const std::vector<float>& ratios, std::vector<LodLevel>& levels, float maxError = 1e30f);
+
+private:
+	// Symmetric 4x4 plane quadric and the area it was summed over
+	struct Quadric
+	{
+		double a[10];
+		double weight;
+	};
+
+	struct Candidate
+	{
+		double cost;
+		int from;
+		int to;
+		int fromStamp;
+		int toStamp;
+		bool operator<(const Candidate& o) const { return cost > o.cost; }
+	};
+
+	// Render vertex -> group of vertices at the same position
+	std::vector<int> group;
+	std::vector<vec3f> groupPos;
+	std::vector<int> groupStamp;
+	std::vector<char> groupAlive;
+	std::vector<std::vector<int> > groupFaces;
+	std::vector<Quadric> quadrics;
+
+	std::vector<vec3i> faces;
+	std::vector<char> faceAlive;
+	int live;
+	std::vector<Candidate> heap;
+	EdgeMap edges;
+	std::vector<int> edgeUse;
+
+	std::vector<int> order;
+	std::vector<int> mark;
+	int markStamp;
+	std::vector<int> remap;
+	std::vector<int> touched;
+	std::vector<int> targets;
+
+	void weld(const XML_Mesh& mesh);
+	void buildQuadrics();
+	double cost(int from, int to) const;
+	void push(int a, int b);
+	bool canCollapse(int from, int to);
+	void collapse(int from, int to, const XML_Mesh& mesh);
+};
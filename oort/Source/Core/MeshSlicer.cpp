@@ -1,4 +1,11 @@
 #include "MeshSlicer.h"
+#include "Log.h"
+#include "MeshXmlReader.h"
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 XML_Mesh::XML_Mesh()
 {
@@ -12,259 +19,1349 @@ XML_Mesh::XML_Mesh(std::string filename)
 	doc = new XMLDocument;
 }
 
-XML_Mesh::XML_Mesh(std::vector<vec3f> v, std::vector<vec3i> f)
+XML_Mesh::XML_Mesh(const std::vector<vec3f>& v, const std::vector<vec3i>& f) :
+	doc(NULL),
+	verts(v),
+	faces(f)
+{
+	path = "";
+}
+
+bool XML_Mesh::fitsIn16BitIndices() const
+{
+	return verts.size() <= 65536;
+}
+
+// Spreads the low 10 bits of x out to every third bit
+static unsigned int spreadBits(unsigned int x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+void XML_Mesh::buildChunks(int facesPerChunk)
 {
-	for (std::vector<vec3f>::iterator i = v.begin(); i != v.end(); ++i)
+	chunks.clear();
+	chunkVerts.clear();
+	if (faces.empty() || verts.empty())
+		return;
+
+	vec3f lo = verts[0], hi = verts[0];
+	for (size_t i = 1; i < verts.size(); ++i)
+	{
+		const vec3f& p = verts[i];
+		lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	vec3f scale(1023.0f / std::max(hi.x - lo.x, 1e-20f), 1023.0f / std::max(hi.y - lo.y, 1e-20f), 1023.0f / std::max(hi.z - lo.z, 1e-20f));
+
+	// Morton code of every centroid, faces that end up next to each other in
+	// that order are close in space
+	std::vector<std::pair<unsigned int, int> > order(faces.size());
+	for (size_t i = 0; i < faces.size(); ++i)
 	{
-		verts.push_back(*i);
+		const vec3f& a = verts[faces[i].x];
+		const vec3f& b = verts[faces[i].y];
+		const vec3f& c = verts[faces[i].z];
+		unsigned int x = (unsigned int)(((a.x + b.x + c.x) / 3.0f - lo.x) * scale.x);
+		unsigned int y = (unsigned int)(((a.y + b.y + c.y) / 3.0f - lo.y) * scale.y);
+		unsigned int z = (unsigned int)(((a.z + b.z + c.z) / 3.0f - lo.z) * scale.z);
+		order[i] = std::make_pair(spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2), (int)i);
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<vec3i> sorted(faces.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		sorted[i] = faces[order[i].second];
+	faces.swap(sorted);
+
+	facesPerChunk = std::max(facesPerChunk, 1);
+	chunks.reserve((faces.size() + facesPerChunk - 1) / facesPerChunk);
+	chunkVerts.reserve(faces.size() * 3);
+	for (int begin = 0; begin < (int)faces.size(); begin += facesPerChunk)
+	{
+		FaceChunk chunk;
+		chunk.faceBegin = begin;
+		chunk.faceEnd = std::min(begin + facesPerChunk, (int)faces.size());
+		chunk.vertBegin = (int)chunkVerts.size();
+
+		for (int f = chunk.faceBegin; f < chunk.faceEnd; ++f)
+		{
+			chunkVerts.push_back(faces[f].x);
+			chunkVerts.push_back(faces[f].y);
+			chunkVerts.push_back(faces[f].z);
+		}
+		std::sort(chunkVerts.begin() + chunk.vertBegin, chunkVerts.end());
+		chunkVerts.erase(std::unique(chunkVerts.begin() + chunk.vertBegin, chunkVerts.end()), chunkVerts.end());
+		chunk.vertEnd = (int)chunkVerts.size();
+
+		chunk.min = chunk.max = verts[chunkVerts[chunk.vertBegin]];
+		for (int v = chunk.vertBegin + 1; v < chunk.vertEnd; ++v)
+		{
+			const vec3f& p = verts[chunkVerts[v]];
+			chunk.min = vec3f(std::min(chunk.min.x, p.x), std::min(chunk.min.y, p.y), std::min(chunk.min.z, p.z));
+			chunk.max = vec3f(std::max(chunk.max.x, p.x), std::max(chunk.max.y, p.y), std::max(chunk.max.z, p.z));
+		}
+
+		// A little slack so rounding in the box test can never put a box on
+		// one side while one of its vertices tests as on the plane
+		float pad = 1e-4f * std::max(std::max(chunk.max.x - chunk.min.x, chunk.max.y - chunk.min.y), chunk.max.z - chunk.min.z) + 1e-5f;
+		chunk.min = vec3f(chunk.min.x - pad, chunk.min.y - pad, chunk.min.z - pad);
+		chunk.max = vec3f(chunk.max.x + pad, chunk.max.y + pad, chunk.max.z + pad);
+		chunks.push_back(chunk);
 	}
+}
+
+bool XML_Mesh::hasChunks() const
+{
+	return !chunks.empty() && chunks.back().faceEnd == (int)faces.size();
+}
+
+HostMesh::HostMesh() :
+	verts(NULL), normals(NULL), texcoords(NULL), faces(NULL), chunks(NULL), chunkVerts(NULL),
+	vertexCount(0), faceCount(0), chunkCount(0)
+{
+}
 
-	for (std::vector<vec3i>::iterator i = f.begin(); i != f.end(); ++i)
+HostMesh::HostMesh(const XML_Mesh& mesh) :
+	verts(NULL), normals(NULL), texcoords(NULL), faces(NULL), chunks(NULL), chunkVerts(NULL),
+	vertexCount((int)mesh.verts.size()), faceCount((int)mesh.faces.size()), chunkCount(0)
+{
+	size_t n = mesh.verts.size();
+	if (n > 0)
+		verts = &mesh.verts[0];
+	if (n > 0 && mesh.normals.size() == n && mesh.texcoords.size() == n)
+	{
+		normals = &mesh.normals[0];
+		texcoords = &mesh.texcoords[0];
+	}
+	if (faceCount > 0)
+		faces = &mesh.faces[0];
+	if (mesh.hasChunks())
 	{
-		faces.push_back(*i);
+		chunks = &mesh.chunks[0];
+		chunkVerts = &mesh.chunkVerts[0];
+		chunkCount = (int)mesh.chunks.size();
 	}
 }
 
 
 void XML_Mesh::loadFromXMLFile(std::string filename)
 {
-	std::cout << "Creating XML_Mesh class from .mesh.xml" << std::endl;
-	std::cout << "Trying to load " << filename << std::endl;
+	LOG_DEBUG(LOG_MESH, "Loading " << filename);
 
-	doc->LoadFile( filename.c_str() );
-	if(doc->Error())
-		doc->PrintError();
-	else
-		std::cout << "Loading complete" << std::endl;
+	MeshXmlReader reader;
+	if (!reader.read(filename, *this))
+		LOG_ERROR(LOG_MESH, "Could not load " << filename << ": " << reader.getError());
+
+	buildChunks();
+	LOG_DEBUG(LOG_MESH, "Loaded " << filename << ", " << verts.size() << " verts, " << faces.size() << " faces in " << chunks.size() << " chunks");
+}
+
+// Material of the asteroid meshes, the default MeshBuilder uses too
+static const char* SAVED_MATERIAL = "StonesMat_01";
+
+void XML_Mesh::toFile(std::string filename)
+{
+	std::string meshName = "../Assets/meshgen/" + filename;
+	LOG_DEBUG(LOG_MESH, "Writing " << meshName << ", " << verts.size() << " verts, " << faces.size() << " faces");
+
+	MeshWriter writer;
+	if (!writer.write(*this, meshName, SAVED_MATERIAL))
+		LOG_ERROR(LOG_MESH, "Could not write " << meshName);
+}
+
+
+
+MeshSlicer::MeshSlicer(Ogre::SceneNode* node)
+{
+	mHost = NULL;
+	mSceneNode = node;
+	mCaps = true;
+	mPool = NULL;
+}
+
+void MeshSlicer::setThreads(int threads)
+{
+	delete mPool;
+	mPool = threads > 1 ? new WorkerPool(threads) : NULL;
+}
 
-	XMLNode* pVert = doc->FirstChildElement( "mesh" )->FirstChildElement("sharedgeometry");
-  XMLNode* pFace = doc->FirstChildElement( "mesh" )->FirstChildElement("submeshes")->FirstChildElement("submesh")->FirstChildElement("faces");
-  std::cout << "vertexcount" << pVert->ToElement()->IntAttribute("vertexcount") << std::endl;
+int MeshSlicer::getThreads() const
+{
+	return mPool ? mPool->size() : 1;
+}
 
-  pVert = pVert->FirstChildElement("vertexbuffer");
+void MeshSlicer::setCapping(bool caps)
+{
+	mCaps = caps;
+}
 
- // XMLNode* xmlRoot = doc.FirstChildElement("mesh");
- // XMLNode* xmlVertexBuffer = xmlRoot->FirstChildElement("sharedgeometry")->FirstChildElement("vertexbuffer");
- // XMLNode* xmlFaceBuffer = xmlRoot->FirstChildElement("submeshes")->FirstChildElement("submesh")->FirstChildElement("faces");
+void MeshSlicer::loadMesh(XML_Mesh* mesh)
+{
+	mHost = mesh;
+	syncHost();
+}
+
+void MeshSlicer::loadMesh(const HostMesh& mesh)
+{
+	mHost = NULL;
+	mSource = mesh;
+}
 
- //  //PRINT ALL VERTS OF MESH
+// The mesh may have been edited or reallocated since it was loaded
+void MeshSlicer::syncHost()
+{
+	if (mHost)
+		mSource = HostMesh(*mHost);
+}
 
-  int k = 0;
+MeshSlicer::~MeshSlicer()
+{
+	delete mPool;
 
-  for(XMLNode* node = pVert->FirstChildElement("vertex"); node != NULL; node=node->NextSibling())
-  {
- 		k++;
-		float x = node->FirstChildElement("position")->FloatAttribute("x");
-		float y = node->FirstChildElement("position")->FloatAttribute("y");
-		float z = node->FirstChildElement("position")->FloatAttribute("z");
+}
 
-		float nx = node->FirstChildElement("normal")->FloatAttribute("x");
-		float ny = node->FirstChildElement("normal")->FloatAttribute("y");
-		float nz = node->FirstChildElement("normal")->FloatAttribute("z");
+// Vertices closer than this to the plane count as on it and go to both halves
+static const float PLANE_EPSILON = 1e-5f;
 
-		float u = node->FirstChildElement("texcoord")->FloatAttribute("u");
-		float v = node->FirstChildElement("texcoord")->FloatAttribute("v");
+// Fewest faces a worker gets in a threaded slice
+static const size_t MIN_CHUNK_FACES = 512;
 
-		this->verts.push_back(vec3f(x,y,z));
-		this->normals.push_back(vec3f(nx,ny,nz));
-		this->texcoords.push_back(vec2f(u,v));
-  }
-	std::cout << "Loading verts complete "<<std::endl;
+// 1 when the box is wholly on the side the normal points to, -1 when wholly
+// on the other, 0 when the plane passes through it
+static int boxSide(const FaceChunk& box, float A, float B, float C, float D)
+{
+	float s = A * (box.min.x + box.max.x) * 0.5f + B * (box.min.y + box.max.y) * 0.5f + C * (box.min.z + box.max.z) * 0.5f + D;
+	float r = fabs(A) * (box.max.x - box.min.x) * 0.5f + fabs(B) * (box.max.y - box.min.y) * 0.5f + fabs(C) * (box.max.z - box.min.z) * 0.5f;
+	if (s - r > PLANE_EPSILON)
+		return 1;
+	if (s + r < -PLANE_EPSILON)
+		return -1;
+	return 0;
+}
 
+// Splits a convex polygon of up to 4 vertices into a triangle fan
+static void fanTriangulate(const int* poly, int n, std::vector<vec3i>& out)
+{
+	for (int k = 1; k + 1 < n; ++k)
+		out.push_back(vec3i(poly[0], poly[k], poly[k+1]));
+}
 
- //  //CREATE TRIANGLES OF MESH
-	k = 0;
-  for(XMLNode* node = pFace->FirstChildElement("face"); node != NULL; node=node->NextSibling())
-  {
-  	k++;
-		int v3 = node->ToElement()->IntAttribute("v3");
-		int v2 = node->ToElement()->IntAttribute("v2");
-		int v1 = node->ToElement()->IntAttribute("v1");
+static inline vec3f lerp3(const vec3f& a, const vec3f& b, float t)
+{
+	return vec3f(a.x + t*(b.x - a.x), a.y + t*(b.y - a.y), a.z + t*(b.z - a.z));
+}
 
-		this->faces.push_back(vec3i(v1,v2,v3));
-  }
+PositionLayout::Vertex PositionLayout::fetch(const HostMesh& mesh, int i)
+{
+	Vertex v;
+	v.p = mesh.verts[i];
+	return v;
+}
 
-  	std::cout << "Loading indices complete "<<k << std::endl;
+PositionLayout::Vertex PositionLayout::lerp(const Vertex& a, const Vertex& b, float t)
+{
+	Vertex v;
+	v.p = lerp3(a.p, b.p, t);
+	return v;
+}
 
+PositionLayout::Vertex PositionLayout::make(const vec3f& p, const vec3f& /*n*/, const vec2f& /*uv*/)
+{
+	Vertex v;
+	v.p = p;
+	return v;
 }
 
-void XML_Mesh::toFile(std::string filename)
+void PositionLayout::reserve(XML_Mesh& mesh, size_t n)
 {
-	//update vertex count
-	//write relevent data to file
-	XMLDocument temp;
-	temp.LoadFile("../Assets/Asteroid/Stone_temp.mesh.xml");
+	mesh.verts.reserve(n);
+}
 
+void PositionLayout::append(XML_Mesh& mesh, const Vertex& v)
+{
+	mesh.verts.push_back(v.p);
+}
 
-  if(temp.Error())
-		temp.PrintError();
-	else
-		std::cout << "Loading complete" << std::endl;
+void PositionLayout::allocate(SliceArena& arena, MeshView& view, int n)
+{
+	view.verts = arena.alloc<vec3f>(n);
+	view.normals = NULL;
+	view.texcoords = NULL;
+}
 
+void PositionLayout::write(MeshView& view, int i, const Vertex& v)
+{
+	view.verts[i] = v.p;
+}
 
-  int vsize = verts.size();
-	temp.FirstChildElement("mesh")->FirstChildElement("sharedgeometry")->SetAttribute("vertexcount", vsize);
-	
-	std::cout << "Set Number of Verts " << vsize << std::endl;
+RenderLayout::Vertex RenderLayout::fetch(const HostMesh& mesh, int i)
+{
+	Vertex v;
+	v.p = mesh.verts[i];
+	v.n = mesh.normals[i];
+	v.uv = mesh.texcoords[i];
+	return v;
+}
 
-	XMLNode* vertbuffer = temp.FirstChildElement("mesh")->FirstChildElement("sharedgeometry")->FirstChildElement("vertexbuffer");
-	for (int i = 0; i < verts.size(); ++i)
+RenderLayout::Vertex RenderLayout::lerp(const Vertex& a, const Vertex& b, float t)
+{
+	Vertex v;
+	v.p = lerp3(a.p, b.p, t);
+	v.n = lerp3(a.n, b.n, t);
+	float l = sqrt(v.n.x*v.n.x + v.n.y*v.n.y + v.n.z*v.n.z);
+	if (l > 0.0f)
 	{
-		XMLElement* vertex = temp.NewElement("vertex");
+		v.n.x /= l;
+		v.n.y /= l;
+		v.n.z /= l;
+	}
+	v.uv = vec2f(a.uv.u + t*(b.uv.u - a.uv.u), a.uv.v + t*(b.uv.v - a.uv.v));
+	return v;
+}
+
+RenderLayout::Vertex RenderLayout::make(const vec3f& p, const vec3f& n, const vec2f& uv)
+{
+	Vertex v;
+	v.p = p;
+	v.n = n;
+	v.uv = uv;
+	return v;
+}
+
+void RenderLayout::reserve(XML_Mesh& mesh, size_t n)
+{
+	mesh.verts.reserve(n);
+	mesh.normals.reserve(n);
+	mesh.texcoords.reserve(n);
+}
+
+void RenderLayout::append(XML_Mesh& mesh, const Vertex& v)
+{
+	mesh.verts.push_back(v.p);
+	mesh.normals.push_back(v.n);
+	mesh.texcoords.push_back(v.uv);
+}
+
+void RenderLayout::allocate(SliceArena& arena, MeshView& view, int n)
+{
+	view.verts = arena.alloc<vec3f>(n);
+	view.normals = arena.alloc<vec3f>(n);
+	view.texcoords = arena.alloc<vec2f>(n);
+}
+
+void RenderLayout::write(MeshView& view, int i, const Vertex& v)
+{
+	view.verts[i] = v.p;
+	view.normals[i] = v.n;
+	view.texcoords[i] = v.uv;
+}
+
+void MeshSlicer::sliceByPlane(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn)
+{
+	// Render attributes can only be carried over if the host has them for every vertex
+	syncHost();
+	if (mSource.normals)
+		slice<RenderLayout>(meshes, pp, pn);
+	else
+		slice<PositionLayout>(meshes, pp, pn);
+}
+
+void MeshSlicer::sliceByPlanePositions(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn)
+{
+	slice<PositionLayout>(meshes, pp, pn);
+}
+
+void MeshSlicer::sliceByPlaneInto(MeshView halves[2], vec3f pp, vec3f pn)
+{
+	syncHost();
+	if (mSource.normals)
+		sliceInto<RenderLayout>(halves, pp, pn);
+	else
+		sliceInto<PositionLayout>(halves, pp, pn);
+}
+
+size_t MeshSlicer::arenaAllocations() const
+{
+	return mArena.heapAllocations();
+}
+
+template <>
+SliceBuffers<PositionLayout>& MeshSlicer::buffers<PositionLayout>()
+{
+	return mPositionBuffers;
+}
+
+template <>
+SliceBuffers<RenderLayout>& MeshSlicer::buffers<RenderLayout>()
+{
+	return mRenderBuffers;
+}
 
-		XMLElement* position = temp.NewElement("position");
-		vertex->InsertEndChild(position);
-		XMLElement* normal = temp.NewElement("normal");
-		vertex->InsertEndChild(normal);
-		XMLElement* texcoord = temp.NewElement("texcoord");
-		vertex->InsertEndChild(texcoord);
+// Only goes through the pool's std::function when there is a pool to feed,
+// the serial loop calls the job directly
+template <class Job>
+void MeshSlicer::parallelFor(int count, const Job& job)
+{
+	if (mPool && count > 1)
+		mPool->run(count, job);
+	else
+		for (int i = 0; i < count; ++i)
+			job(i);
+}
+
+template <class Layout>
+void MeshSlicer::slice(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn)
+{
+	cut<Layout>(pp, pn);
+
+	// The host is left as loaded, each half only gets the vertices it uses
+	SliceBuffers<Layout>& buf = buffers<Layout>();
+	meshes.push_back(buildHalf<Layout>(buf.faces1, buf.added));
+	meshes.push_back(buildHalf<Layout>(buf.faces2, buf.added));
+}
+
+template <class Layout>
+void MeshSlicer::sliceInto(MeshView halves[2], vec3f pp, vec3f pn)
+{
+	cut<Layout>(pp, pn);
+
+	// Views of the previous slice die here
+	mArena.reset();
+	SliceBuffers<Layout>& buf = buffers<Layout>();
+	buildView<Layout>(buf.faces1, buf.added, halves[0]);
+	buildView<Layout>(buf.faces2, buf.added, halves[1]);
+}
 
-		position->SetAttribute("x", verts[i].x);
-		position->SetAttribute("y", verts[i].y);
-		position->SetAttribute("z", verts[i].z);
-		if(i < normals.size())
+// Clips the host into buffers<Layout>(): the added vertices, then the faces
+// of the side the normal points to and of the other side
+template <class Layout>
+void MeshSlicer::cut(vec3f pp, vec3f pn)
+{
+	syncHost();
+	const vec3f* verts = mSource.verts;
+	size_t vcount = mSource.vertexCount;
+	size_t fcount = mSource.faceCount;
+
+	float l = sqrt(pn.x*pn.x + pn.y*pn.y + pn.z*pn.z);
+	float A = pn.x / l;
+	float B = pn.y / l;
+	float C = pn.z / l;
+	float D = -(A*pp.x + B*pp.y + C*pp.z);
+
+	// Meshes without chunk bounds are cut as plain runs of faces, all crossed
+	bool bounded = mSource.chunks != NULL;
+	if (!bounded)
+	{
+		mSpans.clear();
+		for (size_t f = 0; f < fcount; f += MIN_CHUNK_FACES)
 		{
-			normal->SetAttribute("x", normals[i].x);
-			normal->SetAttribute("y", normals[i].y);
-			normal->SetAttribute("z", normals[i].z);
+			FaceChunk span = FaceChunk();
+			span.faceBegin = (int)f;
+			span.faceEnd = (int)std::min(f + MIN_CHUNK_FACES, fcount);
+			mSpans.push_back(span);
 		}
-		else
+	}
+	const FaceChunk* chunks = bounded ? mSource.chunks : mSpans.empty() ? NULL : &mSpans[0];
+	size_t chunkCount = bounded ? mSource.chunkCount : mSpans.size();
+
+	// Pass 0: one plane test per chunk box. Chunks the plane misses go to
+	// their side whole, only the crossed ones are clipped face by face.
+	mChunkSide.resize(chunkCount);
+	mCrossing.clear();
+	size_t crossedFaces = 0, crossedVerts = 0;
+	for (size_t c = 0; c < chunkCount; ++c)
+	{
+		mChunkSide[c] = bounded ? boxSide(chunks[c], A, B, C, D) : 0;
+		if (mChunkSide[c] == 0)
 		{
-			normal->SetAttribute("x", 0.0f);
-			normal->SetAttribute("y", 0.0f);
-			normal->SetAttribute("z", 0.0f);
+			mCrossing.push_back((int)c);
+			crossedFaces += chunks[c].faceEnd - chunks[c].faceBegin;
+			crossedVerts += chunks[c].vertEnd - chunks[c].vertBegin;
 		}
+	}
 
+	// Small cuts are not worth waking the pool for
+	int nchunks = 1;
+	if (mPool && crossedFaces >= 2 * MIN_CHUNK_FACES)
+		nchunks = std::min(std::min(mPool->size(), (int)(crossedFaces / MIN_CHUNK_FACES)), (int)mCrossing.size());
 
-		if(i < texcoords.size())
+	// Pass 1: vertices are evaluated against the plane once. An off centre
+	// cut only needs the vertices of the chunks it crosses; those lists
+	// overlap, so they are walked on this thread.
+	mDist.resize(vcount);
+	if (bounded && crossedVerts < vcount / 2)
+	{
+		const int* used = mSource.chunkVerts;
+		for (size_t k = 0; k < mCrossing.size(); ++k)
 		{
-			texcoord->SetAttribute("u", texcoords[i].u);
-			texcoord->SetAttribute("v", texcoords[i].v);
+			const FaceChunk& chunk = chunks[mCrossing[k]];
+			for (int v = chunk.vertBegin; v < chunk.vertEnd; ++v)
+			{
+				int i = used[v];
+				mDist[i] = A*verts[i].x + B*verts[i].y + C*verts[i].z + D;
+			}
 		}
-		else
+	}
+	else
+	{
+		int nruns = std::max(nchunks, mPool && vcount >= 2 * MIN_CHUNK_FACES ? mPool->size() : 1);
+		parallelFor(nruns, [&](int c)
 		{
-			texcoord->SetAttribute("u", 0.1f);
-			texcoord->SetAttribute("v", 0.2f);
-		}
-    // vertex->InsertEndChild(vertex);	
+			size_t end = vcount * (c + 1) / nruns;
+			for (size_t i = vcount * c / nruns; i < end; ++i)
+				mDist[i] = A*verts[i].x + B*verts[i].y + C*verts[i].z + D;
+		});
+	}
 
+	// Pass 2: each worker clips its share of the crossed chunks into its own buffers
+	SliceBuffers<Layout>& buf = buffers<Layout>();
+	std::vector<SliceChunk<Layout> >& ch = buf.chunks;
+	ch.resize(nchunks);
+	size_t ncrossed = mCrossing.size();
+	parallelFor(nchunks, [&](int c)
+	{
+		clipFaces<Layout>(chunks, ncrossed * c / nchunks, ncrossed * (c + 1) / nchunks, ch[c]);
+	});
 
-		vertbuffer->InsertEndChild(vertex);		
-  }
+	// Swapped, not moved out, so both sets of buffers keep their capacity
+	if (nchunks == 1)
+	{
+		buf.added.swap(ch[0].added);
+		buf.faces1.swap(ch[0].faces1);
+		buf.faces2.swap(ch[0].faces2);
+		mCutSegments.swap(ch[0].segments);
+	}
+	else
+		mergeChunks<Layout>(ch, buf.added, buf.faces1, buf.faces2);
+
+	// Whole chunks after the clipped faces, in chunk order
+	const vec3i* faces = mSource.faces;
+	for (size_t c = 0; c < chunkCount; ++c)
+	{
+		if (mChunkSide[c] == 0)
+			continue;
+		std::vector<vec3i>& side = mChunkSide[c] > 0 ? buf.faces1 : buf.faces2;
+		side.insert(side.end(), faces + chunks[c].faceBegin, faces + chunks[c].faceEnd);
+	}
 
-  std::cout << "Writing Verts Complete" << std::endl;
+	if (mCaps)
+		buildCaps<Layout>(vec3f(A, B, C), buf.added, buf.faces1, buf.faces2);
+}
 
+// Clips the faces of crossed chunks [begin, end) of mCrossing. Vertices created
+// here are numbered from the host's vertex count up and are local to the
+// chunk until merged.
+template <class Layout>
+void MeshSlicer::clipFaces(const FaceChunk* chunks, size_t begin, size_t end, SliceChunk<Layout>& out)
+{
+	size_t count = 0;
+	for (size_t c = begin; c < end; ++c)
+		count += chunks[mCrossing[c]].faceEnd - chunks[mCrossing[c]].faceBegin;
+
+	// Cut edges run along the outline, a small fraction of the faces
+	out.edgeVerts.clear(count / 8);
+	out.added.clear();
+	out.addedEdges.clear();
+	out.faces1.clear();
+	out.faces2.clear();
+	out.segments.clear();
+	out.faces1.reserve(count);
+	out.faces2.reserve(count);
+
+	for (size_t ci = begin; ci < end; ++ci)
+	{
+		const FaceChunk& chunk = chunks[mCrossing[ci]];
+		for (int fi = chunk.faceBegin; fi < chunk.faceEnd; ++fi)
+		{
+			const vec3i& f = mSource.faces[fi];
+			int idx[3] = { f.x, f.y, f.z };
+			int side[3];
+			int above = 0, below = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				float d = mDist[idx[k]];
+				side[k] = d > PLANE_EPSILON ? 1 : (d < -PLANE_EPSILON ? -1 : 0);
+				above += side[k] > 0;
+				below += side[k] < 0;
+			}
 
-  int fsize = faces.size();
-	XMLNode* facebuffer = temp.FirstChildElement("mesh")->FirstChildElement("submeshes")->FirstChildElement("submesh")->FirstChildElement("faces");
-	facebuffer->ToElement()->SetAttribute("count", fsize);
-	std::cout << "Set Number of Faces " << fsize <<  std::endl;
+			if (below == 0 || above == 0)
+			{
+				// An edge lying in the plane is part of the cut outline, stored in
+				// the winding of the half the normal points to
+				if (mCaps && above + below == 1)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						int j = (k + 1) % 3;
+						if (side[k] == 0 && side[j] == 0)
+						{
+							if (below == 0)
+								out.segments.push_back(std::make_pair(idx[k], idx[j]));
+							else
+								out.segments.push_back(std::make_pair(idx[j], idx[k]));
+						}
+					}
+				}
+
+				if (below == 0)
+					out.faces1.push_back(f);
+				else
+					out.faces2.push_back(f);
+				continue;
+			}
 
+			// Walk the edges in order so both pieces keep the face winding
+			int pos[4], neg[4];
+			bool onPlane[4];
+			int np = 0, nn = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				int j = (k + 1) % 3;
+				if (side[k] >= 0)
+				{
+					onPlane[np] = side[k] == 0;
+					pos[np++] = idx[k];
+				}
+				if (side[k] <= 0)
+					neg[nn++] = idx[k];
+				if (side[k] * side[j] < 0)
+				{
+					int c = edgeVertex<Layout>(idx[k], idx[j], out);
+					onPlane[np] = true;
+					pos[np++] = c;
+					neg[nn++] = c;
+				}
+			}
 
-	for (int i = 0; i < faces.size(); ++i)
+			if (mCaps)
+			{
+				for (int k = 0; k < np; ++k)
+				{
+					int j = (k + 1) % np;
+					if (onPlane[k] && onPlane[j])
+					{
+						out.segments.push_back(std::make_pair(pos[k], pos[j]));
+						break;
+					}
+				}
+			}
+
+			fanTriangulate(pos, np, out.faces1);
+			fanTriangulate(neg, nn, out.faces2);
+		}
+	}
+}
+
+// Concatenates chunk outputs in face order. Each chunk's new vertices get a
+// slot range from a prefix sum over the chunk sizes. A cut edge on a chunk
+// border is created by both chunks, the first one keeps it and later
+// references are pointed there; the unused copy is dropped by buildHalf.
+// The result is the same as a single threaded slice.
+template <class Layout>
+void MeshSlicer::mergeChunks(std::vector<SliceChunk<Layout> >& ch, std::vector<typename Layout::Vertex>& added,
+	std::vector<vec3i>& faces1, std::vector<vec3i>& faces2)
+{
+	int hostCount = mSource.vertexCount;
+	int nchunks = (int)ch.size();
+
+	std::vector<size_t> vertOffset(nchunks + 1, 0), offset1(nchunks + 1, 0), offset2(nchunks + 1, 0), segOffset(nchunks + 1, 0);
+	for (int c = 0; c < nchunks; ++c)
 	{
-		XMLElement* face = temp.NewElement("face");
+		vertOffset[c+1] = vertOffset[c] + ch[c].added.size();
+		offset1[c+1] = offset1[c] + ch[c].faces1.size();
+		offset2[c+1] = offset2[c] + ch[c].faces2.size();
+		segOffset[c+1] = segOffset[c] + ch[c].segments.size();
+	}
 
-		face->SetAttribute("v1", faces[i].x);
-		face->SetAttribute("v2", faces[i].y);
-		face->SetAttribute("v3", faces[i].z);
-    // face->InsertEndChild(face);
-		facebuffer->InsertEndChild(face);		
+	// Only the cut edges are walked serially
+	mEdgeVerts.clear(vertOffset[nchunks]);
+	for (int c = 0; c < nchunks; ++c)
+	{
+		SliceChunk<Layout>& chunk = ch[c];
+		chunk.remap.resize(chunk.added.size());
+		for (size_t j = 0; j < chunk.added.size(); ++j)
+		{
+			int global = hostCount + (int)(vertOffset[c] + j);
+			chunk.remap[j] = mEdgeVerts.insert(chunk.addedEdges[j], global);
+		}
 	}
 
-  std::cout << "Writing Triangles Complete" << std::endl;
+	added.resize(vertOffset[nchunks]);
+	faces1.resize(offset1[nchunks]);
+	faces2.resize(offset2[nchunks]);
+	mCutSegments.resize(segOffset[nchunks]);
 
-	std::ostringstream oss;
-	std::string path;
-	std::string xmlName;
-	std::string meshName;
+	parallelFor(nchunks, [&](int c)
+	{
+		SliceChunk<Layout>& chunk = ch[c];
+		std::copy(chunk.added.begin(), chunk.added.end(), added.begin() + vertOffset[c]);
 
-	path = "../Assets/meshgen/";
-	
-	xmlName = path + filename +".xml";
-	meshName = path + filename;
+		struct Remap
+		{
+			int hostCount;
+			const std::vector<int>& local;
+			int operator()(int i) const { return i < hostCount ? i : local[i - hostCount]; }
+		} remap = { hostCount, chunk.remap };
 
-	temp.SaveFile(xmlName.c_str());
+		for (size_t i = 0; i < chunk.faces1.size(); ++i)
+		{
+			const vec3i& f = chunk.faces1[i];
+			faces1[offset1[c] + i] = vec3i(remap(f.x), remap(f.y), remap(f.z));
+		}
+		for (size_t i = 0; i < chunk.faces2.size(); ++i)
+		{
+			const vec3i& f = chunk.faces2[i];
+			faces2[offset2[c] + i] = vec3i(remap(f.x), remap(f.y), remap(f.z));
+		}
+		for (size_t i = 0; i < chunk.segments.size(); ++i)
+			mCutSegments[segOffset[c] + i] = std::make_pair(remap(chunk.segments[i].first), remap(chunk.segments[i].second));
+	});
+}
 
-	std::cout << "saved xml mesh file as " << xmlName;
+// Copies the vertices referenced by faces into a new mesh and remaps the indices.
+// Indices past the host's vertex count refer to added.
+template <class Layout>
+XML_Mesh* MeshSlicer::buildHalf(const std::vector<vec3i>& faces, const std::vector<typename Layout::Vertex>& added)
+{
+	int hostCount = mSource.vertexCount;
+	mRemap.assign(hostCount + added.size(), -1);
 
-	std::ostringstream cmd;
-	cmd << "OgreXMLConverter " << xmlName <<" " << meshName;
-	system("pwd");
-	system(cmd.str().c_str());
+	XML_Mesh* half = new XML_Mesh(std::vector<vec3f>(), std::vector<vec3i>());
+	half->faces.reserve(faces.size());
+	Layout::reserve(*half, std::min(faces.size() * 3, mRemap.size()));
 
-	std::cout << "Called following cmd :: " << cmd.str();
+	int count = 0;
+	for (std::vector<vec3i>::const_iterator f = faces.begin(); f != faces.end(); ++f)
+	{
+		int idx[3] = { f->x, f->y, f->z };
+		for (int k = 0; k < 3; ++k)
+		{
+			int& r = mRemap[idx[k]];
+			if (r < 0)
+			{
+				r = count++;
+				Layout::append(*half, idx[k] < hostCount ? Layout::fetch(mSource, idx[k]) : added[idx[k] - hostCount]);
+			}
+			idx[k] = r;
+		}
+		half->faces.push_back(vec3i(idx[0], idx[1], idx[2]));
+	}
 
+	return half;
 }
 
+// buildHalf into the arena. Vertices are numbered in order of first use,
+// then copied in one go once their count is known.
+template <class Layout>
+void MeshSlicer::buildView(const std::vector<vec3i>& faces, const std::vector<typename Layout::Vertex>& added, MeshView& view)
+{
+	int hostCount = mSource.vertexCount;
+	mRemap.assign(hostCount + added.size(), -1);
+	mOrder.clear();
+
+	view.faceCount = (int)faces.size();
+	view.faces = mArena.alloc<vec3i>(faces.size());
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		int idx[3] = { faces[i].x, faces[i].y, faces[i].z };
+		for (int k = 0; k < 3; ++k)
+		{
+			int& r = mRemap[idx[k]];
+			if (r < 0)
+			{
+				r = (int)mOrder.size();
+				mOrder.push_back(idx[k]);
+			}
+			idx[k] = r;
+		}
+		view.faces[i] = vec3i(idx[0], idx[1], idx[2]);
+	}
 
+	view.vertexCount = (int)mOrder.size();
+	Layout::allocate(mArena, view, view.vertexCount);
+	for (int i = 0; i < view.vertexCount; ++i)
+	{
+		int v = mOrder[i];
+		Layout::write(view, i, v < hostCount ? Layout::fetch(mSource, v) : added[v - hostCount]);
+	}
+}
 
-MeshSlicer::MeshSlicer(Ogre::SceneNode* node)
+// Twice the signed area of poly[start, end), positive when counter clockwise
+static float signedArea2(const std::vector<vec2f>& poly, int start, int end)
 {
-	mSceneNode = node;
+	float a = 0.0f;
+	for (int i = start, j = end - 1; i < end; j = i++)
+		a += poly[j].u * poly[i].v - poly[i].u * poly[j].v;
+	return a;
+}
 
-	system("rm ../Assets/meshgen/* -rf");
+static inline float cross2(const vec2f& o, const vec2f& a, const vec2f& b)
+{
+	return (a.u - o.u) * (b.v - o.v) - (a.v - o.v) * (b.u - o.u);
 }
 
-void MeshSlicer::loadMesh(XML_Mesh* mesh)
+static bool insideTriangle(const vec2f& p, const vec2f& a, const vec2f& b, const vec2f& c)
 {
-	mHost = mesh;
+	return cross2(a, b, p) >= 0.0f && cross2(b, c, p) >= 0.0f && cross2(c, a, p) >= 0.0f;
 }
 
-MeshSlicer::~MeshSlicer()
+// Even-odd test of p against the loop poly[start, end)
+static bool insideLoop(const vec2f& p, const std::vector<vec2f>& poly, int start, int end)
 {
+	bool inside = false;
+	for (int i = start, j = end - 1; i < end; j = i++)
+	{
+		const vec2f& a = poly[j];
+		const vec2f& b = poly[i];
+		if ((a.v > p.v) != (b.v > p.v) && p.u < a.u + (p.v - a.v) / (b.v - a.v) * (b.u - a.u))
+			inside = !inside;
+	}
+	return inside;
+}
 
+// Cut loops through a rock are nearly always star shaped around their area
+// centroid, which is checked in one pass and then fanned from an extra
+// vertex numbered centreIndex. False when some edge does not face it.
+static bool fanLoop(const std::vector<vec2f>& poly, int start, int end, int centreIndex, std::vector<int>& tris, vec2f& centre)
+{
+	float a2 = 0.0f, cx = 0.0f, cy = 0.0f;
+	for (int i = start, j = end - 1; i < end; j = i++)
+	{
+		float w = poly[j].u * poly[i].v - poly[i].u * poly[j].v;
+		a2 += w;
+		cx += (poly[j].u + poly[i].u) * w;
+		cy += (poly[j].v + poly[i].v) * w;
+	}
+	centre = vec2f(cx / (3.0f * a2), cy / (3.0f * a2));
+
+	for (int i = start, j = end - 1; i < end; j = i++)
+		if (cross2(centre, poly[j], poly[i]) <= 0.0f)
+			return false;
+
+	for (int i = start, j = end - 1; i < end; j = i++)
+	{
+		tris.push_back(centreIndex);
+		tris.push_back(j);
+		tris.push_back(i);
+	}
+	return true;
 }
 
-void MeshSlicer::sliceByPlane(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn)
+// Ear clipping of the counter clockwise ring of poly indices, testing only
+// reflex vertices. Bridged holes visit their slit ends twice, so corners at
+// the ear's own points do not block it.
+static void earClip(const std::vector<vec2f>& poly, const std::vector<int>& ring, std::vector<int>& tris, CutCap& scratch)
 {
+	int n = (int)ring.size();
+	std::vector<int>& prev = scratch.prev;
+	std::vector<int>& next = scratch.after;
+	std::vector<char>& reflex = scratch.reflex;
+	prev.resize(n);
+	next.resize(n);
+	reflex.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		prev[i] = (i + n - 1) % n;
+		next[i] = (i + 1) % n;
+	}
+	for (int i = 0; i < n; ++i)
+		reflex[i] = cross2(poly[ring[prev[i]]], poly[ring[i]], poly[ring[next[i]]]) <= 0.0f;
 
-	std::vector<Triangle> preserved;
-	std::vector<Triangle> clipped;
-	std::cout << "size of vertex buffer:  " << mHost->verts.size() << std::endl;
-	int count = 0;
-	for (std::vector<vec3i>::iterator i = mHost->faces.begin(); i != mHost->faces.end(); ++i)
+	int remaining = n;
+	int i = 0;
+	int stall = 0;
+	while (remaining > 3 && stall < remaining)
 	{
-		std:: cout <<"start loop" <<std::endl;
-		std::vector<vec3f> addedPoints;
-		vec3f a, b, c;
-		std::cout << "facet: " << count++ << std::endl;
-		std::cout << "indicies : " << (*i).x <<" "<< (*i).y <<" "<< (*i).z <<std::endl;
-		a = mHost->verts[(*i).x];
-		b = mHost->verts[(*i).y];
-		c = mHost->verts[(*i).z];
+		int p = prev[i], q = next[i];
+		bool ear = !reflex[i];
+		if (ear)
+		{
+			for (int k = next[q]; k != p; k = next[k])
+			{
+				int r = ring[k];
+				if (reflex[k] && r != ring[p] && r != ring[i] && r != ring[q]
+					&& insideTriangle(poly[r], poly[ring[p]], poly[ring[i]], poly[ring[q]]))
+				{
+					ear = false;
+					break;
+				}
+			}
+		}
 
-		Triangle tri(a, (*i).x, b, (*i).y, c, (*i).z);
-		
-		std:: cout <<"Entering clip" <<std::endl;
-		int flag = ClipFacet(tri, &addedPoints, &preserved, &clipped, pp, pn);
-		std:: cout <<"Exiting clip" <<std::endl;
+		if (!ear)
+		{
+			i = q;
+			stall++;
+			continue;
+		}
 
-		if(flag != 0 || flag != 1)
-			std:: cout <<"SOMETHING HAPPENDED" <<std::endl;
+		tris.push_back(ring[p]);
+		tris.push_back(ring[i]);
+		tris.push_back(ring[q]);
+		next[p] = q;
+		prev[q] = p;
+		remaining--;
+		reflex[p] = cross2(poly[ring[prev[p]]], poly[ring[p]], poly[ring[q]]) <= 0.0f;
+		reflex[q] = cross2(poly[ring[p]], poly[ring[q]], poly[ring[next[q]]]) <= 0.0f;
+		i = p;
+		stall = 0;
+	}
+
+	// Self intersecting leftovers are fanned so the cap at least stays closed
+	if (remaining >= 3)
+	{
+		int first = i;
+		for (int k = next[first]; next[k] != first; k = next[k])
+		{
+			tris.push_back(ring[first]);
+			tris.push_back(ring[k]);
+			tris.push_back(ring[next[k]]);
+		}
+	}
+}
 
-		std::cout << flag << std::endl;
-		if(!addedPoints.empty())
+// Splices the clockwise hole poly[start, end) into the ring of its outline
+// through a slit from the hole's rightmost point to an outline point it sees
+// (Eberly, "Triangulation by Ear Clipping"). A hole with no ring edge to
+// its right is not inside and stays out of the ring.
+static void bridgeHole(const std::vector<vec2f>& poly, int start, int end, std::vector<int>& ring, std::vector<int>& spliced)
+{
+	int m = start;
+	for (int k = start + 1; k < end; ++k)
+		if (poly[k].u > poly[m].u)
+			m = k;
+	const vec2f& mp = poly[m];
+
+	// Nearest ring edge crossed by the ray from m along +u
+	int n = (int)ring.size();
+	int edge = -1;
+	float hit = 0.0f;
+	for (int i = 0; i < n; ++i)
+	{
+		const vec2f& a = poly[ring[i]];
+		const vec2f& b = poly[ring[(i + 1) % n]];
+		if ((a.v > mp.v) == (b.v > mp.v))
+			continue;
+		float u = a.u + (mp.v - a.v) / (b.v - a.v) * (b.u - a.u);
+		if (u >= mp.u && (edge < 0 || u < hit))
 		{
-			std:: cout <<"added points not empty" <<std::endl;
+			edge = i;
+			hit = u;
+		}
+	}
+	if (edge < 0)
+		return;
+
+	// The end of that edge further along the ray, unless a reflex ring point
+	// inside the triangle it spans with the hit blocks the view; then the
+	// one of those closest in angle to the ray
+	int best = poly[ring[edge]].u > poly[ring[(edge + 1) % n]].u ? edge : (edge + 1) % n;
+	vec2f hp(hit, mp.v);
+	vec2f bp = poly[ring[best]];
+	float bestSlope = -1.0f;
+	for (int i = 0; i < n; ++i)
+	{
+		const vec2f& r = poly[ring[i]];
+		if (i == best || r.u <= mp.u || cross2(poly[ring[(i + n - 1) % n]], r, poly[ring[(i + 1) % n]]) > 0.0f)
+			continue;
+		bool inside = cross2(mp, hp, bp) >= 0.0f ? insideTriangle(r, mp, hp, bp) : insideTriangle(r, mp, bp, hp);
+		if (!inside)
+			continue;
+		float slope = fabs(r.v - mp.v) / (r.u - mp.u);
+		if (bestSlope < 0.0f || slope < bestSlope)
+		{
+			bestSlope = slope;
+			best = i;
+		}
+	}
+
+	// best, the hole from m round to m, then best again
+	spliced.clear();
+	spliced.insert(spliced.end(), ring.begin(), ring.begin() + best + 1);
+	for (int k = m; k < end; ++k)
+		spliced.push_back(k);
+	for (int k = start; k <= m; ++k)
+		spliced.push_back(k);
+	spliced.insert(spliced.end(), ring.begin() + best, ring.end());
+	ring.swap(spliced);
+}
 
-			for (std::vector<vec3f>::iterator i = addedPoints.begin(); i != addedPoints.end(); ++i)
+void triangulateCut(const std::vector<vec2f>& poly, const std::vector<int>& loopStart, std::vector<int>& tris, std::vector<vec2f>& centres, CutCap& scratch)
+{
+	tris.clear();
+	centres.clear();
+	int loops = (int)loopStart.size() - 1;
+	std::vector<float>& area = scratch.loopArea;
+	std::vector<int>& outline = scratch.outline;
+	area.resize(std::max(loops, 0));
+	outline.assign(std::max(loops, 0), -1);
+	for (int l = 0; l < loops; ++l)
+		area[l] = signedArea2(poly, loopStart[l], loopStart[l + 1]);
+
+	// Every hole belongs to the smallest outline around it
+	for (int l = 0; l < loops; ++l)
+	{
+		if (area[l] >= 0.0f)
+			continue;
+		for (int o = 0; o < loops; ++o)
+		{
+			if (area[o] <= 0.0f || (outline[l] >= 0 && area[o] >= area[outline[l]]))
+				continue;
+			if (insideLoop(poly[loopStart[l]], poly, loopStart[o], loopStart[o + 1]))
+				outline[l] = o;
+		}
+	}
+
+	std::vector<std::pair<float, int> >& holes = scratch.holes;
+	std::vector<int>& ring = scratch.ring;
+	for (int o = 0; o < loops; ++o)
+	{
+		if (area[o] <= 0.0f)
+			continue;
+
+		holes.clear();
+		for (int l = 0; l < loops; ++l)
+		{
+			if (outline[l] != o)
+				continue;
+			float right = poly[loopStart[l]].u;
+			for (int k = loopStart[l] + 1; k < loopStart[l + 1]; ++k)
+				right = std::max(right, poly[k].u);
+			holes.push_back(std::make_pair(right, l));
+		}
+
+		if (holes.empty())
+		{
+			vec2f centre;
+			if (fanLoop(poly, loopStart[o], loopStart[o + 1], (int)(poly.size() + centres.size()), tris, centre))
 			{
-				std:: cout <<"adding point" <<std::endl;
-				mHost->verts.push_back((*i));
-				std:: cout <<"point added" <<std::endl;
+				centres.push_back(centre);
+				continue;
 			}
 		}
-		else
+
+		ring.clear();
+		for (int k = loopStart[o]; k < loopStart[o + 1]; ++k)
+			ring.push_back(k);
+		// Rightmost hole first, so later slits may cross into earlier holes
+		std::sort(holes.begin(), holes.end());
+		for (int h = (int)holes.size() - 1; h >= 0; --h)
+		{
+			int l = holes[h].second;
+			bridgeHole(poly, loopStart[l], loopStart[l + 1], ring, scratch.spliced);
+		}
+		earClip(poly, ring, tris, scratch);
+	}
+}
+
+static inline unsigned int floatBits(float f)
+{
+	// -0 and 0 are the same position
+	f += 0.0f;
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static inline bool samePosition(const vec3f& a, const vec3f& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// All 96 bits of a position folded into a weld key, never EDGE_MAP_EMPTY
+static inline unsigned long long positionKey(const vec3f& p)
+{
+	unsigned long long key = ((unsigned long long)floatBits(p.x) << 32 | floatBits(p.y))
+		^ (unsigned long long)floatBits(p.z) * 0x9e3779b97f4a7c15ull;
+	return key == EDGE_MAP_EMPTY ? 0 : key;
+}
+
+// Seam duplicates are welded by position so UV splits in the host do not
+// break the loops
+void chainCutLoops(const std::vector<std::pair<vec3f, vec3f> >& segments, const vec3f& n, CutCap& cap)
+{
+	cap.loop.clear();
+	cap.loopStart.assign(1, 0);
+
+	// Plane basis with u x v = n
+	vec3f u = fabs(n.x) < 0.9f ? vec3f(0.0f, -n.z, n.y) : vec3f(-n.z, 0.0f, n.x);
+	float ul = sqrt(u.x*u.x + u.y*u.y + u.z*u.z);
+	u = vec3f(u.x / ul, u.y / ul, u.z / ul);
+	cap.u = u;
+	cap.v = vec3f(n.y*u.z - n.z*u.y, n.z*u.x - n.x*u.z, n.x*u.y - n.y*u.x);
+	const vec3f& v = cap.v;
+	if (segments.size() < 3)
+		return;
+
+	// Weld segment end points by exact position. Cut points are interpolated
+	// the same way for every copy of an edge, so seam copies carry the same
+	// bits, and a tolerance would only merge slivers of the cut into nothing.
+	EdgeMap& welded = cap.welded;
+	std::vector<vec3f>& points = cap.weldedPoints;
+	std::vector<vec2f>& proj = cap.proj;
+	std::vector<int>& next = cap.next;
+	std::vector<int>& firstEnd = cap.firstEnd;
+	welded.clear(segments.size());
+	points.clear();
+	proj.clear();
+	next.clear();
+	firstEnd.clear();
+
+	for (size_t s = 0; s < segments.size(); ++s)
+	{
+		const vec3f* ends[2] = { &segments[s].first, &segments[s].second };
+		int ids[2];
+		for (int e = 0; e < 2; ++e)
+		{
+			const vec3f& p = *ends[e];
+			// Positions fold into the key, so another point may already
+			// hold it; probe on until the point's own slot or a free one
+			unsigned long long key = positionKey(p);
+			for (;;)
+			{
+				ids[e] = welded.insert(key, (int)points.size());
+				if (ids[e] == (int)points.size() || samePosition(points[ids[e]], p))
+					break;
+				key = key * 0x9e3779b97f4a7c15ull + 1;
+				if (key == EDGE_MAP_EMPTY)
+					key = 0;
+			}
+			if (ids[e] == (int)points.size())
+			{
+				points.push_back(p);
+				proj.push_back(vec2f(p.x*u.x + p.y*u.y + p.z*u.z, p.x*v.x + p.y*v.y + p.z*v.z));
+				next.push_back(-1);
+				firstEnd.push_back((int)(2 * s + e));
+			}
+		}
+		if (ids[0] == ids[1])
+			continue;
+
+		// An in-plane edge shared by two faces of the same side is not on the outline
+		if (next[ids[1]] == ids[0])
 		{
-			std:: cout <<"no points added" <<std::endl;
+			next[ids[1]] = -1;
+			continue;
 		}
-		std:: cout <<"start loop" <<std::endl;
+		next[ids[0]] = ids[1];
+	}
+
+	vec2f& lo = cap.lo;
+	vec2f& hi = cap.hi;
+	lo = vec2f(0.0f);
+	hi = vec2f(0.0f);
+	for (size_t i = 0; i < proj.size(); ++i)
+	{
+		if (i == 0)
+		{
+			lo = proj[i];
+			hi = proj[i];
+		}
+		lo.u = std::min(lo.u, proj[i].u);
+		lo.v = std::min(lo.v, proj[i].v);
+		hi.u = std::max(hi.u, proj[i].u);
+		hi.v = std::max(hi.v, proj[i].v);
+	}
+	if (std::max(hi.u - lo.u, hi.v - lo.v) <= 0.0f)
+		return;
+
+	// Every loop's points back to back, loop l from loopStart[l]. Chains
+	// the kernel left open at a point on the plane are walked from their
+	// first point, so each comes out whole and is closed end to end.
+	std::vector<char>& visited = cap.visited;
+	std::vector<int>& loop = cap.loop;
+	std::vector<int>& loopStart = cap.loopStart;
+	// 1 once walked, 2 for points some other point leads to
+	visited.assign(points.size(), 0);
+	for (size_t i = 0; i < points.size(); ++i)
+		if (next[i] >= 0)
+			visited[next[i]] = 2;
+	loopStart.clear();
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (size_t start = 0; start < points.size(); ++start)
+		{
+			if (visited[start] == 1 || (pass == 0 && visited[start] == 2) || next[start] < 0)
+				continue;
+
+			size_t first = loop.size();
+			int k = (int)start;
+			while (k >= 0 && visited[k] != 1)
+			{
+				visited[k] = 1;
+				loop.push_back(k);
+				k = next[k];
+			}
+			if (loop.size() - first < 3)
+				loop.resize(first);
+			else
+				loopStart.push_back((int)first);
+		}
+	}
+	loopStart.push_back((int)loop.size());
+}
+
+// Chains cut segments into closed loops and triangulates them together, so
+// cavities and tunnels through the mesh stay open in the cap
+void buildCutCap(const std::vector<std::pair<vec3f, vec3f> >& segments, const vec3f& n, CutCap& cap)
+{
+	cap.points.clear();
+	cap.uvs.clear();
+	cap.tris.clear();
+	chainCutLoops(segments, n, cap);
+	if (cap.loop.empty())
+		return;
+
+	const vec3f& u = cap.u;
+	const vec3f& v = cap.v;
+	const std::vector<vec3f>& points = cap.weldedPoints;
+	const std::vector<int>& loop = cap.loop;
+	const vec2f& lo = cap.lo;
+	// Planar texcoords span the whole cut so all loops of it share one mapping
+	float extent = std::max(cap.hi.u - lo.u, cap.hi.v - lo.v);
+	std::vector<vec2f>& poly = cap.poly;
+	poly.clear();
+	for (size_t i = 0; i < loop.size(); ++i)
+		poly.push_back(cap.proj[loop[i]]);
+
+	std::vector<int>& tris = cap.loopTris;
+	std::vector<vec2f>& centres = cap.centres;
+	triangulateCut(poly, cap.loopStart, tris, centres, cap);
+
+	// Only points a triangle uses become cap vertices. Fan centres are lifted
+	// back onto the plane, u and v only span it.
+	const vec3f& o = points[loop[0]];
+	float d = n.x*o.x + n.y*o.y + n.z*o.z;
+	std::vector<int>& remap = cap.remap;
+	remap.assign(poly.size() + centres.size(), -1);
+	for (size_t t = 0; t < tris.size(); ++t)
+	{
+		int i = tris[t];
+		if (remap[i] >= 0)
+			continue;
+		remap[i] = (int)cap.points.size();
+		vec2f uv = i < (int)poly.size() ? poly[i] : centres[i - poly.size()];
+		if (i < (int)poly.size())
+			cap.points.push_back(points[loop[i]]);
+		else
+			cap.points.push_back(vec3f(u.x*uv.u + v.x*uv.v + n.x*d, u.y*uv.u + v.y*uv.v + n.y*d, u.z*uv.u + v.z*uv.v + n.z*d));
+		cap.uvs.push_back(vec2f((uv.u - lo.u) / extent, (uv.v - lo.v) / extent));
+	}
+	for (size_t t = 0; t < tris.size(); t += 3)
+		cap.tris.push_back(vec3i(remap[tris[t]], remap[tris[t+1]], remap[tris[t+2]]));
+}
+
+// Caps the cut of a slice, one cap facing away from each half. Cap vertices
+// are separate from the side ones, they need the cap normal.
+template <class Layout>
+void MeshSlicer::buildCaps(const vec3f& n, std::vector<typename Layout::Vertex>& added, std::vector<vec3i>& faces1, std::vector<vec3i>& faces2)
+{
+	if (mCutSegments.size() < 3)
+		return;
+
+	int hostCount = mSource.vertexCount;
+	std::vector<std::pair<vec3f, vec3f> >& segments = mCapSegments;
+	segments.resize(mCutSegments.size());
+	for (size_t s = 0; s < mCutSegments.size(); ++s)
+	{
+		int a = mCutSegments[s].first, b = mCutSegments[s].second;
+		segments[s].first = a < hostCount ? mSource.verts[a] : added[a - hostCount].p;
+		segments[s].second = b < hostCount ? mSource.verts[b] : added[b - hostCount].p;
+	}
+
+	CutCap& cap = mCap;
+	buildCutCap(segments, n, cap);
+	if (cap.tris.empty())
+		return;
+
+	// The half the normal points to gets a cap facing -n, the other one +n
+	int count = (int)cap.points.size();
+	int base1 = hostCount + (int)added.size();
+	int base2 = base1 + count;
+	vec3f up(-n.x, -n.y, -n.z);
+	for (int side = 0; side < 2; ++side)
+	{
+		const vec3f& cn = side == 0 ? up : n;
+		for (int i = 0; i < count; ++i)
+			added.push_back(Layout::make(cap.points[i], cn, cap.uvs[i]));
+	}
+
+	for (size_t t = 0; t < cap.tris.size(); ++t)
+	{
+		const vec3i& f = cap.tris[t];
+		faces1.push_back(vec3i(base1 + f.x, base1 + f.z, base1 + f.y));
+		faces2.push_back(vec3i(base2 + f.x, base2 + f.y, base2 + f.z));
+	}
+}
+
+// Returns the vertex where edge a-b crosses the plane, creating it the first time
+template <class Layout>
+int MeshSlicer::edgeVertex(int a, int b, SliceChunk<Layout>& out)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	unsigned long long key = ((unsigned long long)a << 32) | (unsigned int)b;
+	int index = mSource.vertexCount + (int)out.added.size();
+	int found = out.edgeVerts.insert(key, index);
+	if (found != index)
+		return found;
+
+	// Always from the end below the plane, not the lower index. Seam copies of
+	// an edge share positions but not indices, and must get the same bits.
+	int from = mDist[a] < 0.0f ? a : b, to = from == a ? b : a;
+	float t = mDist[from] / (mDist[from] - mDist[to]);
+	out.added.push_back(Layout::lerp(Layout::fetch(mSource, from), Layout::fetch(mSource, to), t));
+	out.addedEdges.push_back(key);
+	return index;
+}
+
+template void MeshSlicer::slice<PositionLayout>(std::vector<XML_Mesh*>&, vec3f, vec3f);
+template void MeshSlicer::slice<RenderLayout>(std::vector<XML_Mesh*>&, vec3f, vec3f);
+template void MeshSlicer::sliceInto<PositionLayout>(MeshView*, vec3f, vec3f);
+template void MeshSlicer::sliceInto<RenderLayout>(MeshView*, vec3f, vec3f);
+
+void MeshSlicer::sliceByPlaneLegacy(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn)
+{
+	if (!mHost)
+	{
+		LOG_ERROR(LOG_SLICER, "Legacy slice needs a loaded XML_Mesh");
+		return;
+	}
+
+	std::vector<Triangle> preserved;
+	std::vector<Triangle> clipped;
+	std::vector<vec3f> addedPoints;
+	// Cut points go after a copy of the host's vertices
+	std::vector<vec3f> verts = mHost->verts;
+	LOG_DEBUG(LOG_SLICER, "Legacy slice of " << mHost->faces.size() << " faces, " << verts.size() << " verts");
+	for (std::vector<vec3i>::iterator i = mHost->faces.begin(); i != mHost->faces.end(); ++i)
+	{
+		addedPoints.clear();
+		vec3f a, b, c;
+		a = verts[(*i).x];
+		b = verts[(*i).y];
+		c = verts[(*i).z];
+
+		Triangle tri(a, (*i).x, b, (*i).y, c, (*i).z);
+		
+		int flag = ClipFacet(tri, (int)verts.size(), &addedPoints, &preserved, &clipped, pp, pn);
+		LOG_TRACE(LOG_SLICER, "facet " << (i - mHost->faces.begin()) << " (" << (*i).x << " " << (*i).y << " " << (*i).z << ") case " << flag
+			<< ", " << addedPoints.size() << " points added");
+
+		for (std::vector<vec3f>::iterator i = addedPoints.begin(); i != addedPoints.end(); ++i)
+			verts.push_back((*i));
 	}
-	std::cout << "size of vertex buffer:  " << mHost->verts.size() << std::endl;
 
-	std::cout << "size of clipped side:  " << clipped.size() << std::endl;
-	std::cout << "size of preserved side:  " << preserved.size() << std::endl;
+	LOG_DEBUG(LOG_SLICER, "Legacy slice kept " << preserved.size() << " and clipped " << clipped.size() << " faces, "
+		<< verts.size() << " verts");
 
 	std::vector<vec3i> faces1;
 	std::vector<vec3i> faces2;
@@ -278,11 +1375,10 @@ void MeshSlicer::sliceByPlane(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn
 		faces2.push_back(vec3i(i->getIndex(0), i->getIndex(1), i->getIndex(2)));
 	}
 
-	XML_Mesh* m1 = new XML_Mesh(mHost->verts, faces1);
-	XML_Mesh* m2 = new XML_Mesh(mHost->verts, faces2);
+	XML_Mesh* m1 = new XML_Mesh(verts, faces1);
+	XML_Mesh* m2 = new XML_Mesh(verts, faces2);
 	meshes.push_back(m1);
 	meshes.push_back(m2);
-	std::cout << "mesh slicing finished" << std::endl;
 
 }
 
@@ -296,19 +1392,19 @@ void MeshSlicer::sliceByPlane(std::vector<XML_Mesh*>& meshes, vec3f pp, vec3f pn
    Return the number of vertices in the clipped polygon
 */
 
-int MeshSlicer::ClipFacet(Triangle in, std::vector<vec3f>* addedPoints, std::vector<Triangle>* preserved, std::vector<Triangle>* clipped, vec3f p0, vec3f n)
+int MeshSlicer::ClipFacet(const Triangle& in, int firstAdded, std::vector<vec3f>* addedPoints, std::vector<Triangle>* preserved, std::vector<Triangle>* clipped, vec3f p0, vec3f n)
 {
 
    double A,B,C,D;
    double l;
    double side[3];
    vec3f q;
-   std::vector<vec3f> p(4);
-   p.push_back(in[0]);
-   p.push_back(in[1]);
-   p.push_back(in[2]);
+   vec3f p[4];
+   p[0] = in[0];
+   p[1] = in[1];
+   p[2] = in[2];
 
-   int buffersize = mHost->verts.size();
+   int buffersize = firstAdded;
 
    /*
       Determine the equation of the plane as
@@ -318,7 +1414,7 @@ int MeshSlicer::ClipFacet(Triangle in, std::vector<vec3f>* addedPoints, std::vec
    A = n.x / l;
    B = n.y / l;
    C = n.z / l;
-   D = -(n.x*p0.x + n.y*p0.y + n.z*p0.z);
+   D = -(A*p0.x + B*p0.y + C*p0.z);
 
    /*
       Evaluate the equation of the plane for each vertex
@@ -438,7 +1534,6 @@ int MeshSlicer::ClipFacet(Triangle in, std::vector<vec3f>* addedPoints, std::vec
 
    /* Is p1 the only point on the not-clipped side */
    if (side[1] < 0 && side[0] > 0 && side[2] > 0) {
-   		std::cout<<6<<std::endl;
       q.x = p[1].x - side[1] * (p[0].x - p[1].x) / (side[0] - side[1]);
       q.y = p[1].y - side[1] * (p[0].y - p[1].y) / (side[0] - side[1]);
       q.z = p[1].z - side[1] * (p[0].z - p[1].z) / (side[0] - side[1]);
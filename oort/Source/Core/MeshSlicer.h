@@ -1,11 +1,15 @@
 #pragma once
 
-#include "GameObject.h"
+// Only Vector3 from Ogre, so the slicer builds without the game around it
+#include <OgreVector3.h>
 #include <string>
 #include <cstdlib>
 #include <vector>
 
 #include "tinyxml2.h"
+#include "WorkerPool.h"
+#include "EdgeMap.h"
+#include "SliceArena.h"
 
 using namespace tinyxml2;
 
@@ -18,8 +22,6 @@ struct vec2f
 		v(v_)
 	{}
 
-  ~vec2f(){}
-  
   vec2f(float a=0.0f)
   {
     u=a;
@@ -51,8 +53,6 @@ struct vec3f
     y = a;
     z = a;
   }
-
-  ~vec3f(){}
 };
 
 struct vec3d
@@ -72,8 +72,6 @@ struct vec3d
     y = a;
     z = a;
   }
-
-  ~vec3d(){}
 };
 
 struct vec3i
@@ -86,25 +84,28 @@ struct vec3i
 		y(y_), 
 		z(z_)
 	{}
-  
-  ~vec3i(){}
+
+  vec3i(int a = 0)
+  {
+    x = a;
+    y = a;
+    z = a;
+  }
 };
 
 struct Triangle
 {
-	std::vector<vec3f> verts;
-	std::vector<int> indices;
+	vec3f verts[3];
+	int indices[3];
 	Triangle(vec3f p0, int i0, vec3f p1, int i1, vec3f p2, int i2)
 	{
-		verts.push_back(p0);
-		verts.push_back(p1);
-		verts.push_back(p2);
-
-		indices.push_back(i0);
-		indices.push_back(i1); 
-		indices.push_back(i2);
-
+		verts[0] = p0;
+		verts[1] = p1;
+		verts[2] = p2;
 
+		indices[0] = i0;
+		indices[1] = i1;
+		indices[2] = i2;
 	}
 
   	vec3f& operator[](unsigned int i)
@@ -116,7 +117,7 @@ struct Triangle
 		return verts[i];
 	}
 
-	int getIndex(unsigned int i)
+	int getIndex(unsigned int i) const
 	{
 		return indices[i];
 	}
@@ -125,8 +126,20 @@ struct Triangle
 	{
 		indices[i] = val;
 	}
+};
 
-  ~Triangle(){}
+// A run of spatially close faces and the box around them. The slicer tests
+// the box against the plane and only clips faces of boxes the plane crosses.
+struct FaceChunk
+{
+	vec3f min;
+	vec3f max;
+	// Faces [faceBegin, faceEnd) of the mesh
+	int faceBegin;
+	int faceEnd;
+	// Vertices those faces use, [vertBegin, vertEnd) of XML_Mesh::chunkVerts
+	int vertBegin;
+	int vertEnd;
 };
 
 struct XML_Mesh
@@ -138,6 +151,10 @@ struct XML_Mesh
  	std::vector<vec3f> normals;
  	std::vector<vec2f> texcoords;
 
+	// Filled by buildChunks, empty until then
+	std::vector<FaceChunk> chunks;
+	std::vector<int> chunkVerts;
+
  	// XMLElement* xmlRoot;
 
  	// XMLElement* xmlVertexBuffer;
@@ -150,13 +167,22 @@ struct XML_Mesh
  	std::string path;
   XML_Mesh();
  	XML_Mesh(std::string name);
- 	XML_Mesh(std::vector<vec3f> v, std::vector<vec3i> i);
+ 	XML_Mesh(const std::vector<vec3f>& v, const std::vector<vec3i>& i);
 
   ~XML_Mesh()
    {}
    
+	// Saves ../Assets/meshgen/<filename> as a binary Ogre mesh
  	void toFile(std::string filename);
  	void loadFromXMLFile(std::string filename);
+	// True when every index fits a 16 bit index buffer
+	bool fitsIn16BitIndices() const;
+	// Sorts the faces along a Morton curve and groups them into chunks of
+	// facesPerChunk with their bounds. Done by loadFromXMLFile; meshes built
+	// in code call it themselves once their faces are final.
+	void buildChunks(int facesPerChunk = 32);
+	// Chunks cover the faces as they are now
+	bool hasChunks() const;
 /*
 	void addVertex(vec3f pos, vec3f norm, vec2f uv);
 	bool addFace(int a, int b, int c);
@@ -165,9 +191,177 @@ struct XML_Mesh
 };
 
 
+// Read only arrays of a mesh to cut, pointing into an XML_Mesh or straight
+// into a mapped MeshCache. normals and texcoords are NULL unless the mesh
+// has both for every vertex, chunks is NULL when it has no chunk bounds.
+struct HostMesh
+{
+	const vec3f* verts;
+	const vec3f* normals;
+	const vec2f* texcoords;
+	const vec3i* faces;
+	const FaceChunk* chunks;
+	const int* chunkVerts;
+	int vertexCount;
+	int faceCount;
+	int chunkCount;
+
+	HostMesh();
+	// Valid until the mesh's vectors change
+	explicit HostMesh(const XML_Mesh& mesh);
+};
+
+
+// One half of an arena backed slice. The arrays live in the slicer's arena
+// and stay valid until its next slice; normals and texcoords are NULL when
+// the slice carried positions only.
+struct MeshView
+{
+	vec3f* verts;
+	vec3f* normals;
+	vec2f* texcoords;
+	vec3i* faces;
+	int vertexCount;
+	int faceCount;
+};
+
+
+// Vertex layouts the slicing kernel is compiled for. A layout says what a
+// vertex carries, how to read it from a mesh, blend two of them at a cut
+// and write one out, so each caller only pays for the attributes it uses.
+
+// Positions only, for collision hulls and other physics consumers
+struct PositionLayout
+{
+	struct Vertex
+	{
+		vec3f p;
+	};
+
+	static Vertex fetch(const HostMesh& mesh, int i);
+	static Vertex lerp(const Vertex& a, const Vertex& b, float t);
+	static Vertex make(const vec3f& p, const vec3f& n, const vec2f& uv);
+	static void reserve(XML_Mesh& mesh, size_t n);
+	static void append(XML_Mesh& mesh, const Vertex& v);
+	static void allocate(SliceArena& arena, MeshView& view, int n);
+	static void write(MeshView& view, int i, const Vertex& v);
+};
+
+// Position, normal and texcoord, for meshes that get rendered
+struct RenderLayout
+{
+	struct Vertex
+	{
+		vec3f p;
+		vec3f n;
+		vec2f uv;
+	};
+
+	static Vertex fetch(const HostMesh& mesh, int i);
+	static Vertex lerp(const Vertex& a, const Vertex& b, float t);
+	static Vertex make(const vec3f& p, const vec3f& n, const vec2f& uv);
+	static void reserve(XML_Mesh& mesh, size_t n);
+	static void append(XML_Mesh& mesh, const Vertex& v);
+	static void allocate(SliceArena& arena, MeshView& view, int n);
+	static void write(MeshView& view, int i, const Vertex& v);
+};
+
+
+// Triangulated cross section of a closed surface with a plane
+struct CutCap
+{
+	std::vector<vec3f> points;
+	std::vector<vec2f> uvs;
+	// Counter clockwise around the plane normal
+	std::vector<vec3i> tris;
+	// Plane basis with u x v = n, and the bounds of the cut in it
+	vec3f u, v;
+	vec2f lo, hi;
+
+	// Scratch kept between calls, so capping a cut does not allocate once warm
+	EdgeMap welded;
+	std::vector<vec3f> weldedPoints;
+	// Segment end every welded point was first seen at, 2 * segment + end
+	std::vector<int> firstEnd;
+	std::vector<int> next;
+	std::vector<vec2f> proj;
+	std::vector<char> visited;
+	std::vector<int> loop;
+	std::vector<int> loopStart;
+	std::vector<vec2f> poly;
+	std::vector<int> loopTris;
+	std::vector<vec2f> centres;
+	std::vector<int> remap;
+	std::vector<float> loopArea;
+	std::vector<int> outline;
+	std::vector<std::pair<float, int> > holes;
+	std::vector<int> ring;
+	std::vector<int> spliced;
+	std::vector<int> prev;
+	std::vector<int> after;
+	std::vector<char> reflex;
+};
+
+// Chains cut segments, given in the winding of the side the plane normal
+// points to, into loops of welded points: loop l is weldedPoints[loop[k]] for
+// k in [loopStart[l], loopStart[l + 1]), projected in proj. Sets u, v, lo, hi.
+void chainCutLoops(const std::vector<std::pair<vec3f, vec3f> >& segments, const vec3f& n, CutCap& cap);
+
+// Chains cut segments, given in the winding of the side the plane normal
+// points to, into loops and triangulates them with planar texcoords
+void buildCutCap(const std::vector<std::pair<vec3f, vec3f> >& segments, const vec3f& n, CutCap& cap);
+
+// Triangulates the loops of one cut, loop l being poly[loopStart[l],
+// loopStart[l + 1]). Counter clockwise loops are outlines, clockwise ones
+// holes of the smallest outline around them and bridged into it. tris index
+// into poly; outlines fanned from a centre add it to centres, numbered from
+// poly.size() on. Holes outside every outline are dropped.
+void triangulateCut(const std::vector<vec2f>& poly, const std::vector<int>& loopStart, std::vector<int>& tris, std::vector<vec2f>& centres, CutCap& scratch);
+
+// One piece of a shatter. Bounds and sizes are kept next to the mesh so
+// physics and debris code can size things without walking it.
+struct Fragment
+{
+	XML_Mesh* mesh;
+	vec3f min;
+	vec3f max;
+	int vertexCount;
+	int faceCount;
+};
+
+
+// What one run of faces produces while clipping, merged in face order after
+template <class Layout>
+struct SliceChunk
+{
+	EdgeMap edgeVerts;
+	std::vector<typename Layout::Vertex> added;
+	// Edge key of every added vertex, and its index after the merge
+	std::vector<unsigned long long> addedEdges;
+	std::vector<int> remap;
+	std::vector<vec3i> faces1;
+	std::vector<vec3i> faces2;
+	std::vector<std::pair<int, int> > segments;
+};
+
+// Everything a slice of one layout keeps between calls: the chunks, and
+// the merged vertices and faces both halves are built from
+template <class Layout>
+struct SliceBuffers
+{
+	std::vector<SliceChunk<Layout> > chunks;
+	std::vector<typename Layout::Vertex> added;
+	std::vector<vec3i> faces1;
+	std::vector<vec3i> faces2;
+};
+
+
 class MeshSlicer
 {
+	// The mesh loaded by pointer, NULL when a view was loaded
 	XML_Mesh* mHost;
+	// What every slice reads, refreshed from mHost before each one
+	HostMesh mSource;
 	Ogre::SceneNode* mSceneNode;
 
 public:
@@ -177,10 +371,95 @@ public:
 	MeshSlicer(Ogre::SceneNode* node);
 	~MeshSlicer();
 
+	// Two pass slice: one signed distance per vertex, then faces are clipped through
+	// an edge -> vertex map so every cut edge adds exactly one vertex.
+	// meshHalves gets the side the normal points to, then the other side, each
+	// holding only the vertices it uses. The host mesh is not modified.
+	// Normals and texcoords are interpolated at the cut when the host has them.
+	// With capping on (the default) the cut loops are triangulated so both
+	// halves come out closed, the caps get planar projected texcoords.
 	void sliceByPlane(std::vector<XML_Mesh*>& meshHalves, vec3f planepoint, vec3f planenormal);
+	// Same cut, positions only
+	void sliceByPlanePositions(std::vector<XML_Mesh*>& meshHalves, vec3f planepoint, vec3f planenormal);
+	template <class Layout>
+	void slice(std::vector<XML_Mesh*>& meshHalves, vec3f planepoint, vec3f planenormal);
+	// Same cut again, but both halves are written to the slicer's arena instead
+	// of new meshes. All scratch is kept between slices, so once it has grown
+	// to fit the host, slicing makes no heap allocation.
+	void sliceByPlaneInto(MeshView halves[2], vec3f planepoint, vec3f planenormal);
+	template <class Layout>
+	void sliceInto(MeshView halves[2], vec3f planepoint, vec3f planenormal);
+	// Blocks the arena took from the heap so far
+	size_t arenaAllocations() const;
+	// Original per facet clipper, kept for comparison. The halves share a
+	// copy of the host's vertices with the cut points added, the host is
+	// left as it was.
+	void sliceByPlaneLegacy(std::vector<XML_Mesh*>& meshHalves, vec3f planepoint, vec3f planenormal);
+	// Cuts the host by all planes in one walk over its faces instead of one
+	// slice per plane. Every non empty cell of the plane arrangement becomes a
+	// fragment. With capping on the cross sections are cut along the lines
+	// where planes meet, so fragments close up; three or more planes through
+	// one line may still leave slivers. At most 32 planes.
+	void shatterByPlanes(std::vector<Fragment>& fragments, const std::vector<vec3f>& planepoints, const std::vector<vec3f>& planenormals);
+	// Splits the host into the Voronoi cells of seeds, e.g. scattered around
+	// a hit point. Each cell is cut out by its bisectors with the other seeds.
+	// Fragments come out in seed order, empty cells are skipped. At most 33 seeds.
+	void shatterVoronoi(std::vector<Fragment>& fragments, const std::vector<vec3f>& seeds);
 	void loadMesh(XML_Mesh* mesh);
+	// Slices the arrays where they are, e.g. a mapped MeshCache, which must
+	// stay open while the slicer uses it. The legacy slice needs a mesh.
+	void loadMesh(const HostMesh& mesh);
+	void setCapping(bool caps);
+	// Meshes big enough are clipped on this many threads, output does not depend on it
+	void setThreads(int threads);
+	int getThreads() const;
 	private:
-	int ClipFacet(Triangle in, 
+	bool mCaps;
+	WorkerPool* mPool;
+	SliceBuffers<PositionLayout> mPositionBuffers;
+	SliceBuffers<RenderLayout> mRenderBuffers;
+	SliceArena mArena;
+
+	// Scratch reused between slices
+	std::vector<float> mDist;
+	// Which side of the plane each face chunk is on, and the crossed ones
+	std::vector<signed char> mChunkSide;
+	std::vector<int> mCrossing;
+	// Stand in chunks for meshes loaded without bounds
+	std::vector<FaceChunk> mSpans;
+	// Cut edge -> vertex across chunks
+	EdgeMap mEdgeVerts;
+	std::vector<int> mRemap;
+	std::vector<int> mOrder;
+	// Cut edges of the side the normal points to, in that half's winding
+	std::vector<std::pair<int, int> > mCutSegments;
+	std::vector<std::pair<vec3f, vec3f> > mCapSegments;
+	CutCap mCap;
+
+	void syncHost();
+	template <class Layout>
+	void cut(vec3f planepoint, vec3f planenormal);
+	template <class Layout>
+	void buildCaps(const vec3f& n, std::vector<typename Layout::Vertex>& added, std::vector<vec3i>& faces1, std::vector<vec3i>& faces2);
+
+	template <class Layout>
+	SliceBuffers<Layout>& buffers();
+	template <class Job>
+	void parallelFor(int count, const Job& job);
+	template <class Layout>
+	void clipFaces(const FaceChunk* chunks, size_t begin, size_t end, SliceChunk<Layout>& out);
+	template <class Layout>
+	void mergeChunks(std::vector<SliceChunk<Layout> >& ch, std::vector<typename Layout::Vertex>& added,
+		std::vector<vec3i>& faces1, std::vector<vec3i>& faces2);
+	template <class Layout>
+	int edgeVertex(int a, int b, SliceChunk<Layout>& out);
+	template <class Layout>
+	XML_Mesh* buildHalf(const std::vector<vec3i>& faces, const std::vector<typename Layout::Vertex>& added);
+	template <class Layout>
+	void buildView(const std::vector<vec3i>& faces, const std::vector<typename Layout::Vertex>& added, MeshView& view);
+	// Points it adds are numbered from firstAdded on
+	int ClipFacet(const Triangle& in, 
+		int firstAdded, 
 		std::vector<vec3f>* addedPoints, 
 		std::vector<Triangle>* preserved, 
 		std::vector<Triangle>* clipped, 
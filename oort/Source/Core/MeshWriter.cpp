@@ -0,0 +1,219 @@
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Chunk ids from Ogre's OgreMeshFileFormat.h
+static const unsigned short M_HEADER = 0x1000;
+static const unsigned short M_MESH = 0x3000;
+static const unsigned short M_SUBMESH = 0x4000;
+static const unsigned short M_SUBMESH_OPERATION = 0x4010;
+static const unsigned short M_GEOMETRY = 0x5000;
+static const unsigned short M_GEOMETRY_VERTEX_DECLARATION = 0x5100;
+static const unsigned short M_GEOMETRY_VERTEX_ELEMENT = 0x5110;
+static const unsigned short M_GEOMETRY_VERTEX_BUFFER = 0x5200;
+static const unsigned short M_GEOMETRY_VERTEX_BUFFER_DATA = 0x5210;
+static const unsigned short M_MESH_BOUNDS = 0x9000;
+static const unsigned short M_SUBMESH_NAME_TABLE = 0xA000;
+static const unsigned short M_SUBMESH_NAME_TABLE_ELEMENT = 0xA100;
+
+// The version OgreXMLConverter wrote the shipped meshes in, read by every
+// Ogre since 1.8
+static const char* VERSION = "[MeshSerializer_v1.8]";
+
+// Ogre's VertexElementType, VertexElementSemantic and OperationType values
+static const unsigned short VET_FLOAT2 = 1;
+static const unsigned short VET_FLOAT3 = 2;
+static const unsigned short VES_POSITION = 1;
+static const unsigned short VES_NORMAL = 4;
+static const unsigned short VES_TEXTURE_COORDINATES = 7;
+static const unsigned short OT_TRIANGLE_LIST = 4;
+
+// Chunk id and length
+static const size_t CHUNK_HEADER = sizeof(unsigned short) + sizeof(unsigned int);
+// Position, normal, texcoord
+static const unsigned short VERTEX_SIZE = 8 * sizeof(float);
+
+// Ogre reads the file in whichever byte order its header id came in, so
+// everything goes out as the machine has it
+void MeshWriter::put(const void* data, size_t bytes)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	buffer.insert(buffer.end(), p, p + bytes);
+}
+
+void MeshWriter::putShort(unsigned short v)
+{
+	put(&v, sizeof(v));
+}
+
+void MeshWriter::putInt(unsigned int v)
+{
+	put(&v, sizeof(v));
+}
+
+void MeshWriter::putFloat(float v)
+{
+	put(&v, sizeof(v));
+}
+
+void MeshWriter::putBool(bool v)
+{
+	unsigned char b = v ? 1 : 0;
+	put(&b, 1);
+}
+
+// Strings end in a newline, not a zero
+void MeshWriter::putString(const std::string& s)
+{
+	put(s.data(), s.size());
+	buffer.push_back('\n');
+}
+
+// The length counts the header too and is filled in by endChunk
+void MeshWriter::beginChunk(unsigned short id)
+{
+	putShort(id);
+	open.push_back(buffer.size());
+	putInt(0);
+}
+
+void MeshWriter::endChunk()
+{
+	size_t at = open.back();
+	open.pop_back();
+	unsigned int length = (unsigned int)(buffer.size() - at + sizeof(unsigned short));
+	memcpy(&buffer[at], &length, sizeof(length));
+}
+
+const std::vector<unsigned char>& MeshWriter::encode(const XML_Mesh& mesh, const std::string& material)
+{
+	size_t count = mesh.verts.size();
+	bool wide = !mesh.fitsIn16BitIndices();
+	buffer.clear();
+	open.clear();
+	buffer.reserve(64 + material.size() * 2 + count * (VERTEX_SIZE + CHUNK_HEADER) + mesh.faces.size() * 3 * (wide ? 4 : 2));
+
+	putShort(M_HEADER);
+	putString(VERSION);
+
+	beginChunk(M_MESH);
+	// Not skeletally animated
+	putBool(false);
+
+	beginChunk(M_GEOMETRY);
+	putInt((unsigned int)count);
+
+	beginChunk(M_GEOMETRY_VERTEX_DECLARATION);
+	const unsigned short elements[3][5] = {
+		// source, type, semantic, offset, index
+		{ 0, VET_FLOAT3, VES_POSITION, 0, 0 },
+		{ 0, VET_FLOAT3, VES_NORMAL, 3 * sizeof(float), 0 },
+		{ 0, VET_FLOAT2, VES_TEXTURE_COORDINATES, 6 * sizeof(float), 0 }
+	};
+	for (int e = 0; e < 3; ++e)
+	{
+		beginChunk(M_GEOMETRY_VERTEX_ELEMENT);
+		for (int k = 0; k < 5; ++k)
+			putShort(elements[e][k]);
+		endChunk();
+	}
+	endChunk();
+
+	beginChunk(M_GEOMETRY_VERTEX_BUFFER);
+	// Bind index and vertex size
+	putShort(0);
+	putShort(VERTEX_SIZE);
+	beginChunk(M_GEOMETRY_VERTEX_BUFFER_DATA);
+	bool normals = mesh.normals.size() == count;
+	bool texcoords = mesh.texcoords.size() == count;
+	for (size_t i = 0; i < count; ++i)
+	{
+		float v[8] = { mesh.verts[i].x, mesh.verts[i].y, mesh.verts[i].z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		if (normals)
+		{
+			v[3] = mesh.normals[i].x;
+			v[4] = mesh.normals[i].y;
+			v[5] = mesh.normals[i].z;
+		}
+		if (texcoords)
+		{
+			v[6] = mesh.texcoords[i].u;
+			v[7] = mesh.texcoords[i].v;
+		}
+		put(v, sizeof(v));
+	}
+	endChunk();
+	endChunk();
+	endChunk();
+
+	beginChunk(M_SUBMESH);
+	putString(material);
+	// Uses the shared vertices
+	putBool(true);
+	putInt((unsigned int)(mesh.faces.size() * 3));
+	putBool(wide);
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		const vec3i& face = mesh.faces[f];
+		if (wide)
+		{
+			unsigned int idx[3] = { (unsigned int)face.x, (unsigned int)face.y, (unsigned int)face.z };
+			put(idx, sizeof(idx));
+		}
+		else
+		{
+			unsigned short idx[3] = { (unsigned short)face.x, (unsigned short)face.y, (unsigned short)face.z };
+			put(idx, sizeof(idx));
+		}
+	}
+	beginChunk(M_SUBMESH_OPERATION);
+	putShort(OT_TRIANGLE_LIST);
+	endChunk();
+	endChunk();
+
+	// Box, then the radius of the sphere around the origin, as Ogre sets them
+	vec3f lo(0.0f), hi(0.0f);
+	float radius = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const vec3f& p = mesh.verts[i];
+		if (i == 0)
+			lo = hi = p;
+		lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		radius = std::max(radius, p.x*p.x + p.y*p.y + p.z*p.z);
+	}
+	beginChunk(M_MESH_BOUNDS);
+	putFloat(lo.x);
+	putFloat(lo.y);
+	putFloat(lo.z);
+	putFloat(hi.x);
+	putFloat(hi.y);
+	putFloat(hi.z);
+	putFloat(sqrtf(radius));
+	endChunk();
+
+	// The submesh is named after its material, like the shipped ones
+	beginChunk(M_SUBMESH_NAME_TABLE);
+	beginChunk(M_SUBMESH_NAME_TABLE_ELEMENT);
+	putShort(0);
+	putString(material);
+	endChunk();
+	endChunk();
+
+	endChunk();
+	return buffer;
+}
+
+bool MeshWriter::write(const XML_Mesh& mesh, const std::string& filename, const std::string& material)
+{
+	encode(mesh, material);
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+	return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Writes an XML_Mesh as Ogre's binary .mesh, in the [MeshSerializer_v1.8]
+// chunks OgreXMLConverter made of the shipped assets: shared geometry with
+// interleaved position, normal and texcoord, one triangle list submesh on it
+// with its material, the bounds and the submesh name table. No converter and
+// no Ogre root are needed, the file is built in memory and written at once.
+// The buffer is kept between meshes.
+class MeshWriter {
+public:
+	// Vertices without a normal or texcoord get zeroes. Indices are 16 bit
+	// when they fit. False when the file cannot be written.
+	bool write(const XML_Mesh& mesh, const std::string& filename, const std::string& material);
+
+	// The file write() saves, for callers that store it elsewhere
+	const std::vector<unsigned char>& encode(const XML_Mesh& mesh, const std::string& material);
+
+private:
+	std::vector<unsigned char> buffer;
+	// Where the length of every open chunk goes
+	std::vector<size_t> open;
+
+	void put(const void* data, size_t bytes);
+	void putShort(unsigned short v);
+	void putInt(unsigned int v);
+	void putFloat(float v);
+	void putBool(bool v);
+	void putString(const std::string& s);
+	void beginChunk(unsigned short id);
+	void endChunk();
+};
@@ -0,0 +1,349 @@
+#include "MeshXmlReader.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Grows when a single tag does not fit, which no mesh file gets near
+static const size_t BLOCK_SIZE = 64 * 1024;
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool named(const char* name, size_t length, const char* expected)
+{
+	return strlen(expected) == length && memcmp(name, expected, length) == 0;
+}
+
+// Steps to the next name="value" pair of a tag, false when there is none
+static bool nextAttribute(const char*& p, const char* end, const char*& name, size_t& nameLength, const char*& value)
+{
+	while (p < end && isSpace(*p))
+		++p;
+	name = p;
+	while (p < end && *p != '=' && !isSpace(*p) && *p != '/')
+		++p;
+	nameLength = p - name;
+	while (p < end && isSpace(*p))
+		++p;
+	if (nameLength == 0 || p >= end || *p != '=')
+		return false;
+	++p;
+	while (p < end && isSpace(*p))
+		++p;
+	if (p >= end || (*p != '"' && *p != '\''))
+		return false;
+	char quote = *p++;
+	value = p;
+	while (p < end && *p != quote)
+		++p;
+	if (p >= end)
+		return false;
+	++p;
+	return true;
+}
+
+// End of the tag starting at p, the '>' of it, NULL when the buffer ends first
+static const char* tagEnd(const char* p, const char* end)
+{
+	// Too short yet to tell a comment or CDATA from a plain tag
+	if (p + 1 < end && p[1] == '!' && end - p < 9)
+		return NULL;
+	if (end - p >= 4 && memcmp(p, "<!--", 4) == 0)
+	{
+		for (const char* c = p + 4; c + 2 < end; ++c)
+			if (c[0] == '-' && c[1] == '-' && c[2] == '>')
+				return c + 2;
+		return NULL;
+	}
+	if (end - p >= 9 && memcmp(p, "<![CDATA[", 9) == 0)
+	{
+		for (const char* c = p + 9; c + 2 < end; ++c)
+			if (c[0] == ']' && c[1] == ']' && c[2] == '>')
+				return c + 2;
+		return NULL;
+	}
+	char quote = 0;
+	for (const char* c = p + 1; c < end; ++c)
+	{
+		if (quote)
+			quote = *c == quote ? 0 : quote;
+		else if (*c == '"' || *c == '\'')
+			quote = *c;
+		else if (*c == '>')
+			return c;
+	}
+	return NULL;
+}
+
+MeshXmlReader::MeshXmlReader() :
+	depth(0), nextVertex(0), vertex(-1), texcoordSets(0), sharedBuffer(false), sharedFaces(false),
+	hasNormals(false), hasTexcoords(false)
+{
+}
+
+const std::string& MeshXmlReader::getError() const
+{
+	return error;
+}
+
+bool MeshXmlReader::read(const std::string& filename, XML_Mesh& mesh)
+{
+	mesh.verts.clear();
+	mesh.normals.clear();
+	mesh.texcoords.clear();
+	mesh.faces.clear();
+	mesh.chunks.clear();
+	mesh.chunkVerts.clear();
+
+	depth = 0;
+	nextVertex = 0;
+	vertex = -1;
+	texcoordSets = 0;
+	sharedBuffer = false;
+	sharedFaces = false;
+	hasNormals = false;
+	hasTexcoords = false;
+	error.clear();
+
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		error = "cannot open file";
+		return false;
+	}
+
+	if (buffer.size() < BLOCK_SIZE)
+		buffer.resize(BLOCK_SIZE);
+	size_t begin = 0;
+	size_t end = 0;
+	bool eof = false;
+	bool ok = true;
+	while (ok)
+	{
+		char* data = &buffer[0];
+		const char* open = (const char*)memchr(data + begin, '<', end - begin);
+		const char* close = open ? tagEnd(open, data + end) : NULL;
+		if (!close)
+		{
+			if (eof)
+			{
+				if (open)
+				{
+					error = "unterminated tag";
+					ok = false;
+				}
+				break;
+			}
+			// Keep the partial tag and read the next block behind it
+			begin = open ? open - data : end;
+			memmove(data, data + begin, end - begin);
+			end -= begin;
+			begin = 0;
+			if (end == buffer.size())
+				buffer.resize(buffer.size() * 2);
+			size_t n = fread(&buffer[end], 1, buffer.size() - end, file);
+			end += n;
+			eof = n == 0;
+			continue;
+		}
+
+		ok = tag(open + 1, close, mesh);
+		begin = close + 1 - data;
+	}
+	fclose(file);
+
+	if (ok && depth != 0)
+	{
+		error = "unclosed element";
+		ok = false;
+	}
+
+	int count = (int)mesh.verts.size();
+	for (size_t i = 0; ok && i < mesh.faces.size(); ++i)
+	{
+		const vec3i& f = mesh.faces[i];
+		if (f.x < 0 || f.y < 0 || f.z < 0 || f.x >= count || f.y >= count || f.z >= count)
+		{
+			error = "face index out of range";
+			ok = false;
+		}
+	}
+
+	if (!hasNormals)
+		mesh.normals.clear();
+	if (!hasTexcoords)
+		mesh.texcoords.clear();
+	return ok;
+}
+
+bool MeshXmlReader::tag(const char* begin, const char* end, XML_Mesh& mesh)
+{
+	// Declarations, comments and CDATA carry nothing a mesh needs
+	if (*begin == '?' || *begin == '!')
+		return true;
+
+	if (*begin != '/')
+		return startTag(begin, end, mesh);
+
+	if (depth == 0)
+	{
+		error = "end tag without a start";
+		return false;
+	}
+	Element closed = stack[--depth];
+	if (closed == VERTEX)
+		vertex = -1;
+	else if (closed == VERTEXBUFFER)
+		sharedBuffer = false;
+	else if (closed == SUBMESH)
+		sharedFaces = false;
+	return true;
+}
+
+bool MeshXmlReader::startTag(const char* begin, const char* end, XML_Mesh& mesh)
+{
+	bool selfClosing = end[-1] == '/';
+	if (selfClosing)
+		--end;
+
+	const char* p = begin;
+	while (p < end && !isSpace(*p))
+		++p;
+	const char* name = begin;
+	size_t length = p - begin;
+	Element parent = depth > 0 ? stack[depth - 1] : OTHER;
+
+	Element element = OTHER;
+	if (named(name, length, "sharedgeometry"))
+	{
+		element = SHAREDGEOMETRY;
+		const char* attr;
+		size_t attrLength;
+		const char* value;
+		while (nextAttribute(p, end, attr, attrLength, value))
+		{
+			int count;
+			if (named(attr, attrLength, "vertexcount") && XMLUtil::ParseInt(value, &count) && count > 0)
+			{
+				mesh.verts.reserve(count);
+				mesh.normals.reserve(count);
+				mesh.texcoords.reserve(count);
+			}
+		}
+	}
+	else if (named(name, length, "vertexbuffer"))
+	{
+		element = VERTEXBUFFER;
+		sharedBuffer = parent == SHAREDGEOMETRY;
+		nextVertex = 0;
+	}
+	else if (named(name, length, "vertex"))
+	{
+		element = VERTEX;
+		if (parent == VERTEXBUFFER && sharedBuffer)
+		{
+			vertex = nextVertex++;
+			texcoordSets = 0;
+			if (vertex >= (int)mesh.verts.size())
+			{
+				mesh.verts.resize(vertex + 1);
+				mesh.normals.resize(vertex + 1);
+				mesh.texcoords.resize(vertex + 1);
+			}
+		}
+	}
+	else if (named(name, length, "position") || named(name, length, "normal"))
+	{
+		bool position = name[0] == 'p';
+		element = position ? POSITION : NORMAL;
+		if (parent == VERTEX && vertex >= 0)
+		{
+			vec3f& v = position ? mesh.verts[vertex] : mesh.normals[vertex];
+			hasNormals |= !position;
+			const char* attr;
+			size_t attrLength;
+			const char* value;
+			while (nextAttribute(p, end, attr, attrLength, value))
+			{
+				if (attrLength != 1)
+					continue;
+				float* axis = attr[0] == 'x' ? &v.x : attr[0] == 'y' ? &v.y : attr[0] == 'z' ? &v.z : NULL;
+				if (axis && !XMLUtil::ParseFloat(value, axis))
+				{
+					error = "bad number";
+					return false;
+				}
+			}
+		}
+	}
+	else if (named(name, length, "texcoord"))
+	{
+		element = TEXCOORD;
+		if (parent == VERTEX && vertex >= 0 && texcoordSets++ == 0)
+		{
+			vec2f& t = mesh.texcoords[vertex];
+			hasTexcoords = true;
+			const char* attr;
+			size_t attrLength;
+			const char* value;
+			while (nextAttribute(p, end, attr, attrLength, value))
+			{
+				if (attrLength != 1)
+					continue;
+				float* axis = attr[0] == 'u' ? &t.u : attr[0] == 'v' ? &t.v : NULL;
+				if (axis && !XMLUtil::ParseFloat(value, axis))
+				{
+					error = "bad number";
+					return false;
+				}
+			}
+		}
+	}
+	else if (named(name, length, "submesh"))
+	{
+		element = SUBMESH;
+		sharedFaces = true;
+		const char* attr;
+		size_t attrLength;
+		const char* value;
+		while (nextAttribute(p, end, attr, attrLength, value))
+			if (named(attr, attrLength, "usesharedvertices"))
+				sharedFaces = strncmp(value, "false", 5) != 0;
+	}
+	else if (named(name, length, "faces"))
+		element = FACES;
+	else if (named(name, length, "face"))
+	{
+		element = FACE;
+		if (parent == FACES && sharedFaces)
+		{
+			int v[3] = { 0, 0, 0 };
+			const char* attr;
+			size_t attrLength;
+			const char* value;
+			while (nextAttribute(p, end, attr, attrLength, value))
+			{
+				if (attrLength != 2 || attr[0] != 'v' || attr[1] < '1' || attr[1] > '3')
+					continue;
+				if (!XMLUtil::ParseInt(value, &v[attr[1] - '1']))
+				{
+					error = "bad index";
+					return false;
+				}
+			}
+			mesh.faces.push_back(vec3i(v[0], v[1], v[2]));
+		}
+	}
+
+	if (selfClosing)
+		return true;
+	if (depth == MAX_DEPTH)
+	{
+		error = "elements nested too deep";
+		return false;
+	}
+	stack[depth++] = element;
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// Pull parser for Ogre's .mesh.xml. The file is read in fixed size blocks
+// and every tag is handled as soon as it is complete, so vertices and faces
+// go straight into the mesh without a DOM, and nothing is allocated per node.
+// Reads the shared geometry, every vertex buffer of it, and the faces of
+// every submesh that uses it; the first texcoord set is kept.
+class MeshXmlReader {
+public:
+	MeshXmlReader();
+
+	// Replaces mesh's verts, normals, texcoords and faces. Normals and
+	// texcoords stay empty when the file has none. False when the file is
+	// missing or malformed, with the reason in getError().
+	bool read(const std::string& filename, XML_Mesh& mesh);
+
+	const std::string& getError() const;
+
+private:
+	enum Element {
+		OTHER,
+		SHAREDGEOMETRY,
+		VERTEXBUFFER,
+		VERTEX,
+		POSITION,
+		NORMAL,
+		TEXCOORD,
+		SUBMESH,
+		FACES,
+		FACE
+	};
+
+	static const int MAX_DEPTH = 32;
+
+	std::vector<char> buffer;
+	Element stack[MAX_DEPTH];
+	int depth;
+	// Vertex the next one in the current shared buffer is, and the one being
+	// read, -1 outside a shared vertex
+	int nextVertex;
+	int vertex;
+	int texcoordSets;
+	bool sharedBuffer;
+	bool sharedFaces;
+	bool hasNormals;
+	bool hasTexcoords;
+	std::string error;
+
+	bool tag(const char* begin, const char* end, XML_Mesh& mesh);
+	bool startTag(const char* begin, const char* end, XML_Mesh& mesh);
+};
@@ -3,6 +3,7 @@
 OgreMotionState::OgreMotionState(const btTransform &initialpos, Ogre::SceneNode* node) {
 	mVisibleobj = node;
 	mPos1 = initialpos;
+	mCenterOfMassOffset.setIdentity();
 }
 
 OgreMotionState::~OgreMotionState() {}
@@ -12,6 +13,10 @@ void OgreMotionState::setNode(Ogre::SceneNode* node) {
 	mVisibleobj = node;
 } 
 
+void OgreMotionState::setCenterOfMassOffset(const btTransform& offset) {
+	mCenterOfMassOffset = offset;
+}
+
 void OgreMotionState::getWorldTransform(btTransform &worldTrans) const {
 	worldTrans = mPos1;
 }
@@ -25,8 +30,9 @@ void OgreMotionState::setWorldTransform(const btTransform &worldTrans) {
 	if (mVisibleobj == nullptr)
 		return; // silently return before we set a node
 
-		btQuaternion rot = worldTrans.getRotation();
+		btTransform nodeTrans = worldTrans * mCenterOfMassOffset.inverse();
+		btQuaternion rot = nodeTrans.getRotation();
 		mVisibleobj->setOrientation(rot.w(), rot.x(), rot.y(), rot.z());
-		btVector3 pos = worldTrans.getOrigin();
+		btVector3 pos = nodeTrans.getOrigin();
 		mVisibleobj->setPosition(pos.x(), pos.y(), pos.z());
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ class OgreMotionState : public btMotionState {
 protected:
 	Ogre::SceneNode* mVisibleobj;
 	btTransform mPos1;
+	btTransform mCenterOfMassOffset;
 public:
 	OgreMotionState(const btTransform &initialpos, Ogre::SceneNode* node);
 
@@ -16,6 +17,9 @@ public:
  	//Provides flexibility in terms of object visibility
 	void setNode(Ogre::SceneNode* node);
 
+	// Body frame relative to the node's, for bodies centred on their centre of mass
+	void setCenterOfMassOffset(const btTransform& offset);
+
 	virtual void getWorldTransform(btTransform &worldTrans) const;
 
 	virtual void setWorldTransform(const btTransform &worldTrans);	
@@ -0,0 +1,292 @@
+#include "QuantizedMesh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static const float POSITION_STEPS = 65535.0f;
+static const float NORMAL_STEPS = 127.0f;
+// Worst angle an 8 bit octahedral normal is off by once the best of its four
+// neighbouring codes is picked, measured over a dense sphere and rounded up
+static const float NORMAL_BOUND_DEGREES = 0.7f;
+// Half floats keep 11 significant bits, rounding is off by half the last one
+static const float HALF_RELATIVE_ERROR = 1.0f / 2048.0f;
+// Half the step of the smallest subnormal half, 2^-25
+static const float HALF_ABSOLUTE_ERROR = 2.98023224e-8f;
+
+static unsigned short floatToHalf(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	unsigned short sign = (unsigned short)((bits >> 16) & 0x8000);
+	unsigned int magnitude = bits & 0x7fffffff;
+
+	// Everything that would round to infinity, NaN included, clamps to 65504
+	if (magnitude >= 0x477ff000)
+		return sign | 0x7bff;
+	// Below 2^-14 the half is subnormal, a plain multiple of 2^-24
+	if (magnitude < 0x38800000)
+	{
+		float a;
+		memcpy(&a, &magnitude, sizeof(a));
+		return sign | (unsigned short)lrintf(a * 16777216.0f);
+	}
+	// Rebias the exponent and round the mantissa to nearest even
+	unsigned int h = magnitude - 0x38000000;
+	h += 0xfff + ((h >> 13) & 1);
+	return sign | (unsigned short)(h >> 13);
+}
+
+static float halfToFloat(unsigned short h)
+{
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int exponent = (h >> 10) & 0x1f;
+	unsigned int mantissa = h & 0x3ff;
+	if (exponent == 0)
+	{
+		float f = mantissa / 16777216.0f;
+		return sign ? -f : f;
+	}
+	unsigned int bits = sign | (exponent == 31 ? 0x7f800000 | mantissa << 13 : (exponent + 112) << 23 | mantissa << 13);
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline float signNotZero(float v)
+{
+	return v < 0.0f ? -1.0f : 1.0f;
+}
+
+static vec3f decodeOctahedral(signed char ex, signed char ey)
+{
+	float x = ex / NORMAL_STEPS;
+	float y = ey / NORMAL_STEPS;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * signNotZero(x);
+		float fy = (1.0f - fabsf(x)) * signNotZero(y);
+		x = fx;
+		y = fy;
+	}
+	float l = sqrtf(x*x + y*y + z*z);
+	return vec3f(x / l, y / l, z / l);
+}
+
+// Projects onto the octahedron, folds the lower half over and keeps whichever
+// of the four codes around the projection decodes closest to n
+static void encodeOctahedral(const vec3f& n, signed char out[2])
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (l1 <= 0.0f)
+	{
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if (n.z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * signNotZero(x);
+		float fy = (1.0f - fabsf(x)) * signNotZero(y);
+		x = fx;
+		y = fy;
+	}
+
+	float bx = floorf(x * NORMAL_STEPS);
+	float by = floorf(y * NORMAL_STEPS);
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		float cx = std::min(std::max(bx + (i & 1), -NORMAL_STEPS), NORMAL_STEPS);
+		float cy = std::min(std::max(by + (i >> 1), -NORMAL_STEPS), NORMAL_STEPS);
+		vec3f d = decodeOctahedral((signed char)cx, (signed char)cy);
+		float dot = d.x*n.x + d.y*n.y + d.z*n.z;
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			out[0] = (signed char)cx;
+			out[1] = (signed char)cy;
+		}
+	}
+}
+
+QuantizedMesh::QuantizedMesh() :
+	min(0.0f), max(0.0f), normals(false), texcoords(false)
+{
+}
+
+vec3f QuantizedMesh::position(int vertex) const
+{
+	const unsigned short* q = verts[vertex].position;
+	return vec3f(min.x + q[0] * ((max.x - min.x) / POSITION_STEPS),
+		min.y + q[1] * ((max.y - min.y) / POSITION_STEPS),
+		min.z + q[2] * ((max.z - min.z) / POSITION_STEPS));
+}
+
+vec3f QuantizedMesh::normal(int vertex) const
+{
+	if (!normals)
+		return vec3f(0.0f);
+	return decodeOctahedral(verts[vertex].normal[0], verts[vertex].normal[1]);
+}
+
+vec2f QuantizedMesh::texcoord(int vertex) const
+{
+	if (!texcoords)
+		return vec2f(0.0f);
+	return vec2f(halfToFloat(verts[vertex].texcoord[0]), halfToFloat(verts[vertex].texcoord[1]));
+}
+
+size_t QuantizedMesh::bytes() const
+{
+	size_t index = verts.size() <= 65536 ? 2 : 4;
+	return verts.size() * sizeof(QuantizedVertex) + faces.size() * 3 * index;
+}
+
+static unsigned short quantizePosition(float p, float lo, float hi)
+{
+	if (hi <= lo)
+		return 0;
+	float q = floorf((p - lo) * (POSITION_STEPS / (hi - lo)) + 0.5f);
+	return (unsigned short)std::min(std::max(q, 0.0f), POSITION_STEPS);
+}
+
+void quantizeMesh(const XML_Mesh& mesh, QuantizedMesh& out)
+{
+	size_t count = mesh.verts.size();
+	out.normals = !mesh.normals.empty() && mesh.normals.size() == count;
+	out.texcoords = !mesh.texcoords.empty() && mesh.texcoords.size() == count;
+	out.faces = mesh.faces;
+	out.verts.resize(count);
+	if (count == 0)
+	{
+		out.min = out.max = vec3f(0.0f);
+		return;
+	}
+
+	vec3f lo = mesh.verts[0], hi = mesh.verts[0];
+	for (size_t i = 1; i < count; ++i)
+	{
+		const vec3f& p = mesh.verts[i];
+		lo = vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	out.min = lo;
+	out.max = hi;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		QuantizedVertex& v = out.verts[i];
+		const vec3f& p = mesh.verts[i];
+		v.position[0] = quantizePosition(p.x, lo.x, hi.x);
+		v.position[1] = quantizePosition(p.y, lo.y, hi.y);
+		v.position[2] = quantizePosition(p.z, lo.z, hi.z);
+
+		if (out.normals)
+			encodeOctahedral(mesh.normals[i], v.normal);
+		else
+			v.normal[0] = v.normal[1] = 0;
+
+		if (out.texcoords)
+		{
+			v.texcoord[0] = floatToHalf(mesh.texcoords[i].u);
+			v.texcoord[1] = floatToHalf(mesh.texcoords[i].v);
+		}
+		else
+			v.texcoord[0] = v.texcoord[1] = 0;
+	}
+}
+
+void dequantizeMesh(const QuantizedMesh& mesh, XML_Mesh& out)
+{
+	int count = (int)mesh.verts.size();
+	out.verts.resize(count);
+	out.normals.resize(mesh.normals ? count : 0);
+	out.texcoords.resize(mesh.texcoords ? count : 0);
+	for (int i = 0; i < count; ++i)
+	{
+		out.verts[i] = mesh.position(i);
+		if (mesh.normals)
+			out.normals[i] = mesh.normal(i);
+		if (mesh.texcoords)
+			out.texcoords[i] = mesh.texcoord(i);
+	}
+	out.faces = mesh.faces;
+	out.chunks.clear();
+	out.chunkVerts.clear();
+}
+
+QuantizationError quantizationBound(const QuantizedMesh& mesh)
+{
+	QuantizationError bound;
+
+	// Half a step per axis, plus what the float decode itself rounds off
+	float sx = (mesh.max.x - mesh.min.x) / POSITION_STEPS;
+	float sy = (mesh.max.y - mesh.min.y) / POSITION_STEPS;
+	float sz = (mesh.max.z - mesh.min.z) / POSITION_STEPS;
+	float mx = std::max(fabsf(mesh.min.x), fabsf(mesh.max.x));
+	float my = std::max(fabsf(mesh.min.y), fabsf(mesh.max.y));
+	float mz = std::max(fabsf(mesh.min.z), fabsf(mesh.max.z));
+	bound.position = 0.5f * sqrtf(sx*sx + sy*sy + sz*sz) + 4.0f * FLT_EPSILON * sqrtf(mx*mx + my*my + mz*mz);
+
+	bound.normalDegrees = mesh.normals ? NORMAL_BOUND_DEGREES : 0.0f;
+
+	// Relative to the magnitude, which the decoded value never rounds below
+	// the power of two of
+	float mu = 0.0f, mv = 0.0f;
+	if (mesh.texcoords)
+	{
+		for (size_t i = 0; i < mesh.verts.size(); ++i)
+		{
+			vec2f t = mesh.texcoord((int)i);
+			mu = std::max(mu, fabsf(t.u));
+			mv = std::max(mv, fabsf(t.v));
+		}
+	}
+	float bu = mu * HALF_RELATIVE_ERROR + HALF_ABSOLUTE_ERROR;
+	float bv = mv * HALF_RELATIVE_ERROR + HALF_ABSOLUTE_ERROR;
+	bound.texcoord = mesh.texcoords ? sqrtf(bu*bu + bv*bv) : 0.0f;
+	return bound;
+}
+
+QuantizationError measureQuantizationError(const XML_Mesh& mesh, const QuantizedMesh& packed)
+{
+	QuantizationError error;
+	error.position = 0.0f;
+	error.normalDegrees = 0.0f;
+	error.texcoord = 0.0f;
+
+	float worstDot = 1.0f;
+	size_t count = std::min(mesh.verts.size(), packed.verts.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		vec3f p = packed.position((int)i);
+		const vec3f& s = mesh.verts[i];
+		float dx = p.x - s.x, dy = p.y - s.y, dz = p.z - s.z;
+		error.position = std::max(error.position, sqrtf(dx*dx + dy*dy + dz*dz));
+
+		if (packed.normals)
+		{
+			const vec3f& n = mesh.normals[i];
+			float l = sqrtf(n.x*n.x + n.y*n.y + n.z*n.z);
+			if (l > 0.0f)
+			{
+				vec3f d = packed.normal((int)i);
+				worstDot = std::min(worstDot, (d.x*n.x + d.y*n.y + d.z*n.z) / l);
+			}
+		}
+
+		if (packed.texcoords)
+		{
+			vec2f t = packed.texcoord((int)i);
+			float du = t.u - mesh.texcoords[i].u, dv = t.v - mesh.texcoords[i].v;
+			error.texcoord = std::max(error.texcoord, sqrtf(du*du + dv*dv));
+		}
+	}
+	error.normalDegrees = acosf(std::min(std::max(worstDot, -1.0f), 1.0f)) * (180.0f / 3.14159265f);
+	return error;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshSlicer.h"
+
+// 12 bytes against the 32 of three float attributes. Positions are 16 bit
+// fractions of the mesh's bounds, normals are octahedral with 8 bits per
+// axis and texcoords are half floats.
+struct QuantizedVertex
+{
+	unsigned short position[3];
+	signed char normal[2];
+	unsigned short texcoord[2];
+};
+
+// A mesh in the compact debris format. Bounds are the float ones of the
+// source, so decoding puts the corners of the box back exactly.
+struct QuantizedMesh
+{
+	vec3f min;
+	vec3f max;
+	std::vector<QuantizedVertex> verts;
+	std::vector<vec3i> faces;
+	// Attributes the source had, the others decode as zero
+	bool normals;
+	bool texcoords;
+
+	QuantizedMesh();
+
+	vec3f position(int vertex) const;
+	vec3f normal(int vertex) const;
+	vec2f texcoord(int vertex) const;
+
+	// Vertex and index data, what the mesh costs to keep around
+	size_t bytes() const;
+};
+
+// Largest distance between a source attribute and its decoded copy. The
+// normal is the angle between the two, in degrees.
+struct QuantizationError
+{
+	float position;
+	float normalDegrees;
+	float texcoord;
+};
+
+void quantizeMesh(const XML_Mesh& mesh, QuantizedMesh& out);
+void dequantizeMesh(const QuantizedMesh& mesh, XML_Mesh& out);
+
+// What the encoding guarantees for this mesh. Half floats only hold texcoords
+// up to 65504, larger ones are clamped and fall outside the bound.
+QuantizationError quantizationBound(const QuantizedMesh& mesh);
+// What the encoding actually lost, mesh must be the one packed was made from
+QuantizationError measureQuantizationError(const XML_Mesh& mesh, const QuantizedMesh& packed);
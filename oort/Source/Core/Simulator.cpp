@@ -25,6 +25,14 @@ bool Simulator::removeObject(GameObject* o) {
 	dynamicsWorld->removeRigidBody(o->getBody());
 }
 
+void Simulator::addBody(btRigidBody* body, short group, short mask) {
+	dynamicsWorld->addRigidBody(body, group, mask);
+}
+
+void Simulator::removeBody(btRigidBody* body) {
+	dynamicsWorld->removeRigidBody(body);
+}
+
 //Update the physics world state and any objects that have collision
 void Simulator::stepSimulation(const Ogre::Real elapsedTime, int maxSubSteps, const Ogre::Real fixedTimestep) {
 	dynamicsWorld->stepSimulation(elapsedTime, maxSubSteps, fixedTimestep);
@@ -30,5 +30,9 @@ public:
 
        void addObject(GameObject* o); 
        bool removeObject(GameObject* o); 
+       // Bodies with no GameObject behind them, like debris. Their filter must
+       // keep them out of the game objects' contact tests.
+       void addBody(btRigidBody* body, short group, short mask);
+       void removeBody(btRigidBody* body);
        void stepSimulation(const Ogre::Real elapsedTime, int maxSubSteps = 1, const Ogre::Real fixedTimestep = 1.0f/60.0f); 
 };
@@ -0,0 +1,75 @@
+#include "SliceArena.h"
+
+#include <algorithm>
+
+SliceArena::SliceArena(size_t initialBytes) :
+	block(NULL), size(0), offset(0), spilledBytes(0), allocations(0)
+{
+	// Growing past 32 blocks in one round would take a 2^32 times larger slice
+	spilled.reserve(32);
+	if (initialBytes > 0)
+	{
+		block = new char[initialBytes];
+		size = initialBytes;
+		allocations++;
+	}
+}
+
+SliceArena::~SliceArena()
+{
+	for (size_t i = 0; i < spilled.size(); ++i)
+		delete[] spilled[i];
+	delete[] block;
+}
+
+void* SliceArena::allocate(size_t bytes, size_t align)
+{
+	size_t start = (offset + align - 1) & ~(align - 1);
+	if (!block || start + bytes > size)
+	{
+		if (block)
+		{
+			spilled.push_back(block);
+			spilledBytes += size;
+		}
+		size = std::max(size * 2, bytes + align);
+		block = new char[size];
+		allocations++;
+		start = 0;
+	}
+	offset = start + bytes;
+	return block + start;
+}
+
+void SliceArena::reset()
+{
+	if (!spilled.empty())
+	{
+		for (size_t i = 0; i < spilled.size(); ++i)
+			delete[] spilled[i];
+		spilled.clear();
+
+		// One block that would have held the whole round
+		delete[] block;
+		size += spilledBytes;
+		block = new char[size];
+		allocations++;
+		spilledBytes = 0;
+	}
+	offset = 0;
+}
+
+size_t SliceArena::used() const
+{
+	return spilledBytes + offset;
+}
+
+size_t SliceArena::capacity() const
+{
+	return spilledBytes + size;
+}
+
+size_t SliceArena::heapAllocations() const
+{
+	return allocations;
+}
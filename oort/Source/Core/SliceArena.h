@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Bump allocator the slicer writes its outputs into. reset() hands the whole
+// block back at once; if a slice overflowed it, the overflow blocks are merged
+// into one block big enough for that slice, so the next one of the same size
+// makes no heap allocation at all. Only for trivially copyable types.
+class SliceArena {
+public:
+	SliceArena(size_t initialBytes = 0);
+	~SliceArena();
+
+	template <class T>
+	T* alloc(size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Frees everything allocated since the last reset
+	void reset();
+
+	size_t used() const;
+	size_t capacity() const;
+	// Blocks taken from the heap since construction
+	size_t heapAllocations() const;
+
+private:
+	char* block;
+	size_t size;
+	size_t offset;
+	// Full blocks of the current round, released on reset
+	std::vector<char*> spilled;
+	size_t spilledBytes;
+	size_t allocations;
+
+	void* allocate(size_t bytes, size_t align);
+
+	SliceArena(const SliceArena&);
+	SliceArena& operator=(const SliceArena&);
+};
@@ -1,4 +1,5 @@
 #include "SoundManager.h"
+#include "Log.h"
 
 SoundManager::SoundManager(void) {
 
@@ -15,13 +16,13 @@ SoundManager::SoundManager(void) {
 
 	/* Initialize all SDL subsystems */
 	if( SDL_Init( SDL_INIT_EVERYTHING ) == -1 ) {
-		printf( "SDL not initialized! SDL Error: %s\n", Mix_GetError() );
+		LOG_ERROR(LOG_AUDIO, "SDL not initialized! SDL Error: " << Mix_GetError());
 		success = false;
 	}
 
  	/* Initialize SDL_mixer */
 	if( Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048 ) < 0 ) {
-		printf( "SDL_mixer not initialized! SDL_mixer Error: %s\n", Mix_GetError() );
+		LOG_ERROR(LOG_AUDIO, "SDL_mixer not initialized! SDL_mixer Error: " << Mix_GetError());
 		success = false;
 	}
 
@@ -0,0 +1,78 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads) :
+	current(NULL), jobCount(0), nextJob(0), busy(0), generation(0), quit(false)
+{
+	for (int i = 1; i < threads; ++i)
+		workers.push_back(std::thread(&WorkerPool::work, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+}
+
+int WorkerPool::size() const
+{
+	return (int)workers.size() + 1;
+}
+
+void WorkerPool::run(int count, const std::function<void(int)>& job)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (int i = 0; i < count; ++i)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		current = &job;
+		jobCount = count;
+		nextJob = 0;
+		busy = (int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	drain();
+
+	// Every worker checks out before job goes out of scope
+	std::unique_lock<std::mutex> guard(lock);
+	done.wait(guard, [this] { return busy == 0; });
+	current = NULL;
+}
+
+void WorkerPool::drain()
+{
+	for (int i = nextJob++; i < jobCount; i = nextJob++)
+		(*current)(i);
+}
+
+void WorkerPool::work()
+{
+	unsigned int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this, seen] { return quit || generation != seen; });
+			if (quit)
+				return;
+			seen = generation;
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (--busy == 0)
+			done.notify_one();
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for data parallel loops. run() hands out job indices
+// to the workers and the calling thread, and returns once all of them ran.
+class WorkerPool {
+public:
+	// threads counts the caller, so WorkerPool(1) never starts a thread
+	WorkerPool(int threads);
+	~WorkerPool();
+
+	int size() const;
+	void run(int count, const std::function<void(int)>& job);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(int)>* current;
+	int jobCount;
+	std::atomic<int> nextJob;
+	int busy;
+	unsigned int generation;
+	bool quit;
+
+	void work();
+	void drain();
+};
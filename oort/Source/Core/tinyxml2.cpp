@@ -27,9 +27,15 @@ distribution.
 #if defined(ANDROID_NDK) || defined(__BORLANDC__) || defined(__QNXNTO__)
 #   include <stddef.h>
 #   include <stdarg.h>
+#   include <locale.h>
+#   include <float.h>
+#   include <math.h>
 #else
 #   include <cstddef>
 #   include <cstdarg>
+#   include <clocale>
+#   include <cfloat>
+#   include <cmath>
 #endif
 
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 ) && (!defined WINCE)
@@ -556,20 +562,442 @@ void XMLUtil::ToStr( double v, char* buffer, int bufferSize )
 }
 
 
-bool XMLUtil::ToInt( const char* str, int* value )
+/*
+	Number parsing. sscanf is slow and reads the decimal point of the C locale,
+	so under a locale that writes "1,5" an attribute of "1.5" comes back as 1.
+	The parsers below read the decimal format XML files are written in, with
+	whatever locale the program runs under.
+
+	A decimal of at most 19 significant digits is read into one integer w and
+	a power of ten q. When w fits in a double's 53 bits and q is at most 22,
+	both are exact doubles and one multiply or divide gives the correctly
+	rounded result (Clinger's fast path), which covers the six decimals of
+	mesh files. Longer mantissas, as ToStr writes doubles, go through
+	Eisel-Lemire: w times a 128 bit truncation of 5^q, where the bits below
+	the mantissa show whether the truncation could have changed the rounding.
+	It almost never could; when it could, or q is beyond the table, strtod
+	with the locale's decimal point finishes the job, which rounds correctly
+	too.
+*/
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER = 22;
+static const unsigned long long MAX_EXACT_MANTISSA = 1ULL << 53;
+static const int MAX_MANTISSA_DIGITS = 19;
+
+// 5^q for q in [-64, 64], normalized to 128 bits, high word first. Positive
+// powers are truncated, negative ones rounded up, as Eisel-Lemire expects.
+// Generated, see Lemire, "Number Parsing at a Gigabyte per Second".
+static const int MIN_TABLE_POWER = -64;
+static const int MAX_TABLE_POWER = 64;
+static const unsigned long long POWERS_OF_FIVE[] = {
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL, 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, 0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL, 0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL, 0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL, 0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL, 0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL, 0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL, 0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL, 0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL, 0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL, 0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL, 0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL, 0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL, 0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL, 0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, 0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL, 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL
+};
+
+struct Decimal {
+    const char* end;
+    bool negative;
+    unsigned long long mantissa;
+    int exponent;
+    // Nonzero digits past the 19th were dropped
+    bool truncated;
+};
+
+static inline bool IsDecimalDigit( char c )
 {
-    if ( TIXML_SSCANF( str, "%d", value ) == 1 ) {
-        return true;
+    return c >= '0' && c <= '9';
+}
+
+// Sign, digits, optional fraction and exponent. False when there are no digits.
+static bool ScanDecimal( const char* p, Decimal* d )
+{
+    d->negative = ( *p == '-' );
+    if ( *p == '-' || *p == '+' ) {
+        ++p;
     }
-    return false;
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool any = false;
+    for( ; IsDecimalDigit( *p ); ++p ) {
+        any = true;
+        if ( digits < MAX_MANTISSA_DIGITS ) {
+            mantissa = mantissa * 10 + ( *p - '0' );
+            digits += ( mantissa != 0 );
+        }
+        else {
+            ++exponent;
+            truncated |= ( *p != '0' );
+        }
+    }
+    if ( *p == '.' ) {
+        for( ++p; IsDecimalDigit( *p ); ++p ) {
+            any = true;
+            if ( digits < MAX_MANTISSA_DIGITS ) {
+                mantissa = mantissa * 10 + ( *p - '0' );
+                digits += ( mantissa != 0 );
+                --exponent;
+            }
+            else {
+                truncated |= ( *p != '0' );
+            }
+        }
+    }
+    if ( !any ) {
+        return false;
+    }
+    if ( *p == 'e' || *p == 'E' ) {
+        const char* e = p + 1;
+        const bool negativeExponent = ( *e == '-' );
+        if ( *e == '-' || *e == '+' ) {
+            ++e;
+        }
+        if ( IsDecimalDigit( *e ) ) {
+            // Anything past 100000 is an infinity or a zero anyway
+            int value = 0;
+            for( ; IsDecimalDigit( *e ); ++e ) {
+                value = ( value < 100000 ) ? value * 10 + ( *e - '0' ) : value;
+            }
+            exponent += negativeExponent ? -value : value;
+            p = e;
+        }
+    }
+    d->end = p;
+    d->mantissa = mantissa;
+    d->exponent = exponent;
+    d->truncated = truncated;
+    return true;
 }
 
-bool XMLUtil::ToUnsigned( const char* str, unsigned *value )
+// Full 128 bit product of two 64 bit words
+static void Multiply128( unsigned long long a, unsigned long long b, unsigned long long* high, unsigned long long* low )
+{
+    const unsigned long long aLow = a & 0xffffffffULL;
+    const unsigned long long aHigh = a >> 32;
+    const unsigned long long bLow = b & 0xffffffffULL;
+    const unsigned long long bHigh = b >> 32;
+    const unsigned long long ll = aLow * bLow;
+    const unsigned long long lh = aLow * bHigh;
+    const unsigned long long hl = aHigh * bLow;
+    const unsigned long long middle = ( ll >> 32 ) + ( lh & 0xffffffffULL ) + ( hl & 0xffffffffULL );
+    *low = ( middle << 32 ) | ( ll & 0xffffffffULL );
+    *high = aHigh * bHigh + ( lh >> 32 ) + ( hl >> 32 ) + ( middle >> 32 );
+}
+
+// Eisel-Lemire for a nonzero w. False when q is outside the table, the result
+// would not be a normal double, or the product is too close to a rounding
+// boundary to tell.
+static bool EiselLemire( unsigned long long w, int q, bool negative, double* value )
 {
-    if ( TIXML_SSCANF( str, "%u", value ) == 1 ) {
+    if ( q < MIN_TABLE_POWER || q > MAX_TABLE_POWER ) {
+        return false;
+    }
+    int lz = 0;
+    for( int step = 32; step > 0; step /= 2 ) {
+        if ( ( w >> ( 64 - step ) ) == 0 ) {
+            w <<= step;
+            lz += step;
+        }
+    }
+    const unsigned long long* power = &POWERS_OF_FIVE[2 * ( q - MIN_TABLE_POWER )];
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    Multiply128( w, power[0], &high, &low );
+    // When the 9 bits of the high word under the 55 kept are all ones, the
+    // low word of the power may carry into them
+    if ( ( high & 0x1ff ) == 0x1ff ) {
+        unsigned long long secondHigh = 0;
+        unsigned long long secondLow = 0;
+        Multiply128( w, power[1], &secondHigh, &secondLow );
+        low += secondHigh;
+        if ( secondHigh > low ) {
+            ++high;
+        }
+        if ( ( high & 0x1ff ) == 0x1ff && low == ~0ULL && ( q < -27 || q > 55 ) ) {
+            return false;
+        }
+    }
+    const int upperBit = (int)( high >> 63 );
+    const int shift = upperBit + 9;
+    unsigned long long mantissa = high >> shift;
+    // floor(log2(10^q)) from a fixed point log2(10), where the top bit of the
+    // product landed, and the double's exponent bias
+    int power2 = ( ( ( 152170 + 65536 ) * q ) >> 16 ) + 63 + upperBit - lz + 1023;
+    if ( power2 <= 0 ) {
+        return false;
+    }
+    // Exactly halfway between two doubles, which only happens for small q:
+    // round to even rather than up
+    if ( low <= 1 && q >= -4 && q <= 23 && ( mantissa & 3 ) == 1 && ( mantissa << shift ) == high ) {
+        mantissa &= ~1ULL;
+    }
+    mantissa += ( mantissa & 1 );
+    mantissa >>= 1;
+    if ( mantissa >= ( 2ULL << 52 ) ) {
+        mantissa = 1ULL << 52;
+        ++power2;
+    }
+    if ( power2 >= 2047 ) {
+        return false;
+    }
+    const unsigned long long bits = ( mantissa & ~( 1ULL << 52 ) ) | ( (unsigned long long)power2 << 52 ) | ( negative ? 1ULL << 63 : 0 );
+    memcpy( value, &bits, sizeof( bits ) );
+    return true;
+}
+
+// Correctly rounded without strtod, false when that takes more than this
+static bool FastDouble( const Decimal& d, double* value )
+{
+    unsigned long long mantissa = d.mantissa;
+    int exponent = d.exponent;
+    if ( mantissa == 0 ) {
+        *value = d.negative ? -0.0 : 0.0;
         return true;
     }
-    return false;
+    if ( d.truncated ) {
+        return false;
+    }
+    // 1e30 is 1e8 times 1e22, both exact
+    while ( exponent > MAX_EXACT_POWER && mantissa <= MAX_EXACT_MANTISSA / 10 ) {
+        mantissa *= 10;
+        --exponent;
+    }
+    if ( mantissa > MAX_EXACT_MANTISSA || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER ) {
+        return EiselLemire( d.mantissa, d.exponent, d.negative, value );
+    }
+    double v = (double)mantissa;
+    v = ( exponent < 0 ) ? v / POWERS_OF_TEN[-exponent] : v * POWERS_OF_TEN[exponent];
+    *value = d.negative ? -v : v;
+    return true;
+}
+
+// A correctly rounded double rounded again to a float is correctly rounded
+// too, unless it lies exactly halfway between two floats: the decimal may have
+// been on either side. In the float normal range halfway is the 29 mantissa
+// bits a float drops being a one and then zeros; outside it strtof decides.
+static bool FloatRoundsExactly( double v )
+{
+    const double magnitude = ( v < 0 ) ? -v : v;
+    if ( magnitude < FLT_MIN || magnitude > FLT_MAX ) {
+        return magnitude == 0;
+    }
+    unsigned long long bits = 0;
+    memcpy( &bits, &v, sizeof( bits ) );
+    return ( bits & 0x1fffffffULL ) != 0x10000000ULL;
+}
+
+// Copies [start, end) for strtod, with the locale's decimal point
+static void LocalizeDecimal( const char* start, const char* end, DynArray< char, 64 >* buffer )
+{
+    const char* point = localeconv()->decimal_point;
+    const int pointLength = (int)strlen( point );
+    for( const char* p = start; p < end; ++p ) {
+        if ( *p == '.' ) {
+            memcpy( buffer->PushArr( pointLength ), point, pointLength );
+        }
+        else {
+            buffer->Push( *p );
+        }
+    }
+    buffer->Push( 0 );
+}
+
+// Case insensitive prefix match, word in lower case
+static bool MatchWord( const char* p, const char* word )
+{
+    for( ; *word; ++p, ++word ) {
+        if ( *p != *word && *p != *word - 'a' + 'A' ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// INF, -INF and NaN as XML Schema writes them, inf and nan as printf does
+static const char* ParseSpecial( const char* p, double* value )
+{
+    const bool negative = ( *p == '-' );
+    if ( *p == '-' || *p == '+' ) {
+        ++p;
+    }
+    if ( MatchWord( p, "infinity" ) ) {
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        return p + 8;
+    }
+    if ( MatchWord( p, "inf" ) ) {
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        return p + 3;
+    }
+    if ( MatchWord( p, "nan" ) ) {
+        *value = NAN;
+        return p + 3;
+    }
+    return 0;
+}
+
+// Digits up to limit, which is below 2^60 so the product cannot wrap
+static const char* ParseMagnitude( const char* p, unsigned long long limit, unsigned long long* value )
+{
+    if ( !IsDecimalDigit( *p ) ) {
+        return 0;
+    }
+    unsigned long long v = 0;
+    for( ; IsDecimalDigit( *p ); ++p ) {
+        v = v * 10 + ( *p - '0' );
+        if ( v > limit ) {
+            return 0;
+        }
+    }
+    *value = v;
+    return p;
+}
+
+
+const char* XMLUtil::ParseInt( const char* p, int* value )
+{
+    const bool negative = ( *p == '-' );
+    if ( *p == '-' || *p == '+' ) {
+        ++p;
+    }
+    unsigned long long magnitude = 0;
+    const unsigned long long limit = negative ? (unsigned long long)INT_MAX + 1 : (unsigned long long)INT_MAX;
+    p = ParseMagnitude( p, limit, &magnitude );
+    if ( p ) {
+        *value = negative ? (int)( -(long long)magnitude ) : (int)magnitude;
+    }
+    return p;
+}
+
+
+const char* XMLUtil::ParseUnsigned( const char* p, unsigned* value )
+{
+    if ( *p == '+' ) {
+        ++p;
+    }
+    unsigned long long magnitude = 0;
+    p = ParseMagnitude( p, UINT_MAX, &magnitude );
+    if ( p ) {
+        *value = (unsigned)magnitude;
+    }
+    return p;
+}
+
+
+const char* XMLUtil::ParseFloat( const char* p, float* value )
+{
+    Decimal d;
+    if ( !ScanDecimal( p, &d ) ) {
+        double special = 0;
+        const char* end = ParseSpecial( p, &special );
+        if ( end ) {
+            *value = (float)special;
+        }
+        return end;
+    }
+    double rounded = 0;
+    if ( FastDouble( d, &rounded ) && FloatRoundsExactly( rounded ) ) {
+        *value = (float)rounded;
+    }
+    else {
+        DynArray< char, 64 > buffer;
+        LocalizeDecimal( p, d.end, &buffer );
+        *value = strtof( buffer.Mem(), 0 );
+    }
+    return d.end;
+}
+
+
+const char* XMLUtil::ParseDouble( const char* p, double* value )
+{
+    Decimal d;
+    if ( !ScanDecimal( p, &d ) ) {
+        return ParseSpecial( p, value );
+    }
+    if ( !FastDouble( d, value ) ) {
+        DynArray< char, 64 > buffer;
+        LocalizeDecimal( p, d.end, &buffer );
+        *value = strtod( buffer.Mem(), 0 );
+    }
+    return d.end;
+}
+
+
+// Like sscanf, leading white space is skipped and whatever follows the number ignored
+bool XMLUtil::ToInt( const char* str, int* value )
+{
+    return ParseInt( SkipWhiteSpace( str ), value ) != 0;
+}
+
+bool XMLUtil::ToUnsigned( const char* str, unsigned *value )
+{
+    return ParseUnsigned( SkipWhiteSpace( str ), value ) != 0;
 }
 
 bool XMLUtil::ToBool( const char* str, bool* value )
@@ -593,18 +1021,12 @@ bool XMLUtil::ToBool( const char* str, bool* value )
 
 bool XMLUtil::ToFloat( const char* str, float* value )
 {
-    if ( TIXML_SSCANF( str, "%f", value ) == 1 ) {
-        return true;
-    }
-    return false;
+    return ParseFloat( SkipWhiteSpace( str ), value ) != 0;
 }
 
 bool XMLUtil::ToDouble( const char* str, double* value )
 {
-    if ( TIXML_SSCANF( str, "%lf", value ) == 1 ) {
-        return true;
-    }
-    return false;
+    return ParseDouble( SkipWhiteSpace( str ), value ) != 0;
 }
 
 
@@ -582,6 +582,15 @@ public:
     static bool	ToBool( const char* str, bool* value );
     static bool	ToFloat( const char* str, float* value );
     static bool ToDouble( const char* str, double* value );
+
+    // Read the number at p, decimal whatever the C locale is, and return the
+    // character after it, or null when there is none. Floats and doubles are
+    // correctly rounded and also take INF and NaN. Values out of range of an
+    // int or unsigned are not numbers.
+    static const char* ParseInt( const char* p, int* value );
+    static const char* ParseUnsigned( const char* p, unsigned* value );
+    static const char* ParseFloat( const char* p, float* value );
+    static const char* ParseDouble( const char* p, double* value );
 };
 
 
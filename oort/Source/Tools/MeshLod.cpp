@@ -0,0 +1,119 @@
+// Offline LOD baker. Simplifies a .mesh.xml into a chain of levels with the
+// same simplifier the game runs on fracture pieces and saves each one the way
+// the game saves meshes, as the binary ../Assets/meshgen/<name>_lod<n>.mesh,
+// so run it from Binaries. name defaults to the input's file name. Every
+// level is reordered for the vertex cache first and its miss ratio printed
+// before and after.
+//
+//   meshlod input.mesh.xml [-ratios 0.5,0.25,0.1] [-max-error e] [-name name]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "MeshSlicer.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static bool parseRatios(const char* text, std::vector<float>& ratios)
+{
+	ratios.clear();
+	while (*text)
+	{
+		char* end;
+		float r = (float)strtod(text, &end);
+		if (end == text || !(r > 0.0f && r < 1.0f))
+			return false;
+		ratios.push_back(r);
+		text = *end == ',' ? end + 1 : end;
+	}
+	return !ratios.empty();
+}
+
+int main(int argc, char** argv)
+{
+	const char* input = NULL;
+	std::vector<float> ratios;
+	ratios.push_back(0.5f);
+	ratios.push_back(0.25f);
+	ratios.push_back(0.1f);
+	float maxError = 1e30f;
+	std::string name;
+
+	bool usage = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool more = i + 1 < argc;
+		if (!strcmp(argv[i], "-ratios") && more)
+			usage |= !parseRatios(argv[++i], ratios);
+		else if (!strcmp(argv[i], "-max-error") && more)
+			maxError = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-name") && more)
+			name = argv[++i];
+		else if (argv[i][0] != '-' && !input)
+			input = argv[i];
+		else
+			usage = true;
+	}
+	if (usage || !input)
+	{
+		fprintf(stderr, "usage: %s input.mesh.xml [-ratios 0.5,0.25,0.1] [-max-error e] [-name name]\n", argv[0]);
+		return 1;
+	}
+
+	if (name.empty())
+	{
+		name = input;
+		size_t slash = name.find_last_of("/\\");
+		if (slash != std::string::npos)
+			name.erase(0, slash + 1);
+		size_t ext = name.rfind(".mesh.xml");
+		if (ext != std::string::npos)
+			name.erase(ext);
+	}
+
+	FILE* probe = fopen(input, "rb");
+	if (!probe)
+	{
+		fprintf(stderr, "%s not found\n", input);
+		return 1;
+	}
+	fclose(probe);
+
+	XML_Mesh mesh;
+	mesh.loadFromXMLFile(input);
+	if (mesh.faces.empty())
+	{
+		fprintf(stderr, "%s has no faces\n", input);
+		return 1;
+	}
+
+	MeshSimplifier simplifier;
+	MeshOptimizer optimizer;
+	std::vector<LodLevel> levels;
+	std::vector<CacheStats> stats;
+	Clock::time_point start = Clock::now();
+	simplifier.buildLodChain(mesh, ratios, levels, maxError);
+	for (size_t l = 0; l < levels.size(); ++l)
+		stats.push_back(optimizer.optimize(*levels[l].mesh));
+	double ms = std::chrono::duration<double>(Clock::now() - start).count() * 1000.0;
+
+	printf("%-6s %8s %8s %10s %8s %8s  %s\n", "level", "faces", "verts", "error", "acmr in", "acmr out", "file");
+	float acmr = optimizer.cacheMissRatio(mesh.faces, (int)mesh.verts.size());
+	printf("%-6d %8zu %8zu %10.4f %8.3f %8s  %s\n", 0, mesh.faces.size(), mesh.verts.size(), 0.0, acmr, "-", input);
+	for (size_t l = 0; l < levels.size(); ++l)
+	{
+		std::string file = name + "_lod" + std::to_string(l + 1) + ".mesh";
+		levels[l].mesh->toFile(file);
+		printf("%-6zu %8d %8zu %10.4f %8.3f %8.3f  %s\n", l + 1, levels[l].faceCount, levels[l].mesh->verts.size(), levels[l].error,
+			stats[l].acmrBefore, stats[l].acmrAfter, file.c_str());
+		delete levels[l].mesh;
+	}
+	printf("%zu levels in %.2f ms\n", levels.size(), ms);
+	return 0;
+}